@@ -18,10 +18,15 @@
 #include <iostream>
 #include <sstream>
 
+#include <algorithm>
+#include <csignal>
 #include <cstring>
 #include <functional>
+#include <deque>
+#include <list>
 #include <queue>
 #include <string>
+#include <string_view>
 #include <vector>
 #include<unordered_map>
 
@@ -0,0 +1,14 @@
+#ifndef THREAD_NAME_H
+#define THREAD_NAME_H
+#include <pthread.h>
+#include <string>
+
+constexpr size_t MAX_THREAD_NAME_LENGTH = 15; // Linux线程名的最大长度（不含结尾的'\0'）
+
+// 设置调用线程的名称，在top -H、perf、gdb中显示；超过MAX_THREAD_NAME_LENGTH的部分截断
+inline void SetCurrentThreadName(const std::string &name) {
+  pthread_setname_np(pthread_self(),
+                     name.substr(0, MAX_THREAD_NAME_LENGTH).c_str());
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "sql_connection_pool.h"
 #include "logger.h"
+#include "thread_name.h"
 
 /**
  * @brief 获取连接池实例
@@ -190,6 +191,7 @@ void ConnectionPool::ReleaseConnection(MYSQL *conn) {
  * 减少连接总数current_size_和空闲连接数idle_conn_num。
  */
 void ConnectionPool::DynamicAdjust() {
+  SetCurrentThreadName("db-pool-adjust");
   while (running_.load()) {
     std::this_thread::sleep_for(std::chrono::seconds(1));
     // 获取锁，保护共享资源
@@ -1,7 +1,9 @@
 #include "user_manager.h"
 #include "logger.h"
 
-UserManager::UserManager(SqlDatabase &dbop) : db_opreations_(dbop) {}
+UserManager::UserManager(SqlDatabase &dbop, size_t db_threads)
+    : db_opreations_(dbop), db_threads_(db_threads, db_threads, DEFAULT_POOL_QUEUE_LIMIT,
+                                          QueueBackend::WORK_STEALING, "db") {}
 
 /**
  * @brief 注册用户
@@ -96,4 +98,54 @@ bool UserManager::Login(const std::string &username,
     logger.Log(Logger::LogLevel::ERROR, "登录失败");
     return false;
   }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 异步注册用户
+ *
+ * 注册操作交给数据库线程执行，调用方（通常是事件循环线程）立即返回。
+ *
+ * @param username 用户名
+ * @param password 用户密码
+ * @param callback 注册完成后在数据库线程中调用，参数为是否注册成功
+ *
+ * @return 任务队列已满时返回false，此时不调用callback
+ */
+bool UserManager::RegisterAsync(std::string username, std::string password,
+                                ResultCallback callback) {
+  try {
+    db_threads_.Post(
+        [this, username = std::move(username), password = std::move(password),
+         callback = std::move(callback)]() {
+          callback(Register(username, password));
+        });
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 异步用户登录
+ *
+ * 登录验证交给数据库线程执行，调用方（通常是事件循环线程）立即返回。
+ *
+ * @param username 用户名
+ * @param password 密码
+ * @param callback 验证完成后在数据库线程中调用，参数为是否登录成功
+ *
+ * @return 任务队列已满时返回false，此时不调用callback
+ */
+bool UserManager::LoginAsync(std::string username, std::string password,
+                             ResultCallback callback) {
+  try {
+    db_threads_.Post(
+        [this, username = std::move(username), password = std::move(password),
+         callback = std::move(callback)]() {
+          callback(Login(username, password));
+        });
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+  return true;
+}
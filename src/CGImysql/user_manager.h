@@ -2,15 +2,26 @@
 #define USER_MANAGER_H
 #include "common.h"
 #include "sql_database.h"
+#include "thread_pool.h"
+
+constexpr size_t DEFAULT_DB_THREADS = 4; // 执行异步数据库操作的线程数，不宜超过连接池的连接数
+
 class UserManager{
     public:
-    explicit UserManager(SqlDatabase & db_opreations);
+    // 异步操作的结果回调，参数为操作是否成功，在数据库线程中调用
+    using ResultCallback = std::function<void(bool)>;
+
+    explicit UserManager(SqlDatabase & db_opreations, size_t db_threads = DEFAULT_DB_THREADS);
     //用户注册
     bool Register(const std::string & username, const std::string & password);
     //用户登录
     bool Login(const std::string & username, const std::string & password);
+    // 异步注册、登录：在数据库线程中执行，完成后调用callback，调用方不必等待数据库往返；
+    // 数据库线程的任务队列已满时返回false，不调用callback
+    bool RegisterAsync(std::string username, std::string password, ResultCallback callback);
+    bool LoginAsync(std::string username, std::string password, ResultCallback callback);
     private:
          SqlDatabase& db_opreations_;//数据库操作对象
-         
+         ThreadPool db_threads_; // 数据库线程，最后声明、最先析构，析构时执行完已提交的操作
 };
-#endif
\ No newline at end of file
+#endif
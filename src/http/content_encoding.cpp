@@ -0,0 +1,170 @@
+#include "content_encoding.h"
+#include "http_header.h"
+#ifdef TINY_SERVER_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TINY_SERVER_HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace {
+// 运行时压缩由StaticCache的后台压缩线程完成（每个资源的每种编码只压缩一次），不占用请求路径，
+// 但仍与请求处理争用CPU，因此选择速度与压缩率折中的级别；需要最高压缩率时可以预先生成.gz/.br文件
+constexpr int GZIP_LEVEL = 6;
+constexpr int BROTLI_QUALITY = 5;
+
+std::string_view Trim(std::string_view value) {
+  size_t begin = value.find_first_not_of(" \t");
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
+  size_t end = value.find_last_not_of(" \t");
+  return value.substr(begin, end - begin + 1);
+}
+
+
+#ifdef TINY_SERVER_HAS_ZLIB
+bool GzipCompress(const std::string &data, std::string *out) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // windowBits加16输出gzip格式而非zlib格式
+  if (deflateInit2(&stream, GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&stream, data.size()));
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef *>(&(*out)[0]);
+  stream.avail_out = static_cast<uInt>(out->size());
+  int ret = deflate(&stream, Z_FINISH);
+  out->resize(stream.total_out);
+  deflateEnd(&stream);
+  return ret == Z_STREAM_END;
+}
+#endif
+
+#ifdef TINY_SERVER_HAS_BROTLI
+bool BrotliCompress(const std::string &data, std::string *out) {
+  size_t size = BrotliEncoderMaxCompressedSize(data.size());
+  if (size == 0) {
+    return false;
+  }
+  out->resize(size);
+  if (!BrotliEncoderCompress(
+          BROTLI_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, data.size(),
+          reinterpret_cast<const uint8_t *>(data.data()), &size,
+          reinterpret_cast<uint8_t *>(&(*out)[0]))) {
+    return false;
+  }
+  out->resize(size);
+  return true;
+}
+#endif
+} // namespace
+
+const char *EncodingName(ContentEncoding encoding) {
+  switch (encoding) {
+  case ENCODING_GZIP:
+    return "gzip";
+  case ENCODING_BR:
+    return "br";
+  default:
+    return "";
+  }
+}
+
+const char *EncodingFileSuffix(ContentEncoding encoding) {
+  switch (encoding) {
+  case ENCODING_GZIP:
+    return ".gz";
+  case ENCODING_BR:
+    return ".br";
+  default:
+    return "";
+  }
+}
+
+/**
+ * @brief 解析Accept-Encoding请求头
+ *
+ * 支持q值：q=0表示明确拒绝该编码；"*"表示接受所有未单独列出的编码。
+ *
+ * @param accept_encoding 请求头取值，例如"gzip, deflate, br;q=0.8"
+ * @return 可接受的编码集合
+ */
+EncodingMask ParseAcceptEncoding(std::string_view accept_encoding) {
+  EncodingMask accepted = 1u << ENCODING_IDENTITY;
+  EncodingMask listed = 0;
+  bool wildcard = false;
+  while (!accept_encoding.empty()) {
+    size_t comma = accept_encoding.find(',');
+    std::string_view item = accept_encoding.substr(0, comma);
+    accept_encoding.remove_prefix(
+        comma == std::string_view::npos ? accept_encoding.size() : comma + 1);
+    std::string_view coding = item;
+    bool rejected = false;
+    size_t semicolon = item.find(';');
+    if (semicolon != std::string_view::npos) {
+      coding = item.substr(0, semicolon);
+      std::string_view param = Trim(item.substr(semicolon + 1));
+      if (param.compare(0, 2, "q=") == 0) {
+        rejected = atof(std::string(param.substr(2)).c_str()) <= 0.0;
+      }
+    }
+    coding = Trim(coding);
+    EncodingMask bit = 0;
+    if (EqualsIgnoreCase(coding, "gzip") || EqualsIgnoreCase(coding, "x-gzip")) {
+      bit = 1u << ENCODING_GZIP;
+    } else if (EqualsIgnoreCase(coding, "br")) {
+      bit = 1u << ENCODING_BR;
+    } else if (coding == "*") {
+      wildcard = !rejected;
+      continue;
+    } else {
+      continue;
+    }
+    listed |= bit;
+    if (!rejected) {
+      accepted |= bit;
+    }
+  }
+  if (wildcard) {
+    accepted |= ((1u << ENCODING_COUNT) - 1) & ~listed;
+  }
+  return accepted;
+}
+
+bool CanCompress(ContentEncoding encoding) {
+  switch (encoding) {
+#ifdef TINY_SERVER_HAS_ZLIB
+  case ENCODING_GZIP:
+    return true;
+#endif
+#ifdef TINY_SERVER_HAS_BROTLI
+  case ENCODING_BR:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+bool Compress(ContentEncoding encoding, const std::string &data,
+              std::string *out) {
+  switch (encoding) {
+#ifdef TINY_SERVER_HAS_ZLIB
+  case ENCODING_GZIP:
+    return GzipCompress(data, out);
+#endif
+#ifdef TINY_SERVER_HAS_BROTLI
+  case ENCODING_BR:
+    return BrotliCompress(data, out);
+#endif
+  default:
+    (void)data;
+    (void)out;
+    return false;
+  }
+}
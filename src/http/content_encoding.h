@@ -0,0 +1,27 @@
+#ifndef CONTENT_ENCODING_H
+#define CONTENT_ENCODING_H
+#include "common.h"
+
+// 响应体的内容编码
+enum ContentEncoding {
+  ENCODING_IDENTITY = 0, // 不压缩
+  ENCODING_GZIP,         // gzip
+  ENCODING_BR,           // brotli
+  ENCODING_COUNT
+};
+
+// 内容编码集合，第i位表示ContentEncoding i
+using EncodingMask = unsigned;
+
+// 编码对应的Content-Encoding取值及预压缩文件扩展名，identity返回空串
+const char *EncodingName(ContentEncoding encoding);
+const char *EncodingFileSuffix(ContentEncoding encoding);
+// 解析Accept-Encoding，返回客户端可接受的编码集合；identity总是可接受
+EncodingMask ParseAcceptEncoding(std::string_view accept_encoding);
+// 当前构建是否支持在运行时压缩为该编码
+bool CanCompress(ContentEncoding encoding);
+// 压缩data，成功时结果写入out
+bool Compress(ContentEncoding encoding, const std::string &data,
+              std::string *out);
+
+#endif
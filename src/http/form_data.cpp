@@ -0,0 +1,574 @@
+#include "form_data.h"
+
+namespace {
+constexpr std::string_view URLENCODED_TYPE = "application/x-www-form-urlencoded";
+constexpr std::string_view MULTIPART_TYPE = "multipart/form-data";
+constexpr std::string_view CRLF = "\r\n";
+constexpr std::string_view HEADERS_END = "\r\n\r\n";
+constexpr size_t MAX_BOUNDARY_SIZE = 70; // RFC 2046规定的boundary最大长度
+
+std::string_view Trim(std::string_view value) {
+  size_t begin = value.find_first_not_of(" \t");
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
+  size_t end = value.find_last_not_of(" \t");
+  return value.substr(begin, end - begin + 1);
+}
+
+// Content-Type中";"之前的媒体类型
+std::string_view MediaType(std::string_view content_type) {
+  return Trim(content_type.substr(0, content_type.find(';')));
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/**
+ * @brief 取出头部值中的下一个参数
+ *
+ * 参数形如 name=value 或 name="value"，以";"分隔；带引号的值中可以含有";"。
+ *
+ * @param value 头部值，调用后去掉已取出的参数
+ * @param name 输出参数名
+ * @param param 输出参数值（不含引号）
+ * @return 没有更多参数时返回false
+ */
+bool NextParam(std::string_view *value, std::string_view *name,
+               std::string_view *param) {
+  std::string_view rest = *value;
+  size_t begin = rest.find_first_not_of("; \t");
+  if (begin == std::string_view::npos) {
+    return false;
+  }
+  rest.remove_prefix(begin);
+  size_t eq = rest.find_first_of("=;");
+  if (eq == std::string_view::npos || rest[eq] == ';') {
+    // 没有值的参数
+    *name = Trim(rest.substr(0, eq));
+    *param = std::string_view();
+    *value = eq == std::string_view::npos ? std::string_view() : rest.substr(eq);
+    return true;
+  }
+  *name = Trim(rest.substr(0, eq));
+  rest.remove_prefix(std::min(rest.find_first_not_of(" \t", eq + 1), rest.size()));
+  if (!rest.empty() && rest[0] == '"') {
+    size_t end = 1;
+    while (end < rest.size() && rest[end] != '"') {
+      end += rest[end] == '\\' ? 2 : 1;
+    }
+    *param = rest.substr(1, std::min(end, rest.size()) - 1);
+    *value = rest.substr(std::min(end + 1, rest.size()));
+  } else {
+    size_t end = rest.find(';');
+    *param = Trim(rest.substr(0, end));
+    *value = end == std::string_view::npos ? std::string_view() : rest.substr(end);
+  }
+  return true;
+}
+
+/**
+ * @brief 解析multipart部分的头部
+ *
+ * 从Content-Disposition中取出字段名和文件名，记录Content-Type，其他头部忽略。
+ * 结果指向headers，不拷贝。
+ *
+ * @param headers 部分的头部，不含结尾的空行
+ * @param field 输出字段
+ * @return 缺少form-data类型的Content-Disposition或字段名时返回false
+ */
+bool ParsePartHeaders(std::string_view headers, FormField *field) {
+  bool has_name = false;
+  while (!headers.empty()) {
+    size_t end = headers.find(CRLF);
+    std::string_view line = headers.substr(0, end);
+    headers = end == std::string_view::npos ? std::string_view()
+                                            : headers.substr(end + CRLF.size());
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      return false;
+    }
+    std::string_view name = Trim(line.substr(0, colon));
+    std::string_view value = Trim(line.substr(colon + 1));
+    if (EqualsIgnoreCase(name, "Content-Type")) {
+      field->content_type_ = value;
+      continue;
+    }
+    if (!EqualsIgnoreCase(name, "Content-Disposition")) {
+      continue;
+    }
+    size_t semicolon = value.find(';');
+    if (!EqualsIgnoreCase(Trim(value.substr(0, semicolon)), "form-data")) {
+      return false;
+    }
+    value = semicolon == std::string_view::npos ? std::string_view()
+                                                : value.substr(semicolon);
+    std::string_view param_name;
+    std::string_view param;
+    while (NextParam(&value, &param_name, &param)) {
+      if (EqualsIgnoreCase(param_name, "name")) {
+        field->name_ = param;
+        has_name = true;
+      } else if (EqualsIgnoreCase(param_name, "filename")) {
+        field->filename_ = param;
+        field->is_file_ = true;
+      }
+    }
+  }
+  return has_name;
+}
+} // namespace
+
+FormData::FormData(std::pmr::memory_resource *resource) : storage_(resource) {}
+
+bool FormData::Parse(const HttpRequest &request) {
+  std::string_view content_type = request.GetHeader(HEADER_CONTENT_TYPE);
+  if (EqualsIgnoreCase(MediaType(content_type), URLENCODED_TYPE)) {
+    return ParseUrlEncoded(request.GetBody());
+  }
+  std::string_view boundary = MultipartBoundary(content_type);
+  if (!boundary.empty()) {
+    return ParseMultipart(request.GetBody(), boundary);
+  }
+  return false;
+}
+
+/**
+ * @brief 解析urlencoded表单
+ *
+ * 按"&"切分字段、按"="切分名称和值，空字段跳过，没有"="的字段值为空。
+ * 不含"%"和"+"的名称和值直接指向body。
+ *
+ * @param body 请求体
+ * @return 百分号编码非法时返回false
+ */
+bool FormData::ParseUrlEncoded(std::string_view body) {
+  while (!body.empty()) {
+    size_t end = body.find('&');
+    std::string_view pair = body.substr(0, end);
+    body = end == std::string_view::npos ? std::string_view()
+                                         : body.substr(end + 1);
+    if (pair.empty()) {
+      continue;
+    }
+    size_t eq = pair.find('=');
+    FormField field;
+    if (!Decode(pair.substr(0, eq), &field.name_)) {
+      return false;
+    }
+    if (eq != std::string_view::npos &&
+        !Decode(pair.substr(eq + 1), &field.value_)) {
+      return false;
+    }
+    fields_.PushBack(field);
+  }
+  return true;
+}
+
+/**
+ * @brief 解析完整的multipart请求体
+ *
+ * 每个部分以"--boundary"开始，头部之后的内容直到下一个"\r\n--boundary"，
+ * 以"--boundary--"结束。第一个分隔符之前和结束分隔符之后的内容忽略。
+ *
+ * @param body 请求体
+ * @param boundary Content-Type中的boundary参数
+ * @return 格式非法或缺少结束分隔符时返回false
+ */
+bool FormData::ParseMultipart(std::string_view body, std::string_view boundary) {
+  std::string delimiter("\r\n--");
+  delimiter.append(boundary.data(), boundary.size());
+  std::string_view dash_boundary =
+      std::string_view(delimiter).substr(CRLF.size());
+  size_t pos = 0;
+  if (body.substr(0, dash_boundary.size()) == dash_boundary) {
+    pos = dash_boundary.size();
+  } else {
+    pos = body.find(delimiter);
+    if (pos == std::string_view::npos) {
+      return false;
+    }
+    pos += delimiter.size();
+  }
+  for (;;) {
+    std::string_view next = body.substr(pos, 2);
+    if (next == "--") {
+      return true;
+    }
+    if (next != CRLF) {
+      return false;
+    }
+    pos += CRLF.size();
+    size_t headers_end = pos;
+    size_t data = pos + CRLF.size();
+    if (body.substr(pos, CRLF.size()) != CRLF) {
+      headers_end = body.find(HEADERS_END, pos);
+      if (headers_end == std::string_view::npos) {
+        return false;
+      }
+      data = headers_end + HEADERS_END.size();
+    }
+    FormField field;
+    if (!ParsePartHeaders(body.substr(pos, headers_end - pos), &field)) {
+      return false;
+    }
+    size_t end = body.find(delimiter, data);
+    if (end == std::string_view::npos) {
+      return false;
+    }
+    field.value_ = body.substr(data, end - data);
+    fields_.PushBack(field);
+    pos = end + delimiter.size();
+  }
+}
+
+std::string_view FormData::Get(std::string_view name) const {
+  const FormField *field = Find(name);
+  return field ? field->value_ : std::string_view();
+}
+
+const FormField *FormData::Find(std::string_view name) const {
+  for (const FormField &field : fields_) {
+    if (field.name_ == name) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+size_t FormData::Size() const { return fields_.Size(); }
+
+const FormField &FormData::Field(size_t index) const { return fields_[index]; }
+
+void FormData::AddField(const FormField &field) { fields_.PushBack(field); }
+
+std::string_view FormData::Store(std::string_view text) {
+  if (text.empty()) {
+    return std::string_view();
+  }
+  char *data = static_cast<char *>(storage_.allocate(text.size(), 1));
+  memcpy(data, text.data(), text.size());
+  return std::string_view(data, text.size());
+}
+
+/**
+ * @brief 解码urlencoded内容
+ *
+ * 先扫描是否需要解码：不含"%"和"+"时直接返回原内容；否则在内存资源中分配同样长度的空间，
+ * "+"解码为空格、"%XX"解码为对应字节。
+ *
+ * @param text 原内容
+ * @param out 输出解码结果
+ * @return "%"之后不是两个十六进制数字时返回false
+ */
+bool FormData::Decode(std::string_view text, std::string_view *out) {
+  if (text.find_first_of("%+") == std::string_view::npos) {
+    *out = text;
+    return true;
+  }
+  char *data = static_cast<char *>(storage_.allocate(text.size(), 1));
+  size_t size = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    char c = text[i];
+    if (c == '+') {
+      c = ' ';
+    } else if (c == '%') {
+      if (i + 2 >= text.size()) {
+        return false;
+      }
+      int high = HexValue(text[i + 1]);
+      int low = HexValue(text[i + 2]);
+      if (high < 0 || low < 0) {
+        return false;
+      }
+      c = static_cast<char>(high * 16 + low);
+      i += 2;
+    }
+    data[size++] = c;
+  }
+  *out = std::string_view(data, size);
+  return true;
+}
+
+bool IsFormContentType(std::string_view content_type) {
+  std::string_view media_type = MediaType(content_type);
+  return EqualsIgnoreCase(media_type, URLENCODED_TYPE) ||
+         EqualsIgnoreCase(media_type, MULTIPART_TYPE);
+}
+
+std::string_view MultipartBoundary(std::string_view content_type) {
+  size_t semicolon = content_type.find(';');
+  if (semicolon == std::string_view::npos ||
+      !EqualsIgnoreCase(MediaType(content_type), MULTIPART_TYPE)) {
+    return std::string_view();
+  }
+  std::string_view params = content_type.substr(semicolon);
+  std::string_view name;
+  std::string_view value;
+  while (NextParam(&params, &name, &value)) {
+    if (EqualsIgnoreCase(name, "boundary")) {
+      return value.size() <= MAX_BOUNDARY_SIZE ? value : std::string_view();
+    }
+  }
+  return std::string_view();
+}
+
+MultipartReader::MultipartReader(std::string_view boundary,
+                                 std::string upload_path, Handler handler,
+                                 size_t max_upload_size)
+    : delimiter_("\r\n--"), upload_path_(std::move(upload_path)),
+      handler_(std::move(handler)), max_upload_size_(max_upload_size),
+      pending_(CRLF) {
+  // 请求体开头的分隔符前面没有CRLF，预先放入一个，第一个分隔符与其他分隔符按同样方式查找
+  delimiter_.append(boundary.data(), boundary.size());
+}
+
+MultipartReader::~MultipartReader() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  // 处理函数已移走的文件unlink失败，忽略
+  for (const std::string &path : files_) {
+    unlink(path.c_str());
+  }
+}
+
+/**
+ * @brief 收到一段请求体
+ *
+ * 通常直接解析data，只有跨越两段的分隔符或部分头部才拼接到pending_中，
+ * 文件内容不经过额外的拷贝直接写入临时文件。
+ *
+ * @param data 一段请求体
+ * @return 格式非法或超过限制时返回false，连接不再接收请求体
+ */
+bool MultipartReader::OnBody(std::string_view data) {
+  if (state_ == kError) {
+    return false;
+  }
+  if (pending_.empty()) {
+    size_t used = Consume(data);
+    pending_.assign(data.data() + used, data.size() - used);
+  } else {
+    pending_.append(data.data(), data.size());
+    size_t used = Consume(pending_);
+    pending_.erase(0, used);
+  }
+  return state_ != kError;
+}
+
+/**
+ * @brief 解析一段数据
+ *
+ * 状态机依次识别分隔符、部分头部和部分内容。找不到分隔符时，末尾可能是分隔符开头的字节留到下一段，
+ * 其余内容作为部分内容交出；头部不完整时整体留到下一段。
+ *
+ * @param data 待解析的数据
+ * @return 已处理的字节数
+ */
+size_t MultipartReader::Consume(std::string_view data) {
+  size_t pos = 0;
+  for (;;) {
+    switch (state_) {
+    case kPreamble: {
+      size_t found = data.find(delimiter_, pos);
+      if (found == std::string_view::npos) {
+        return data.size() - PartialDelimiter(data.substr(pos));
+      }
+      pos = found + delimiter_.size();
+      state_ = kDelimiter;
+      break;
+    }
+    case kDelimiter:
+      if (data.size() - pos < 2) {
+        return pos;
+      }
+      if (data.compare(pos, 2, "--") == 0) {
+        state_ = kEpilogue;
+        return data.size();
+      }
+      if (data.compare(pos, 2, CRLF) != 0) {
+        Fail(400);
+        return data.size();
+      }
+      pos += CRLF.size();
+      state_ = kHeaders;
+      break;
+    case kHeaders: {
+      if (data.size() - pos < CRLF.size()) {
+        return pos;
+      }
+      size_t headers_end = pos;
+      size_t body = pos + CRLF.size();
+      if (data.compare(pos, CRLF.size(), CRLF) != 0) {
+        headers_end = data.find(HEADERS_END, pos);
+        if (headers_end == std::string_view::npos) {
+          if (data.size() - pos > MAX_PART_HEADER_SIZE) {
+            Fail(400);
+            return data.size();
+          }
+          return pos;
+        }
+        body = headers_end + HEADERS_END.size();
+      }
+      if (headers_end - pos > MAX_PART_HEADER_SIZE ||
+          !BeginPart(data.substr(pos, headers_end - pos))) {
+        Fail(400);
+        return data.size();
+      }
+      pos = body;
+      state_ = kData;
+      break;
+    }
+    case kData: {
+      size_t found = data.find(delimiter_, pos);
+      if (found == std::string_view::npos) {
+        size_t end = data.size() - PartialDelimiter(data.substr(pos));
+        if (!PartData(data.substr(pos, end - pos))) {
+          return data.size();
+        }
+        return end;
+      }
+      if (!PartData(data.substr(pos, found - pos)) || !EndPart()) {
+        return data.size();
+      }
+      pos = found + delimiter_.size();
+      state_ = kDelimiter;
+      break;
+    }
+    case kEpilogue:
+    case kError:
+      return data.size();
+    }
+  }
+}
+
+size_t MultipartReader::PartialDelimiter(std::string_view data) const {
+  size_t start =
+      data.size() >= delimiter_.size() ? data.size() - delimiter_.size() + 1 : 0;
+  for (size_t i = data.find('\r', start); i != std::string_view::npos;
+       i = data.find('\r', i + 1)) {
+    if (delimiter_.compare(0, data.size() - i, data.data() + i,
+                           data.size() - i) == 0) {
+      return data.size() - i;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 开始一个部分
+ *
+ * 字段名等头部内容拷贝到form_中（头部所在的缓冲区随后会被覆盖）。
+ * 文件字段在上传目录中用mkstemp创建临时文件，普通字段的值缓存在value_中。
+ *
+ * @param headers 部分的头部
+ * @return 头部非法或创建临时文件失败（回复500）时返回false
+ */
+bool MultipartReader::BeginPart(std::string_view headers) {
+  part_ = FormField();
+  if (!ParsePartHeaders(headers, &part_)) {
+    return false;
+  }
+  part_.name_ = form_.Store(part_.name_);
+  part_.filename_ = form_.Store(part_.filename_);
+  part_.content_type_ = form_.Store(part_.content_type_);
+  value_.clear();
+  if (!part_.is_file_) {
+    return true;
+  }
+  std::string path = upload_path_ + "/upload-XXXXXX";
+  fd_ = mkstemp(&path[0]);
+  if (fd_ < 0) {
+    Fail(500);
+    return false;
+  }
+  files_.push_back(path);
+  part_.file_path_ = form_.Store(path);
+  return true;
+}
+
+bool MultipartReader::PartData(std::string_view data) {
+  if (state_ == kError) {
+    return false;
+  }
+  if (!part_.is_file_) {
+    if (value_.size() + data.size() > MAX_FORM_FIELD_SIZE) {
+      Fail(413);
+      return false;
+    }
+    value_.append(data.data(), data.size());
+    return true;
+  }
+  uploaded_ += data.size();
+  if (uploaded_ > max_upload_size_) {
+    Fail(413);
+    return false;
+  }
+  // 写入页缓存通常很快，不会明显阻塞事件循环
+  while (!data.empty()) {
+    ssize_t n = write(fd_, data.data(), data.size());
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      Fail(500);
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(n));
+    part_.file_size_ += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool MultipartReader::EndPart() {
+  if (part_.is_file_) {
+    int fd = fd_;
+    fd_ = -1;
+    if (close(fd) != 0) {
+      Fail(500);
+      return false;
+    }
+  } else {
+    part_.value_ = form_.Store(value_);
+  }
+  form_.AddField(part_);
+  return true;
+}
+
+void MultipartReader::Fail(int status) {
+  if (state_ == kError) {
+    return;
+  }
+  state_ = kError;
+  error_status_ = status;
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void MultipartReader::OnComplete(const HttpRequest &request,
+                                 HttpResponse &response) {
+  if (state_ != kEpilogue) {
+    // 出错，或请求体结束时缺少结束分隔符
+    int status = state_ == kError ? error_status_ : 400;
+    response.SetStatusCode(status);
+    response.SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
+    response.SetBody(status == 413   ? "Payload Too Large"
+                     : status == 500 ? "Internal Server Error"
+                                     : "Malformed multipart body");
+    return;
+  }
+  handler_(request, form_, response);
+}
@@ -0,0 +1,118 @@
+#ifndef FORM_DATA_H
+#define FORM_DATA_H
+#include "common.h"
+#include "http_conn.h"
+#include <memory_resource>
+
+constexpr size_t MAX_PART_HEADER_SIZE = 8 * 1024;         // multipart每个部分头部的最大长度
+constexpr size_t MAX_FORM_FIELD_SIZE = 64 * 1024;         // 流式解析时缓存在内存中的普通字段的最大长度
+constexpr size_t DEFAULT_MAX_UPLOAD_SIZE = 64 * 1024 * 1024; // 一个请求上传的文件总长度上限
+
+// 一个表单字段。各字段指向请求体、FormData的内存资源或流式解析器，与它们的生命周期相同
+struct FormField {
+  std::string_view name_;         // 字段名
+  std::string_view value_;        // 字段值；流式接收的文件字段为空，内容在file_path_中
+  std::string_view filename_;     // 文件字段的原始文件名，普通字段为空
+  std::string_view content_type_; // multipart部分的Content-Type，未指定时为空
+  std::string_view file_path_;    // 流式接收的文件内容所在的临时文件，其他字段为空
+  size_t file_size_ = 0;          // 临时文件的字节数
+  bool is_file_ = false;          // 是否为文件字段（Content-Disposition带有filename）
+};
+
+// 表单数据：解析application/x-www-form-urlencoded和multipart/form-data请求体。
+// 字段名和值尽量直接指向请求体，不拷贝；只有含有百分号编码或'+'的内容才解码到构造时指定的内存资源
+// （通常是请求所用的内存资源），解析结果在请求和FormData都有效期间可用
+class FormData {
+public:
+  explicit FormData(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  FormData(const FormData &) = delete;
+  FormData &operator=(const FormData &) = delete;
+
+  // 按请求的Content-Type解析已缓存的请求体，不是表单类型或格式非法时返回false
+  bool Parse(const HttpRequest &request);
+  // 解析urlencoded请求体（也可用于查询字符串），百分号编码非法时返回false
+  bool ParseUrlEncoded(std::string_view body);
+  // 解析完整缓存在内存中的multipart请求体，文件字段的内容也作为value_直接指向请求体
+  bool ParseMultipart(std::string_view body, std::string_view boundary);
+
+  // 字段值，同名字段出现多次时返回第一个，不存在时返回空
+  std::string_view Get(std::string_view name) const;
+  // 查找字段，不存在时返回nullptr
+  const FormField *Find(std::string_view name) const;
+  // 字段个数，以及按出现顺序的第index个字段
+  size_t Size() const;
+  const FormField &Field(size_t index) const;
+
+  // 追加字段（供流式解析器使用），字段中的内容必须在FormData有效期间有效
+  void AddField(const FormField &field);
+  // 把text拷贝到FormData的内存资源中
+  std::string_view Store(std::string_view text);
+
+private:
+  // 解码百分号编码和'+'，不需要解码时直接返回text
+  bool Decode(std::string_view text, std::string_view *out);
+
+  std::pmr::monotonic_buffer_resource storage_; // 解码后的内容，随FormData一起释放
+  SmallVector<FormField, 8> fields_;            // 字段，按出现顺序
+};
+
+// Content-Type是否为表单类型（urlencoded或multipart/form-data）
+bool IsFormContentType(std::string_view content_type);
+// Content-Type为multipart/form-data时返回其中的boundary参数，否则返回空
+std::string_view MultipartBoundary(std::string_view content_type);
+
+// 流式解析multipart/form-data请求体：请求体到达一段就解析一段，普通字段缓存在内存中，
+// 文件字段的内容直接从连接的输入缓冲区写入上传目录中的临时文件，内存占用与上传文件的大小无关。
+// 请求体接收完后调用处理函数；临时文件在解析器析构时删除，处理器需要保留文件时应在处理函数中rename移走。
+// 格式非法时回复400，普通字段超过MAX_FORM_FIELD_SIZE或文件总长度超过上限时回复413，都不调用处理函数
+class MultipartReader : public RequestBodyReader {
+public:
+  using Handler = std::function<void(const HttpRequest &, const FormData &,
+                                     HttpResponse &)>;
+
+  MultipartReader(std::string_view boundary, std::string upload_path,
+                  Handler handler,
+                  size_t max_upload_size = DEFAULT_MAX_UPLOAD_SIZE);
+  ~MultipartReader() override;
+
+  bool OnBody(std::string_view data) override;
+  void OnComplete(const HttpRequest &request, HttpResponse &response) override;
+
+private:
+  // 解析状态
+  enum State {
+    kPreamble,  // 第一个分隔符之前
+    kDelimiter, // 分隔符之后，等待CRLF（下一个部分）或"--"（结束）
+    kHeaders,   // 部分的头部
+    kData,      // 部分的内容
+    kEpilogue,  // 结束分隔符之后，忽略
+    kError      // 格式非法或超过限制
+  };
+
+  // 从data中解析尽可能多的内容，返回已处理的字节数，其余字节等待后续数据
+  size_t Consume(std::string_view data);
+  bool BeginPart(std::string_view headers);
+  bool PartData(std::string_view data);
+  bool EndPart();
+  void Fail(int status);
+  // data末尾可能是分隔符开头的字节数，这些字节需要等后续数据才能确定
+  size_t PartialDelimiter(std::string_view data) const;
+
+  std::string delimiter_;     // "\r\n--" + boundary
+  std::string upload_path_;   // 临时文件所在目录
+  Handler handler_;
+  size_t max_upload_size_;    // 文件总长度上限
+  size_t uploaded_ = 0;       // 已写入临时文件的字节数
+  State state_ = kPreamble;
+  int error_status_ = 0;      // 出错时回复的状态码
+  std::string pending_;       // 跨越两段数据、尚不能处理的字节
+  FormField part_;            // 正在解析的部分
+  std::string value_;         // 正在解析的普通字段的值
+  int fd_ = -1;               // 正在写入的临时文件
+  std::vector<std::string> files_; // 已创建的临时文件路径
+  FormData form_;             // 解析结果，使用普通堆内存（处理函数可能在线程池中调用）
+};
+
+#endif
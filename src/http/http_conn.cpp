@@ -1,73 +1,176 @@
 #include "http_conn.h"
+#include "http_parser.h"
+#include <charconv>
+
+namespace {
+// 常见状态码预先格式化好的状态行，设置状态码时查表，构造响应时直接拷贝
+struct StatusLine {
+  int code;
+  std::string_view line;
+};
+constexpr StatusLine STATUS_LINES[] = {
+    {100, "HTTP/1.1 100 Continue\r\n"},
+    {200, "HTTP/1.1 200 OK\r\n"},
+    {201, "HTTP/1.1 201 Created\r\n"},
+    {204, "HTTP/1.1 204 No Content\r\n"},
+    {206, "HTTP/1.1 206 Partial Content\r\n"},
+    {301, "HTTP/1.1 301 Moved Permanently\r\n"},
+    {302, "HTTP/1.1 302 Found\r\n"},
+    {304, "HTTP/1.1 304 Not Modified\r\n"},
+    {400, "HTTP/1.1 400 Bad Request\r\n"},
+    {401, "HTTP/1.1 401 Unauthorized\r\n"},
+    {403, "HTTP/1.1 403 Forbidden\r\n"},
+    {404, "HTTP/1.1 404 Not Found\r\n"},
+    {405, "HTTP/1.1 405 Method Not Allowed\r\n"},
+    {408, "HTTP/1.1 408 Request Timeout\r\n"},
+    {413, "HTTP/1.1 413 Payload Too Large\r\n"},
+    {415, "HTTP/1.1 415 Unsupported Media Type\r\n"},
+    {429, "HTTP/1.1 429 Too Many Requests\r\n"},
+    {500, "HTTP/1.1 500 Internal Server Error\r\n"},
+    {501, "HTTP/1.1 501 Not Implemented\r\n"},
+    {503, "HTTP/1.1 503 Service Unavailable\r\n"},
+};
+constexpr std::string_view STATUS_LINE_PREFIX = "HTTP/1.1 ";
+constexpr std::string_view CRLF = "\r\n";
+constexpr std::string_view CONNECTION_KEEP_ALIVE = "Connection: keep-alive\r\n";
+constexpr std::string_view CONNECTION_CLOSE = "Connection: close\r\n";
+constexpr std::string_view CONTENT_LENGTH_PREFIX = "Content-Length: ";
+
+/**
+ * @brief 当前时间的Date响应头行
+ *
+ * 每个线程缓存一份，秒数变化时才重新格式化，同一秒内的响应直接复用。
+ *
+ * @return 形如"Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"的一行
+ */
+std::string_view DateHeaderLine() {
+  thread_local time_t cached_second = -1;
+  thread_local char line[64];
+  thread_local size_t length = 0;
+  time_t now = time(nullptr);
+  if (now != cached_second) {
+    struct tm tm_time;
+    gmtime_r(&now, &tm_time);
+    length = strftime(line, sizeof(line), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n",
+                      &tm_time);
+    cached_second = now;
+  }
+  return std::string_view(line, length);
+}
+} // namespace
+
+HttpRequest::HttpRequest(std::pmr::memory_resource *resource)
+    : raw_(resource) {}
+
 /**
  * @brief 解析HTTP请求
  *
- * 解析传入的原始HTTP请求字符串，提取出请求行、请求头等信息。
+ * 解析传入的原始HTTP请求字符串，提取出请求行、请求头等信息，请求头之后的全部内容作为请求体。
  *
  * @param raw_request 原始HTTP请求字符串
  * @return 解析成功返回true，否则返回false
  */
 bool HttpRequest::Parse(const std::string &raw_request) {
-  std::istringstream stream(raw_request);
-  std::string line;
-
-  // 解析请求行
-  if (getline(stream, line)) {
-    std::istringstream line_stream(line);
-    line_stream >> method_ >> path_ >> version_;
-  } else {
+  size_t head_len = HttpParser::FindHeadEnd(raw_request.data(),
+                                            raw_request.size(), 0);
+  if (head_len == 0 || raw_request.size() > UINT32_MAX) {
     return false;
   }
-
-  // 解析请求头
-  while (getline(stream, line) && line != "\r") {
-    auto colon_pos = line.find(":");
-    std::string key_temp = line.substr(0, colon_pos);
-    std::string value_temp = line.substr(colon_pos + 1);
-    headers_[key_temp] = value_temp;
+  *this = HttpRequest(raw_.get_allocator().resource());
+  raw_.assign(raw_request.data(), raw_request.size());
+  if (!HttpParser::ParseHead(this, head_len)) {
+    return false;
   }
-  // 解析请求体
-  body_ = std::string(std::istreambuf_iterator<char>(stream), {});
+  body_.offset_ = static_cast<uint32_t>(head_len);
+  body_.length_ = static_cast<uint32_t>(raw_.size() - head_len);
   return true;
 }
 
+std::string_view HttpRequest::View(Span span) const {
+  return std::string_view(raw_.data() + span.offset_, span.length_);
+}
+
 /**
  * @brief 获取HTTP请求的方法
  *
  * 返回HTTP请求的方法，例如GET、POST等。
  *
- * @return HTTP请求的方法
+ * @return HTTP请求的方法，在请求对象销毁或被重新赋值前有效
  */
-const std::string &HttpRequest::GetMethod() const { return method_; }
+std::string_view HttpRequest::GetMethod() const { return View(method_); }
 
 /**
  * @brief 获取HTTP请求的路径
  *
  * 返回HTTP请求的路径部分，例如"/index.html"。
  *
- * @return HTTP请求的路径
+ * @return HTTP请求的路径，在请求对象销毁或被重新赋值前有效
  */
-const std::string &HttpRequest::GetPath() const { return path_; }
+std::string_view HttpRequest::GetPath() const { return View(path_); }
 
 /**
  * @brief 获取HTTP请求的版本号
  *
  * 返回HTTP请求的版本号，例如HTTP/1.1。
  *
- * @return HTTP请求的版本号
+ * @return HTTP请求的版本号，在请求对象销毁或被重新赋值前有效
  */
-const std::string &HttpRequest::GetVersion() const { return version_; }
+std::string_view HttpRequest::GetVersion() const { return View(version_); }
 
 /**
- * @brief 获取HTTP请求的头部信息
+ * @brief 获取HTTP请求头
  *
- * 返回HTTP请求的头部信息，以键值对的形式存储在一个无序映射中。
+ * 常用请求头按编号直接定位；其他请求头按名称忽略大小写逐个比较，同名请求头出现多次时返回第一个。
  *
- * @return 一个常量引用，指向包含HTTP请求头部信息的无序映射
+ * @param name 请求头名称
+ * @return 请求头的值，不存在时返回空
  */
-const std::unordered_map<std::string, std::string> &
-HttpRequest::GetHeaders() const {
-  return headers_;
+std::string_view HttpRequest::GetHeader(std::string_view name) const {
+  HttpHeaderId id = LookupHeaderId(name);
+  if (id != HEADER_UNKNOWN) {
+    return GetHeader(id);
+  }
+  for (const HeaderSpan &header : headers_) {
+    if (header.id_ == HEADER_UNKNOWN &&
+        EqualsIgnoreCase(View(header.name_), name)) {
+      return View(header.value_);
+    }
+  }
+  return std::string_view();
+}
+
+std::string_view HttpRequest::GetHeader(HttpHeaderId id) const {
+  if (id >= HEADER_COUNT || header_slots_[id] == 0) {
+    return std::string_view();
+  }
+  return View(headers_[header_slots_[id] - 1].value_);
+}
+
+size_t HttpRequest::HeaderCount() const { return headers_.Size(); }
+
+HttpHeaderId HttpRequest::HeaderId(size_t index) const {
+  return headers_[index].id_;
+}
+
+std::string_view HttpRequest::HeaderName(size_t index) const {
+  return View(headers_[index].name_);
+}
+
+std::string_view HttpRequest::HeaderValue(size_t index) const {
+  return View(headers_[index].value_);
+}
+
+void HttpRequest::AddHeader(Span name, Span value) {
+  HttpHeaderId id = LookupHeaderId(View(name));
+  headers_.PushBack(HeaderSpan{name, value, id});
+  if (id != HEADER_UNKNOWN && header_slots_[id] == 0) {
+    header_slots_[id] = static_cast<uint16_t>(headers_.Size());
+  }
+}
+
+void HttpRequest::ClearHeaders() {
+  headers_.Clear();
+  std::fill(std::begin(header_slots_), std::end(header_slots_), 0);
 }
 
 /**
@@ -75,9 +178,68 @@ HttpRequest::GetHeaders() const {
  *
  * 返回HTTP请求的请求体内容。
  *
- * @return HTTP请求的请求体内容
+ * @return HTTP请求的请求体内容，在请求对象销毁或被重新赋值前有效
  */
-const std::string &HttpRequest::GetBody() const { return body_; }
+std::string_view HttpRequest::GetBody() const { return View(body_); }
+
+std::pmr::memory_resource *HttpRequest::Resource() const {
+  return raw_.get_allocator().resource();
+}
+
+/**
+ * @brief 判断响应后是否保持连接
+ *
+ * HTTP/1.1默认保持连接，除非请求头带有Connection: close；HTTP/1.0只有显式声明
+ * Connection: keep-alive时才保持连接。
+ *
+ * @return 保持连接返回true
+ */
+bool HttpRequest::KeepAlive() const {
+  std::string_view connection = GetHeader(HEADER_CONNECTION);
+  if (GetVersion() == "HTTP/1.1") {
+    return !EqualsIgnoreCase(connection, "close");
+  }
+  return EqualsIgnoreCase(connection, "keep-alive");
+}
+
+std::string_view HttpRequest::GetParam(std::string_view name) const {
+  for (const ParamSpan &param : params_) {
+    if (param.name_ == name) {
+      return View(param.value_);
+    }
+  }
+  return std::string_view();
+}
+
+size_t HttpRequest::ParamCount() const { return params_.Size(); }
+
+std::string_view HttpRequest::ParamName(size_t index) const {
+  return params_[index].name_;
+}
+
+std::string_view HttpRequest::ParamValue(size_t index) const {
+  return View(params_[index].value_);
+}
+
+void HttpRequest::AddParam(std::string_view name, std::string_view value) {
+  Span span;
+  span.offset_ = static_cast<uint32_t>(value.data() - raw_.data());
+  span.length_ = static_cast<uint32_t>(value.size());
+  params_.PushBack(ParamSpan{name, span});
+}
+
+void HttpRequest::ClearParams() { params_.Clear(); }
+
+RequestBodyReader *HttpRequest::GetBodyReader() const {
+  return body_reader_.get();
+}
+
+void HttpRequest::SetBodyReader(std::shared_ptr<RequestBodyReader> reader) {
+  body_reader_ = std::move(reader);
+}
+
+HttpResponse::HttpResponse(std::pmr::memory_resource *resource)
+    : fields_(resource), body_(resource) {}
 
 /**
  * @brief 设置HTTP响应的状态码
@@ -86,20 +248,98 @@ const std::string &HttpRequest::GetBody() const { return body_; }
  *
  * @param status_code 状态码字符串，例如 "200 OK"
  */
-void HttpResponse::SetStatusCode(const std::string &status_code) {
-  status_code_ = status_code;
+void HttpResponse::SetStatusCode(std::string_view status_code) {
+  status_line_ = std::string_view();
+  status_ = 0;
+  std::from_chars(status_code.data(), status_code.data() + status_code.size(),
+                  status_);
+  for (const StatusLine &entry : STATUS_LINES) {
+    std::string_view line = entry.line;
+    line.remove_prefix(STATUS_LINE_PREFIX.size());
+    line.remove_suffix(CRLF.size());
+    if (line == status_code) {
+      status_line_ = entry.line;
+      status_code_.clear();
+      return;
+    }
+  }
+  status_code_.assign(status_code.data(), status_code.size());
+  if (status_code_.find(' ') == std::string::npos) {
+    // 状态行为"HTTP/1.1 SP 状态码 SP [原因短语]"，没有原因短语时也要保留第二个空格
+    status_code_ += ' ';
+  }
+}
+
+/**
+ * @brief 按数字设置HTTP响应的状态码
+ *
+ * 常见状态码使用预先格式化的状态行，其他状态码只输出数字和其后的空格，不带原因短语。
+ *
+ * @param status_code 状态码，例如404
+ */
+void HttpResponse::SetStatusCode(int status_code) {
+  status_ = status_code;
+  for (const StatusLine &entry : STATUS_LINES) {
+    if (entry.code == status_code) {
+      status_line_ = entry.line;
+      status_code_.clear();
+      return;
+    }
+  }
+  status_line_ = std::string_view();
+  status_code_ = std::to_string(status_code) + ' ';
+}
+
+void HttpResponse::SetKeepAlive(bool keep_alive) {
+  connection_ = keep_alive ? CONNECTION_KEEP_ALIVE : CONNECTION_CLOSE;
+}
+
+std::string_view HttpResponse::View(Span span) const {
+  return std::string_view(fields_.data() + span.offset_, span.length_);
+}
+
+HttpResponse::Span HttpResponse::Store(std::string_view text) {
+  Span span;
+  span.offset_ = static_cast<uint32_t>(fields_.size());
+  span.length_ = static_cast<uint32_t>(text.size());
+  fields_.append(text.data(), text.size());
+  return span;
 }
 
 /**
  * @brief 设置HTTP响应头
  *
- * 将指定的键和值设置为HTTP响应头。
+ * 将指定的键和值设置为HTTP响应头，同名（忽略大小写）响应头已存在时替换其值。
  *
  * @param key 要设置的HTTP响应头的键
  * @param value 要设置的HTTP响应头的值
  */
-void HttpResponse::SetHeader(const std::string &key, const std::string &value) {
-  headers_[key] = value;
+void HttpResponse::SetHeader(std::string_view key, std::string_view value) {
+  HttpHeaderId id = LookupHeaderId(key);
+  if (id != HEADER_UNKNOWN) {
+    SetHeader(id, value);
+    return;
+  }
+  for (HeaderField &field : headers_) {
+    if (field.id_ == HEADER_UNKNOWN && EqualsIgnoreCase(View(field.name_), key)) {
+      field.value_ = Store(value);
+      return;
+    }
+  }
+  Span name = Store(key);
+  headers_.PushBack(HeaderField{HEADER_UNKNOWN, name, Store(value)});
+}
+
+void HttpResponse::SetHeader(HttpHeaderId id, std::string_view value) {
+  if (id >= HEADER_COUNT) {
+    return;
+  }
+  if (header_slots_[id] != 0) {
+    headers_[header_slots_[id] - 1].value_ = Store(value);
+    return;
+  }
+  headers_.PushBack(HeaderField{id, Span(), Store(value)});
+  header_slots_[id] = static_cast<uint16_t>(headers_.Size());
 }
 
 /**
@@ -109,18 +349,222 @@ void HttpResponse::SetHeader(const std::string &key, const std::string &value) {
  *
  * @param body 响应主体的内容
  */
-void HttpResponse::SetBody(const std::string &body) {
-  // 将传入的主体内容赋值给body_成员变量
-  body_ = body;
+void HttpResponse::SetBody(std::string_view body) {
+  // 将传入的主体内容拷贝到body_成员变量
+  body_.assign(body.data(), body.size());
+  file_body_.reset();
+  shared_body_.reset();
+  ClearBodyProducer();
 }
 
 
-std::string HttpResponse::BuildHttpResponse()const{
-  std::ostringstream response;
-  response<<"HTTP/1.1"<<status_code_<<"\r\n";
-  for(const auto&pair:headers_){
-    response<<pair.first<<":"<<pair.second<<"\r\n";
+std::string HttpResponse::BuildHttpResponse() const {
+  char content_length[24];
+  size_t content_length_size = 0;
+  size_t size = HeadersSize(content_length, &content_length_size);
+  std::string response(size + body_.size(), '\0');
+  char *end = WriteHeaders(&response[0],
+                           std::string_view(content_length, content_length_size));
+  memcpy(end, body_.data(), body_.size());
+  return response;
+}
+
+/**
+ * @brief 构造HTTP响应的状态行和响应头
+ *
+ * 返回的字符串以空行结尾，调用方可以把它和响应体作为两个独立的缓冲区一起写出。
+ *
+ * @return 状态行和响应头
+ */
+std::string HttpResponse::BuildHeaders() const {
+  char content_length[24];
+  size_t content_length_size = 0;
+  std::string headers(HeadersSize(content_length, &content_length_size), '\0');
+  WriteHeaders(&headers[0], std::string_view(content_length, content_length_size));
+  return headers;
+}
+
+/**
+ * @brief 在指定的内存资源中构造HTTP响应的状态行和响应头
+ *
+ * 先计算准确长度，从resource中一次分配，不经过std::string。返回的内容不会被单独释放，
+ * resource应当是按轮次整体复位的内存池（如连接的RequestArena）。
+ *
+ * @param resource 内存资源
+ * @return 状态行和响应头
+ */
+std::string_view
+HttpResponse::BuildHeaders(std::pmr::memory_resource *resource) const {
+  char content_length[24];
+  size_t content_length_size = 0;
+  size_t size = HeadersSize(content_length, &content_length_size);
+  char *out = static_cast<char *>(resource->allocate(size, 1));
+  WriteHeaders(out, std::string_view(content_length, content_length_size));
+  return std::string_view(out, size);
+}
+
+/**
+ * @brief 计算状态行和响应头的长度
+ *
+ * 自动添加Date和Content-Length（调用方已设置时除外）；1xx、204和304响应没有响应体，不发送Content-Length。
+ * 使用chunked编码或长度未知的流式响应体也不发送Content-Length。
+ *
+ * @param content_length 输出需要发送的Content-Length值，至少24字节
+ * @param content_length_size 输出Content-Length值的长度，不发送时为0
+ * @return 状态行和响应头（含结尾空行）的字节数
+ */
+size_t HttpResponse::HeadersSize(char *content_length,
+                                 size_t *content_length_size) const {
+  *content_length_size = 0;
+  if (status_ >= 200 && status_ != 204 && status_ != 304 &&
+      header_slots_[HEADER_CONTENT_LENGTH] == 0 &&
+      header_slots_[HEADER_TRANSFER_ENCODING] == 0 &&
+      !(streaming_ && producer_length_ == UNKNOWN_BODY_LENGTH)) {
+    *content_length_size = static_cast<size_t>(
+        std::to_chars(content_length, content_length + 24, BodySize()).ptr -
+        content_length);
+  }
+  size_t size = status_line_.empty()
+                    ? STATUS_LINE_PREFIX.size() + status_code_.size() + CRLF.size()
+                    : status_line_.size();
+  if (header_slots_[HEADER_DATE] == 0) {
+    size += DateHeaderLine().size();
+  }
+  size += connection_.size() + CRLF.size();
+  if (prebuilt_headers_) {
+    size += prebuilt_headers_->size();
+  }
+  for (const HeaderField &field : headers_) {
+    size += FieldName(field).size() + 2 + field.value_.length_ + CRLF.size();
+  }
+  if (*content_length_size > 0) {
+    size += CONTENT_LENGTH_PREFIX.size() + *content_length_size + CRLF.size();
+  }
+  return size;
+}
+
+/**
+ * @brief 写出状态行和响应头
+ *
+ * @param out 输出位置，至少有HeadersSize返回的字节数
+ * @param content_length HeadersSize给出的Content-Length值，为空时不输出
+ * @return 写入结束的位置
+ */
+char *HttpResponse::WriteHeaders(char *out,
+                                 std::string_view content_length) const {
+  auto put = [&out](std::string_view text) {
+    memcpy(out, text.data(), text.size());
+    out += text.size();
+  };
+  if (status_line_.empty()) {
+    put(STATUS_LINE_PREFIX);
+    put(status_code_);
+    put(CRLF);
+  } else {
+    put(status_line_);
+  }
+  if (header_slots_[HEADER_DATE] == 0) {
+    put(DateHeaderLine());
+  }
+  if (prebuilt_headers_) {
+    put(*prebuilt_headers_);
   }
-  response<<"\r\n"<<body_;
-  return response.str();
-}
\ No newline at end of file
+  for (const HeaderField &field : headers_) {
+    put(FieldName(field));
+    put(": ");
+    put(View(field.value_));
+    put(CRLF);
+  }
+  if (!content_length.empty()) {
+    put(CONTENT_LENGTH_PREFIX);
+    put(content_length);
+    put(CRLF);
+  }
+  put(connection_);
+  put(CRLF);
+  return out;
+}
+
+std::string_view HttpResponse::FieldName(const HeaderField &field) const {
+  return field.id_ == HEADER_UNKNOWN ? View(field.name_)
+                                     : HeaderIdName(field.id_);
+}
+
+std::pmr::string HttpResponse::ReleaseBody(){
+  return std::move(body_);
+}
+
+void HttpResponse::SetFileBody(std::shared_ptr<FileBody> file) {
+  body_.clear();
+  shared_body_.reset();
+  ClearBodyProducer();
+  file_body_ = std::move(file);
+}
+
+std::shared_ptr<FileBody> HttpResponse::ReleaseFileBody() {
+  return std::move(file_body_);
+}
+
+void HttpResponse::SetSharedBody(std::shared_ptr<const std::string> body) {
+  body_.clear();
+  file_body_.reset();
+  ClearBodyProducer();
+  shared_body_ = std::move(body);
+}
+
+std::shared_ptr<const std::string> HttpResponse::ReleaseSharedBody() {
+  return std::move(shared_body_);
+}
+
+void HttpResponse::SetPrebuiltHeaders(
+    std::shared_ptr<const std::string> headers) {
+  prebuilt_headers_ = std::move(headers);
+}
+
+void HttpResponse::SetBodyProducer(
+    std::shared_ptr<ResponseBodyProducer> producer, size_t length) {
+  body_.clear();
+  file_body_.reset();
+  shared_body_.reset();
+  body_producer_ = std::move(producer);
+  streaming_ = body_producer_ != nullptr;
+  producer_length_ = streaming_ ? length : 0;
+}
+
+int HttpResponse::GetStatusCode() const { return status_; }
+
+bool HttpResponse::HasBodyProducer() const { return body_producer_ != nullptr; }
+
+size_t HttpResponse::BodyProducerLength() const { return producer_length_; }
+
+std::shared_ptr<ResponseBodyProducer> HttpResponse::ReleaseBodyProducer() {
+  return std::move(body_producer_);
+}
+
+void HttpResponse::ClearBodyProducer() {
+  body_producer_.reset();
+  streaming_ = false;
+  producer_length_ = 0;
+}
+
+size_t HttpResponse::BodySize() const {
+  if (streaming_) {
+    return producer_length_;
+  }
+  if (file_body_) {
+    return file_body_->Size();
+  }
+  return shared_body_ ? shared_body_->size() : body_.size();
+}
+
+FileBody::FileBody(int fd, size_t size) : fd_(fd), size_(size) {}
+
+FileBody::~FileBody() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+int FileBody::Fd() const { return fd_; }
+
+size_t FileBody::Size() const { return size_; }
@@ -1,47 +1,241 @@
 #ifndef HTTP_CONN_H
 #define HTTP_CONN_H
 #include "common.h"
+#include "http_header.h"
+#include <memory_resource>
 
-// http请求类
+// 请求头部分的最大长度，超过后仍未找到空行视为非法请求
+constexpr size_t MAX_HEADER_SIZE = 64 * 1024;
+// 默认的请求体最大长度（完整缓存在内存中的请求体），超过时回复413
+constexpr size_t DEFAULT_MAX_BODY_SIZE = 1024 * 1024;
+// 流式响应体的长度未知：HTTP/1.1使用chunked编码发送，HTTP/1.0发送完后关闭连接
+constexpr size_t UNKNOWN_BODY_LENGTH = static_cast<size_t>(-1);
+
+class HttpRequest;
+class HttpResponse;
+
+// 流式接收请求体：请求头解析完后由路由创建，请求体到达一段就交给OnBody一段，
+// 服务器不在内存中缓存整个请求体。OnBody在连接所属的事件循环线程中调用，不能阻塞；
+// OnComplete在普通请求处理器所在的线程中调用，生成响应；连接在请求体接收完之前关闭时不调用OnComplete
+class RequestBodyReader {
+public:
+  virtual ~RequestBodyReader() = default;
+  // 收到一段请求体（chunked编码已解码），返回false时停止接收，随后调用OnComplete并在响应后关闭连接
+  virtual bool OnBody(std::string_view data) = 0;
+  // 请求体接收完毕（或被OnBody中止）后生成响应
+  virtual void OnComplete(const HttpRequest &request, HttpResponse &response) = 0;
+};
+
+// 流式生成响应体：处理器不必先在内存中构造完整的响应体。连接发送完上一段后才调用Read取下一段，
+// 每个连接同时只缓存一段，内存占用与响应体大小无关。Read在连接所属的事件循环线程中调用，不能阻塞；
+// 处理器返回后请求即被释放，生产者不能引用请求中的数据
+class ResponseBodyProducer {
+public:
+  // 一次读取的结果
+  enum Status {
+    BODY_MORE,  // 还有后续数据
+    BODY_END,   // 响应体结束，本次写入的数据仍会发送
+    BODY_ERROR  // 出错，发送完已生成的部分后关闭连接，客户端据此得知响应体不完整
+  };
+  virtual ~ResponseBodyProducer() = default;
+  // 把下一段响应体写入buffer，最多size字节，written返回写入的字节数；返回BODY_MORE时至少写入1字节
+  virtual Status Read(char *buffer, size_t size, size_t *written) = 0;
+};
+
+// http请求类：请求头和请求体的原始字节保存在一块连续内存中，
+// 各字段只记录偏移量，通过string_view访问，解析时不为每个字段单独分配内存。
+// 原始字节从构造时指定的内存资源分配（连接上解析出的请求使用连接的RequestArena）
 class HttpRequest {
 public:
-  // 解析http请求
+  // 增量解析的结果
+  enum ParseStatus {
+    PARSE_COMPLETE,      // 得到一个完整请求
+    PARSE_INCOMPLETE,    // 数据不足，需要继续读取
+    PARSE_ERROR,         // 请求格式非法
+    PARSE_TOO_LARGE,     // 请求体超过最大长度
+    PARSE_HEAD_COMPLETE, // 请求头解析完成，请求体尚未读取
+    PARSE_BODY_DATA      // 流式接收模式下得到一段请求体
+  };
+
+  explicit HttpRequest(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  // 解析http请求：raw_request为完整的请求头，其后的内容作为请求体
   bool Parse(const std::string &raw_request);
   // 获取请求方法
-  const std::string &GetMethod() const;
+  std::string_view GetMethod() const;
   // 获取请求路径
-  const std::string &GetPath() const;
+  std::string_view GetPath() const;
   // 获取http版本号
-  const std::string &GetVersion()const;
-  // 获取请求头
-  const std::unordered_map<std::string, std::string> &GetHeaders() const;
+  std::string_view GetVersion() const;
+  // 获取请求头（名称忽略大小写），同名请求头出现多次时返回第一个，不存在时返回空
+  std::string_view GetHeader(std::string_view name) const;
+  // 按编号获取常用请求头，O(1)
+  std::string_view GetHeader(HttpHeaderId id) const;
+  // 请求头个数
+  size_t HeaderCount() const;
+  // 获取第index个请求头的编号、名称和值
+  HttpHeaderId HeaderId(size_t index) const;
+  std::string_view HeaderName(size_t index) const;
+  std::string_view HeaderValue(size_t index) const;
   // 获取请求体
-  const std::string &GetBody() const;
+  std::string_view GetBody() const;
+  // 请求数据所用的内存资源，处理器可以在其中分配与请求生命周期相同的内存（如解码后的表单字段）
+  std::pmr::memory_resource *Resource() const;
+  // 响应后是否保持连接
+  bool KeepAlive() const;
+  // 路由参数（如路由模式"/users/:id"中的id），不存在时返回空
+  std::string_view GetParam(std::string_view name) const;
+  // 路由参数个数，以及第index个参数的名称和值
+  size_t ParamCount() const;
+  std::string_view ParamName(size_t index) const;
+  std::string_view ParamValue(size_t index) const;
+  // 记录路由参数：name由路由表持有，value必须是GetPath()的一部分
+  void AddParam(std::string_view name, std::string_view value);
+  void ClearParams();
+  // 流式接收请求体的处理器，请求体已完整缓存时返回nullptr
+  RequestBodyReader *GetBodyReader() const;
+  void SetBodyReader(std::shared_ptr<RequestBodyReader> reader);
 
 private:
-  std::string method_;                                   // http请求方法
-  std::string path_;    // 请求路径
-  std::string version_;                  // http版本号               
-  std::unordered_map<std::string, std::string> headers_; // 请求头
-  std::string body_;                                     // 请求体
+  friend class HttpParser;
+
+  // raw_中的一段
+  struct Span {
+    uint32_t offset_ = 0;
+    uint32_t length_ = 0;
+  };
+  // 一个请求头
+  struct HeaderSpan {
+    Span name_;
+    Span value_;
+    HttpHeaderId id_ = HEADER_UNKNOWN;
+  };
+  // 一个路由参数，值记录在raw_中的位置，请求被移动或拷贝后仍然有效
+  struct ParamSpan {
+    std::string_view name_;
+    Span value_;
+  };
+
+  std::string_view View(Span span) const;
+  // 追加一个请求头，识别常用头部的编号
+  void AddHeader(Span name, Span value);
+  // 清空请求头
+  void ClearHeaders();
+
+  std::pmr::string raw_;            // 请求头和请求体的原始字节
+  Span method_;                     // http请求方法
+  Span path_;                       // 请求路径
+  Span version_;                    // http版本号
+  SmallVector<HeaderSpan, 16> headers_; // 请求头，按出现顺序
+  uint16_t header_slots_[HEADER_COUNT] = {}; // 常用请求头第一次出现的下标+1，0表示不存在
+  Span body_;                       // 请求体
+  SmallVector<ParamSpan, 4> params_; // 路由参数，按路由模式中出现的顺序
+  std::shared_ptr<RequestBodyReader> body_reader_; // 流式接收请求体的处理器
 };
 
-// http响应类
+// 以打开的文件作为响应体：发送时用sendfile直接从页缓存写入套接字，不拷贝到用户态
+class FileBody {
+public:
+  // 接管fd的所有权，析构时关闭
+  FileBody(int fd, size_t size);
+  ~FileBody();
+
+  FileBody(const FileBody &) = delete;
+  FileBody &operator=(const FileBody &) = delete;
+
+  int Fd() const;
+  size_t Size() const;
+
+private:
+  int fd_;      // 只读打开的文件
+  size_t size_; // 发送的字节数（打开时的文件大小）
+};
+
+// http响应类：响应头的名称和值、响应体从构造时指定的内存资源分配（连接上的响应使用连接的RequestArena）
 class HttpResponse {
 public:
-  // 设置状态码
-  void SetStatusCode(const std::string &status_code);
-  // 设置响应头
-  void SetHeader(const std::string &key, const std::string &value);
+  explicit HttpResponse(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  // 设置状态码，例如"200 OK"
+  void SetStatusCode(std::string_view status_code);
+  // 按数字设置状态码，使用标准的原因短语，例如404对应"404 Not Found"
+  void SetStatusCode(int status_code);
+  // 数字状态码，未设置时为0
+  int GetStatusCode() const;
+  // 设置响应后是否保持连接，输出对应的Connection响应头
+  void SetKeepAlive(bool keep_alive);
+  // 设置响应头（名称忽略大小写），已存在时替换
+  void SetHeader(std::string_view key, std::string_view value);
+  // 按编号设置常用响应头，O(1)
+  void SetHeader(HttpHeaderId id, std::string_view value);
   // 设置响应体
-  void SetBody(const std::string &body);
+  void SetBody(std::string_view body);
   // 构造完整http响应
   std::string BuildHttpResponse() const;
+  // 构造状态行和响应头（含结尾空行），与响应体分开发送
+  std::string BuildHeaders() const;
+  // 在resource中分配内存构造状态行和响应头，返回的内容由resource的使用者负责释放（通常是响应写完后复位的内存池）
+  std::string_view BuildHeaders(std::pmr::memory_resource *resource) const;
+  // 取走响应体，避免发送时再拷贝一次
+  std::pmr::string ReleaseBody();
+  // 以文件作为响应体，替代SetBody设置的内容；Content-Length取文件大小
+  void SetFileBody(std::shared_ptr<FileBody> file);
+  // 取走文件响应体，没有时返回nullptr
+  std::shared_ptr<FileBody> ReleaseFileBody();
+  // 以共享的只读内容作为响应体（如缓存中的静态资源），发送时不拷贝
+  void SetSharedBody(std::shared_ptr<const std::string> body);
+  // 取走共享响应体，没有时返回nullptr
+  std::shared_ptr<const std::string> ReleaseSharedBody();
+  // 由生产者流式生成响应体，替代SetBody设置的内容；length为响应体总长度，未知时由连接选择chunked编码
+  void SetBodyProducer(std::shared_ptr<ResponseBodyProducer> producer,
+                       size_t length = UNKNOWN_BODY_LENGTH);
+  // 是否为流式响应体，以及声明的长度
+  bool HasBodyProducer() const;
+  size_t BodyProducerLength() const;
+  // 取走流式响应体的生产者，没有时返回nullptr；响应头仍按流式响应体构造
+  std::shared_ptr<ResponseBodyProducer> ReleaseBodyProducer();
+  // 设置预先格式化好的响应头块（若干"Key: value\r\n"行），构造响应头时原样输出
+  void SetPrebuiltHeaders(std::shared_ptr<const std::string> headers);
 
 private:
-  std::string status_code_;                              // 状态码
-  std::unordered_map<std::string, std::string> headers_; // 响应头
-  std::string body_;                                     // 响应体
+  // fields_中的一段
+  struct Span {
+    uint32_t offset_ = 0;
+    uint32_t length_ = 0;
+  };
+  // 一个响应头，常用头部只记录编号，名称取标准写法
+  struct HeaderField {
+    HttpHeaderId id_ = HEADER_UNKNOWN;
+    Span name_;
+    Span value_;
+  };
+
+  size_t BodySize() const; // 响应体字节数
+  void ClearBodyProducer(); // 设置其他响应体时清除流式响应体
+  // 状态行和响应头的准确长度；content_length返回需要输出的Content-Length值的字符，不需要时为空
+  size_t HeadersSize(char *content_length, size_t *content_length_size) const;
+  // 把状态行和响应头写入out，out至少有HeadersSize字节，返回写入结束的位置
+  char *WriteHeaders(char *out, std::string_view content_length) const;
+  std::string_view View(Span span) const;
+  Span Store(std::string_view text); // 把text追加到fields_中
+  std::string_view FieldName(const HeaderField &field) const;
+
+  std::string status_code_;                              // 状态码和原因短语，没有原因短语时以空格结尾
+  std::string_view status_line_;  // 常见状态码预先格式化的状态行，为空时由status_code_构造
+  int status_ = 0;                // 数字状态码
+  std::string_view connection_;   // 预先格式化的Connection响应头行，为空时不输出
+  SmallVector<HeaderField, 8> headers_;      // 响应头，按设置顺序输出
+  uint16_t header_slots_[HEADER_COUNT] = {}; // 常用响应头的下标+1，0表示不存在
+  std::pmr::string fields_;  // 响应头名称和值的字节，替换响应头的值时旧值不回收
+  std::pmr::string body_;                                // 响应体
+  std::shared_ptr<FileBody> file_body_;                  // 文件响应体
+  std::shared_ptr<const std::string> shared_body_;       // 共享响应体
+  std::shared_ptr<const std::string> prebuilt_headers_;  // 预先格式化的响应头块
+  std::shared_ptr<ResponseBodyProducer> body_producer_;  // 流式响应体的生产者
+  bool streaming_ = false;                               // 是否为流式响应体
+  size_t producer_length_ = 0;                           // 流式响应体声明的长度
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "http_header.h"
+#include <strings.h>
+
+namespace {
+// 下标与HttpHeaderId一致
+constexpr std::string_view HEADER_NAMES[HEADER_COUNT] = {
+    "Host",
+    "Connection",
+    "Content-Length",
+    "Content-Type",
+    "Content-Encoding",
+    "Transfer-Encoding",
+    "Accept",
+    "Accept-Encoding",
+    "User-Agent",
+    "Cookie",
+    "Expect",
+    "If-None-Match",
+    "If-Modified-Since",
+    "Date",
+    "ETag",
+    "Last-Modified",
+    "Vary",
+    "Cache-Control",
+    "Retry-After",
+};
+} // namespace
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+/**
+ * @brief 按名称查找常用头部的编号
+ *
+ * 先比较长度和首字母，只有二者都相同时才做完整的忽略大小写比较，大多数候选在第一步就被排除。
+ *
+ * @param name 头部名称
+ * @return 头部编号，不是常用头部时返回HEADER_UNKNOWN
+ */
+HttpHeaderId LookupHeaderId(std::string_view name) {
+  if (name.empty()) {
+    return HEADER_UNKNOWN;
+  }
+  char first = static_cast<char>(name[0] | 0x20);
+  for (size_t i = 0; i < HEADER_COUNT; ++i) {
+    std::string_view candidate = HEADER_NAMES[i];
+    if (candidate.size() == name.size() && (candidate[0] | 0x20) == first &&
+        strncasecmp(candidate.data(), name.data(), name.size()) == 0) {
+      return static_cast<HttpHeaderId>(i);
+    }
+  }
+  return HEADER_UNKNOWN;
+}
+
+std::string_view HeaderIdName(HttpHeaderId id) {
+  return id < HEADER_COUNT ? HEADER_NAMES[id] : std::string_view();
+}
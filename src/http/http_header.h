@@ -0,0 +1,78 @@
+#ifndef HTTP_HEADER_H
+#define HTTP_HEADER_H
+#include "common.h"
+#include <iterator>
+
+// 常用头部的编号：解析请求头时识别出来，按编号直接定位，不需要逐个比较名称
+enum HttpHeaderId : uint8_t {
+  HEADER_HOST = 0,
+  HEADER_CONNECTION,
+  HEADER_CONTENT_LENGTH,
+  HEADER_CONTENT_TYPE,
+  HEADER_CONTENT_ENCODING,
+  HEADER_TRANSFER_ENCODING,
+  HEADER_ACCEPT,
+  HEADER_ACCEPT_ENCODING,
+  HEADER_USER_AGENT,
+  HEADER_COOKIE,
+  HEADER_EXPECT,
+  HEADER_IF_NONE_MATCH,
+  HEADER_IF_MODIFIED_SINCE,
+  HEADER_DATE,
+  HEADER_ETAG,
+  HEADER_LAST_MODIFIED,
+  HEADER_VARY,
+  HEADER_CACHE_CONTROL,
+  HEADER_RETRY_AFTER,
+  HEADER_COUNT,
+  HEADER_UNKNOWN = HEADER_COUNT // 不在上面列表中的头部
+};
+
+// 按名称（忽略大小写）查找头部编号，不是常用头部时返回HEADER_UNKNOWN
+HttpHeaderId LookupHeaderId(std::string_view name);
+// 头部编号对应的标准名称，HEADER_UNKNOWN返回空串
+std::string_view HeaderIdName(HttpHeaderId id);
+// 按ASCII忽略大小写比较
+bool EqualsIgnoreCase(std::string_view a, std::string_view b);
+
+// 小容量时元素保存在对象内部的顺序容器：请求通常只有十几个头部，不需要为此分配堆内存；
+// 超过N个元素后整体搬到堆上
+template <typename T, size_t N> class SmallVector {
+public:
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+  T &operator[](size_t index) { return Data()[index]; }
+  const T &operator[](size_t index) const { return Data()[index]; }
+  T *begin() { return Data(); }
+  T *end() { return Data() + size_; }
+  const T *begin() const { return Data(); }
+  const T *end() const { return Data() + size_; }
+
+  void PushBack(T value) {
+    if (size_ < N) {
+      inline_[size_] = std::move(value);
+    } else {
+      if (size_ == N) {
+        heap_.reserve(N * 2);
+        std::move(inline_, inline_ + N, std::back_inserter(heap_));
+      }
+      heap_.push_back(std::move(value));
+    }
+    ++size_;
+  }
+
+  void Clear() {
+    size_ = 0;
+    heap_.clear();
+  }
+
+private:
+  T *Data() { return size_ > N ? heap_.data() : inline_; }
+  const T *Data() const { return size_ > N ? heap_.data() : inline_; }
+
+  T inline_[N];         // 前N个元素
+  std::vector<T> heap_; // 超过N个元素时的全部元素
+  size_t size_ = 0;     // 元素个数
+};
+
+#endif
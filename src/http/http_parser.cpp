@@ -0,0 +1,489 @@
+#include "http_parser.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+// 返回[p, end)中第一个等于a或b的字节，没有返回end。
+// 编译时启用AVX2（-mavx2或-march=native）时每次比较32字节，x86-64默认的SSE2每次16字节
+inline const char *FindEither(const char *p, const char *end, char a, char b) {
+#if defined(__AVX2__)
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  for (; end - p >= 32; p += 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb))));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i sa = _mm_set1_epi8(a);
+  const __m128i sb = _mm_set1_epi8(b);
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, sa), _mm_cmpeq_epi8(chunk, sb))));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    if (*p == a || *p == b) {
+      return p;
+    }
+  }
+  return end;
+}
+
+// RFC 9110 token字符（方法名和请求头名称）
+inline bool IsTokenChar(unsigned char c) {
+  if ((c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')) {
+    return true;
+  }
+  return c != '\0' && strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+bool IsToken(const char *begin, const char *end) {
+  if (begin == end) {
+    return false;
+  }
+  for (const char *p = begin; p < end; ++p) {
+    if (!IsTokenChar(static_cast<unsigned char>(*p))) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+HttpParser::HttpParser(std::pmr::memory_resource *resource)
+    : state_(kHead), scanned_(0), head_len_(0), chunked_(false), stream_(false),
+      remaining_(0), body_size_(0), trailer_size_(0),
+      max_body_size_(DEFAULT_MAX_BODY_SIZE), resource_(resource),
+      request_(resource) {}
+
+void HttpParser::Reset() {
+  state_ = kHead;
+  scanned_ = 0;
+  head_len_ = 0;
+  chunked_ = false;
+  stream_ = false;
+  remaining_ = 0;
+  body_size_ = 0;
+  trailer_size_ = 0;
+  body_data_ = std::string_view();
+  request_ = HttpRequest(resource_);
+}
+
+bool HttpParser::InProgress() const { return state_ != kHead; }
+
+/**
+ * @brief 把正在解析的请求移出内存资源
+ *
+ * 请求头和已缓存的请求体拷贝到返回值中，原来的内存在资源复位之前归还，各字段按偏移量记录，不受影响。
+ *
+ * @return 请求的原始字节
+ */
+std::string HttpParser::DetachRequest() {
+  std::string raw(request_.raw_.data(), request_.raw_.size());
+  std::pmr::string(resource_).swap(request_.raw_);
+  return raw;
+}
+
+/**
+ * @brief 把DetachRequest移出的字节放回请求中
+ *
+ * 正在缓存定长请求体时按剩余长度一并预留，后续追加不再扩容。
+ *
+ * @param raw DetachRequest的返回值
+ */
+void HttpParser::AttachRequest(std::string_view raw) {
+  if (state_ == kFixedBody && !stream_) {
+    request_.raw_.reserve(raw.size() + remaining_);
+  }
+  request_.raw_.assign(raw.data(), raw.size());
+}
+
+void HttpParser::SetMaxBodySize(size_t max_body_size) {
+  // 请求体与请求头保存在同一块内存中，用32位偏移量访问
+  max_body_size_ = std::min<size_t>(max_body_size, UINT32_MAX - MAX_HEADER_SIZE);
+}
+
+std::string_view HttpParser::BodyData() const { return body_data_; }
+
+HttpRequest &HttpParser::Request() { return request_; }
+
+HttpRequest HttpParser::TakeRequest() {
+  HttpRequest request = std::move(request_);
+  Reset();
+  return request;
+}
+
+/**
+ * @brief 查找请求头结束标记
+ *
+ * 只查找LF，命中后再检查前后是否构成"\r\n\r\n"，请求头中LF的个数等于行数，比逐字节比较快得多。
+ *
+ * @param data 数据起始地址
+ * @param len 数据长度
+ * @param from 开始扫描的位置，之前的字节已确认不含结束标记
+ * @return 请求头长度（含结束标记），没有找到返回0
+ */
+size_t HttpParser::FindHeadEnd(const char *data, size_t len, size_t from) {
+  // 结束标记可能跨越上次扫描的边界，回退3个字节
+  const char *p = data + (from > 3 ? from - 3 : 0);
+  const char *end = data + len;
+  while (true) {
+    p = FindEither(p, end, '\n', '\n');
+    if (p == end) {
+      return 0;
+    }
+    // p指向"\r\n\r\n"中的第一个LF
+    if (p > data && p[-1] == '\r' && end - p >= 3 && p[1] == '\r' &&
+        p[2] == '\n') {
+      return p + 3 - data;
+    }
+    ++p;
+  }
+}
+
+/**
+ * @brief 解析请求行和请求头
+ *
+ * 每行必须以CRLF结尾；请求行为"方法 SP 目标 SP 版本"，方法为token，版本以"HTTP/"开头；
+ * 请求头名称为token且与冒号之间不能有空白，值去掉两端的空格和制表符。
+ * 不支持已废弃的多行折叠头（以空白开头的续行），按非法请求处理。
+ *
+ * @param request raw_中保存了请求头的请求
+ * @param head_len 请求头长度（含结束标记）
+ * @return 格式正确返回true
+ */
+bool HttpParser::ParseHead(HttpRequest *request, size_t head_len) {
+  const char *base = request->raw_.data();
+  const char *end = base + head_len - 2; // 不含最后的空行
+  auto span = [base](const char *begin, const char *stop) {
+    HttpRequest::Span result;
+    result.offset_ = static_cast<uint32_t>(begin - base);
+    result.length_ = static_cast<uint32_t>(stop - begin);
+    return result;
+  };
+
+  // 请求行
+  const char *line_end = FindEither(base, end, '\n', '\n');
+  if (line_end == end || line_end == base || line_end[-1] != '\r') {
+    return false;
+  }
+  const char *cr = line_end - 1;
+  const char *method_end = FindEither(base, cr, ' ', ' ');
+  if (method_end == cr || !IsToken(base, method_end)) {
+    return false;
+  }
+  const char *target = method_end + 1;
+  const char *target_end = FindEither(target, cr, ' ', ' ');
+  if (target_end == cr || target_end == target) {
+    return false;
+  }
+  const char *version = target_end + 1;
+  if (cr - version < 8 || memcmp(version, "HTTP/", 5) != 0 ||
+      FindEither(version, cr, ' ', '\t') != cr) {
+    return false;
+  }
+  request->method_ = span(base, method_end);
+  request->path_ = span(target, target_end);
+  request->version_ = span(version, cr);
+
+  // 请求头
+  request->ClearHeaders();
+  const char *p = line_end + 1;
+  while (p < end) {
+    const char *colon = FindEither(p, end, ':', '\n');
+    if (colon == end || *colon != ':' || !IsToken(p, colon)) {
+      return false;
+    }
+    line_end = FindEither(colon, end, '\n', '\n');
+    if (line_end == end || line_end[-1] != '\r') {
+      return false;
+    }
+    const char *value = colon + 1;
+    const char *value_end = line_end - 1;
+    while (value < value_end && (*value == ' ' || *value == '\t')) {
+      ++value;
+    }
+    while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+      --value_end;
+    }
+    request->AddHeader(span(p, colon), span(value, value_end));
+    p = line_end + 1;
+  }
+  return true;
+}
+
+/**
+ * @brief 根据请求头确定请求体的分帧方式
+ *
+ * 同时带有Transfer-Encoding和Content-Length、Transfer-Encoding不是chunked、
+ * 多个Content-Length取值不一致时都按非法请求处理，避免与前端代理对请求边界的理解不一致（请求走私）。
+ *
+ * @return 请求头合法返回true
+ */
+bool HttpParser::ParseFraming() {
+  std::string_view transfer_encoding;
+  std::string_view content_length;
+  for (size_t i = 0; i < request_.HeaderCount(); ++i) {
+    HttpHeaderId id = request_.HeaderId(i);
+    if (id == HEADER_TRANSFER_ENCODING) {
+      if (!transfer_encoding.empty()) {
+        return false;
+      }
+      transfer_encoding = request_.HeaderValue(i);
+    } else if (id == HEADER_CONTENT_LENGTH) {
+      std::string_view value = request_.HeaderValue(i);
+      if (!content_length.empty() && value != content_length) {
+        return false;
+      }
+      content_length = value;
+    }
+  }
+  if (!transfer_encoding.empty()) {
+    if (!content_length.empty() ||
+        !EqualsIgnoreCase(transfer_encoding, "chunked")) {
+      return false;
+    }
+    chunked_ = true;
+    state_ = kBodyPending;
+    return true;
+  }
+  if (content_length.empty()) {
+    state_ = kDone;
+    return true;
+  }
+  // 最多19位十进制数，不会溢出uint64_t
+  if (content_length.size() > 19) {
+    return false;
+  }
+  uint64_t value = 0;
+  for (char c : content_length) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    value = value * 10 + (c - '0');
+  }
+  remaining_ = value;
+  state_ = value == 0 ? kDone : kBodyPending;
+  return true;
+}
+
+HttpRequest::ParseStatus HttpParser::StartBody(bool stream) {
+  if (state_ != kBodyPending) {
+    return HttpRequest::PARSE_INCOMPLETE;
+  }
+  stream_ = stream;
+  if (chunked_) {
+    state_ = kChunkSize;
+    return HttpRequest::PARSE_INCOMPLETE;
+  }
+  if (!stream_) {
+    if (remaining_ > max_body_size_) {
+      return HttpRequest::PARSE_TOO_LARGE;
+    }
+    request_.raw_.reserve(head_len_ + remaining_);
+  }
+  state_ = kFixedBody;
+  return HttpRequest::PARSE_INCOMPLETE;
+}
+
+/**
+ * @brief 从data[*pos]开始消费一行
+ *
+ * 用于chunk大小行和trailer行，行必须以CRLF结尾，长度不超过MAX_HEADER_SIZE。
+ *
+ * @param data 未消费数据的起始地址
+ * @param len 未消费数据的长度
+ * @param pos 当前位置，成功时前移到下一行开头
+ * @param line 成功时返回行内容，不含CRLF
+ * @param error 格式非法时置为true
+ * @return 得到完整的一行返回true
+ */
+bool HttpParser::TakeLine(const char *data, size_t len, size_t *pos,
+                          std::string_view *line, bool *error) {
+  const char *begin = data + *pos;
+  const char *end = data + len;
+  const char *lf = FindEither(begin, end, '\n', '\n');
+  if (lf == end) {
+    *error = static_cast<size_t>(end - begin) > MAX_HEADER_SIZE;
+    return false;
+  }
+  if (lf == begin || lf[-1] != '\r') {
+    *error = true;
+    return false;
+  }
+  *line = std::string_view(begin, lf - 1 - begin);
+  *pos = lf + 1 - data;
+  return true;
+}
+
+/**
+ * @brief 解析请求体
+ *
+ * 缓存方式下把当前可用的请求体全部追加到请求中；流式方式下每次返回一段，直接指向data，不拷贝。
+ * chunked编码的chunk扩展和trailer字段被忽略。
+ *
+ * @param data 未消费数据的起始地址
+ * @param len 未消费数据的长度
+ * @param pos 已消费的字节数，返回时前移
+ * @return 解析结果
+ */
+HttpRequest::ParseStatus HttpParser::ParseBody(const char *data, size_t len,
+                                               size_t *pos) {
+  while (state_ != kDone) {
+    switch (state_) {
+    case kFixedBody:
+    case kChunkData: {
+      size_t n =
+          static_cast<size_t>(std::min<uint64_t>(remaining_, len - *pos));
+      if (n == 0) {
+        return HttpRequest::PARSE_INCOMPLETE;
+      }
+      if (stream_) {
+        body_data_ = std::string_view(data + *pos, n);
+      } else {
+        if (body_size_ + n > max_body_size_) {
+          return HttpRequest::PARSE_TOO_LARGE;
+        }
+        request_.raw_.append(data + *pos, n);
+        body_size_ += n;
+      }
+      *pos += n;
+      remaining_ -= n;
+      if (remaining_ == 0) {
+        state_ = state_ == kFixedBody ? kDone : kChunkEnd;
+      }
+      if (stream_ && state_ != kDone) {
+        return HttpRequest::PARSE_BODY_DATA;
+      }
+      break;
+    }
+    case kChunkEnd:
+      if (len - *pos < 2) {
+        return HttpRequest::PARSE_INCOMPLETE;
+      }
+      if (data[*pos] != '\r' || data[*pos + 1] != '\n') {
+        return HttpRequest::PARSE_ERROR;
+      }
+      *pos += 2;
+      state_ = kChunkSize;
+      break;
+    case kChunkSize: {
+      std::string_view line;
+      bool error = false;
+      if (!TakeLine(data, len, pos, &line, &error)) {
+        return error ? HttpRequest::PARSE_ERROR
+                     : HttpRequest::PARSE_INCOMPLETE;
+      }
+      // chunk大小为十六进制，后面可以跟";"开头的扩展，最多15位不会溢出
+      uint64_t size = 0;
+      size_t digits = 0;
+      for (; digits < line.size() && isxdigit(static_cast<unsigned char>(
+                                         line[digits]));
+           ++digits) {
+        char c = static_cast<char>(tolower(line[digits]));
+        size = size * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+      }
+      if (digits == 0 || digits > 15 ||
+          (digits < line.size() && line[digits] != ';' &&
+           line[digits] != ' ' && line[digits] != '\t')) {
+        return HttpRequest::PARSE_ERROR;
+      }
+      remaining_ = size;
+      state_ = size == 0 ? kTrailer : kChunkData;
+      break;
+    }
+    case kTrailer: {
+      std::string_view line;
+      bool error = false;
+      size_t begin = *pos;
+      if (!TakeLine(data, len, pos, &line, &error)) {
+        return error ? HttpRequest::PARSE_ERROR
+                     : HttpRequest::PARSE_INCOMPLETE;
+      }
+      trailer_size_ += *pos - begin;
+      if (trailer_size_ > MAX_HEADER_SIZE) {
+        return HttpRequest::PARSE_ERROR;
+      }
+      if (line.empty()) {
+        state_ = kDone;
+      }
+      break;
+    }
+    default:
+      return HttpRequest::PARSE_ERROR;
+    }
+  }
+  return HttpRequest::PARSE_COMPLETE;
+}
+
+HttpRequest::ParseStatus HttpParser::Finish(HttpRequest *request) {
+  if (!stream_) {
+    request_.body_.offset_ = static_cast<uint32_t>(head_len_);
+    request_.body_.length_ = static_cast<uint32_t>(body_size_);
+  }
+  std::string_view body_data = body_data_;
+  *request = TakeRequest();
+  body_data_ = body_data;
+  return HttpRequest::PARSE_COMPLETE;
+}
+
+/**
+ * @brief 增量解析一个请求
+ *
+ * 先定位请求头结束标记，找到后把请求头拷贝进请求对象（每个请求只分配一次）并解析各字段；
+ * 请求带有请求体时返回PARSE_HEAD_COMPLETE，由调用方选择接收方式后继续解析请求体。
+ * 缓冲区中多出的字节属于后续请求，不会被消费。
+ *
+ * @param data 未消费数据的起始地址
+ * @param len 未消费数据的长度
+ * @param request 完成时接收解析出的请求
+ * @param consumed 返回本次消费的字节数
+ * @return 解析结果
+ */
+HttpRequest::ParseStatus HttpParser::Parse(const char *data, size_t len,
+                                           HttpRequest *request,
+                                           size_t *consumed) {
+  *consumed = 0;
+  body_data_ = std::string_view();
+  if (state_ == kHead) {
+    head_len_ = FindHeadEnd(data, len, scanned_);
+    if (head_len_ == 0) {
+      scanned_ = len;
+      return len > MAX_HEADER_SIZE ? HttpRequest::PARSE_ERROR
+                                   : HttpRequest::PARSE_INCOMPLETE;
+    }
+    if (head_len_ > MAX_HEADER_SIZE) {
+      return HttpRequest::PARSE_ERROR;
+    }
+    request_.raw_.assign(data, head_len_);
+    if (!ParseHead(&request_, head_len_) || !ParseFraming()) {
+      return HttpRequest::PARSE_ERROR;
+    }
+    *consumed = head_len_;
+    if (state_ == kDone) {
+      return Finish(request);
+    }
+    return HttpRequest::PARSE_HEAD_COMPLETE;
+  }
+  if (state_ == kBodyPending) {
+    HttpRequest::ParseStatus status = StartBody(false);
+    if (status != HttpRequest::PARSE_INCOMPLETE) {
+      return status;
+    }
+  }
+  HttpRequest::ParseStatus status = ParseBody(data, len, consumed);
+  if (status == HttpRequest::PARSE_COMPLETE) {
+    return Finish(request);
+  }
+  return status;
+}
@@ -0,0 +1,87 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+#include "common.h"
+#include "http_conn.h"
+
+// HTTP/1.1请求的增量解析器：跨多次读取保存扫描进度，数据不足时返回PARSE_INCOMPLETE，
+// 读到更多数据后从上次停止的位置继续，不重复扫描已检查过的字节。
+// 分隔符（CR、LF、冒号）用SSE2/AVX2一次比较16/32字节查找。
+// 请求体按Content-Length或chunked编码分帧，可以完整缓存在请求中，也可以逐段交给调用方（流式接收）。
+// 解析出的请求从resource分配内存，调用方接收请求的HttpRequest应使用同一个resource，移入时不需要拷贝。
+class HttpParser {
+public:
+  explicit HttpParser(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  // 解析data中的下一个请求。data为连接缓冲区中尚未消费的数据，consumed返回本次消费的字节数，
+  // 调用方应先从缓冲区移除这些字节再进行下一次调用。返回值：
+  //   PARSE_COMPLETE：请求完整，移入request，解析器复位以解析下一个请求；
+  //                   流式接收时BodyData()可能还有最后一段请求体
+  //   PARSE_HEAD_COMPLETE：请求带有请求体，Request()中的请求头可用，调用方可在此时调用StartBody选择接收方式
+  //   PARSE_BODY_DATA：流式接收时得到一段请求体，由BodyData()返回，指向data内部
+  HttpRequest::ParseStatus Parse(const char *data, size_t len,
+                                 HttpRequest *request, size_t *consumed);
+  // 请求头解析完成后选择请求体的接收方式：stream为true时请求体逐段交给调用方，不受最大长度限制；
+  // 否则完整缓存在请求中，Content-Length超过最大长度时返回PARSE_TOO_LARGE。
+  // 不调用时按缓存方式接收
+  HttpRequest::ParseStatus StartBody(bool stream);
+  // 流式接收时最近一次Parse得到的请求体片段
+  std::string_view BodyData() const;
+  // 正在解析的请求（请求头解析完成后可用）
+  HttpRequest &Request();
+  // 取出正在解析的请求并复位，用于请求体未接收完就结束的请求
+  HttpRequest TakeRequest();
+  // 设置缓存请求体的最大长度
+  void SetMaxBodySize(size_t max_body_size);
+  // 丢弃解析进度
+  void Reset();
+  // 是否正在解析一个请求（已收到请求头，请求尚未完整）
+  bool InProgress() const;
+  // 把正在解析的请求的原始字节移出内存资源并返回，内存资源复位之前调用
+  std::string DetachRequest();
+  // 内存资源复位后把DetachRequest返回的字节移回，继续解析
+  void AttachRequest(std::string_view raw);
+
+  // 从from开始查找请求头结束标记"\r\n\r\n"，返回请求头长度（含结束标记），没有找到返回0
+  static size_t FindHeadEnd(const char *data, size_t len, size_t from);
+  // 解析request中前head_len字节的请求行和请求头
+  static bool ParseHead(HttpRequest *request, size_t head_len);
+
+private:
+  // 解析状态
+  enum State {
+    kHead,        // 等待请求头
+    kBodyPending, // 请求头已解析，等待选择请求体的接收方式
+    kFixedBody,   // 按Content-Length接收请求体
+    kChunkSize,   // 等待chunk大小行
+    kChunkData,   // 接收chunk数据
+    kChunkEnd,    // 等待chunk数据后的CRLF
+    kTrailer,     // 等待trailer字段和结尾空行
+    kDone         // 请求完整
+  };
+
+  // 根据Transfer-Encoding和Content-Length确定请求体的分帧方式
+  bool ParseFraming();
+  // 解析请求体，返回PARSE_INCOMPLETE、PARSE_BODY_DATA、PARSE_COMPLETE或错误
+  HttpRequest::ParseStatus ParseBody(const char *data, size_t len, size_t *pos);
+  // 消费一行（chunk大小行或trailer行），不含CRLF；行不完整时返回false
+  bool TakeLine(const char *data, size_t len, size_t *pos,
+                std::string_view *line, bool *error);
+  // 请求完整，移出请求并复位
+  HttpRequest::ParseStatus Finish(HttpRequest *request);
+
+  State state_;           // 解析状态
+  size_t scanned_;        // 已扫描过、确认不含请求头结束标记的字节数
+  size_t head_len_;       // 请求头长度
+  bool chunked_;          // 请求体是否使用chunked编码
+  bool stream_;           // 是否流式接收请求体
+  uint64_t remaining_;    // 当前请求体（或当前chunk）剩余的字节数
+  size_t body_size_;      // 已缓存的请求体字节数
+  size_t trailer_size_;   // 已接收的trailer字节数
+  size_t max_body_size_;  // 缓存请求体的最大长度
+  std::string_view body_data_; // 流式接收时最近得到的请求体片段
+  std::pmr::memory_resource *resource_; // 请求使用的内存资源
+  HttpRequest request_;   // 正在解析的请求
+};
+
+#endif
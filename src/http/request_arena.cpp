@@ -0,0 +1,144 @@
+#include "request_arena.h"
+#include <new>
+
+namespace {
+// 把n向上对齐到alignment（2的幂）
+inline size_t AlignUp(size_t n, size_t alignment) {
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+RequestArena::RequestArena(size_t block_size)
+    : block_size_(block_size), blocks_(nullptr), cursor_(nullptr),
+      limit_(nullptr), large_(nullptr), allocated_(0) {}
+
+RequestArena::~RequestArena() {
+  FreeLargeBlocks();
+  FreeBlocks();
+}
+
+size_t RequestArena::BytesAllocated() const { return allocated_; }
+
+/**
+ * @brief 从当前内存块中顺序切分内存
+ *
+ * 第一次分配时才申请内存块，从未处理过请求的连接不占用内存池。
+ *
+ * @param bytes 字节数
+ * @param alignment 对齐要求
+ * @return 分配的内存
+ */
+void *RequestArena::do_allocate(size_t bytes, size_t alignment) {
+  allocated_ += bytes;
+  if (bytes > block_size_ / 2) {
+    return AllocateLarge(bytes, alignment);
+  }
+  char *p = reinterpret_cast<char *>(
+      AlignUp(reinterpret_cast<uintptr_t>(cursor_), alignment));
+  if (cursor_ == nullptr || p + bytes > limit_) {
+    AddBlock(bytes + alignment);
+    p = reinterpret_cast<char *>(
+        AlignUp(reinterpret_cast<uintptr_t>(cursor_), alignment));
+  }
+  cursor_ = p + bytes;
+  return p;
+}
+
+/**
+ * @brief 释放内存
+ *
+ * 切分出的小块内存在Reset时统一回收，这里只归还单独申请的大块内存。
+ */
+void RequestArena::do_deallocate(void *p, size_t bytes, size_t alignment) {
+  if (bytes <= block_size_ / 2) {
+    return;
+  }
+  LargeBlock *block = reinterpret_cast<LargeBlock *>(
+      static_cast<char *>(p) - LargeHeaderSize(alignment));
+  if (block->prev_) {
+    block->prev_->next_ = block->next_;
+  } else {
+    large_ = block->next_;
+  }
+  if (block->next_) {
+    block->next_->prev_ = block->prev_;
+  }
+  ::operator delete(block, std::align_val_t(block->alignment_));
+}
+
+bool RequestArena::do_is_equal(
+    const std::pmr::memory_resource &other) const noexcept {
+  return this == &other;
+}
+
+void RequestArena::AddBlock(size_t min_size) {
+  size_t size = std::max(block_size_, min_size);
+  Block *block = static_cast<Block *>(::operator new(sizeof(Block) + size));
+  block->next_ = blocks_;
+  block->size_ = size;
+  blocks_ = block;
+  cursor_ = reinterpret_cast<char *>(block + 1);
+  limit_ = cursor_ + size;
+}
+
+size_t RequestArena::LargeHeaderSize(size_t alignment) {
+  return AlignUp(sizeof(LargeBlock),
+                 std::max(alignment, alignof(std::max_align_t)));
+}
+
+void *RequestArena::AllocateLarge(size_t bytes, size_t alignment) {
+  size_t align = std::max(alignment, alignof(std::max_align_t));
+  size_t header = LargeHeaderSize(alignment);
+  LargeBlock *block = static_cast<LargeBlock *>(
+      ::operator new(header + bytes, std::align_val_t(align)));
+  block->prev_ = nullptr;
+  block->next_ = large_;
+  block->alignment_ = align;
+  if (large_) {
+    large_->prev_ = block;
+  }
+  large_ = block;
+  return reinterpret_cast<char *>(block) + header;
+}
+
+/**
+ * @brief 复位内存池
+ *
+ * 只用了一个内存块时原样保留；用了多个内存块时合并成一个总大小相同的内存块（不超过ARENA_MAX_RETAINED），
+ * 下一轮同样规模的请求只需要一个内存块。尚未释放的大块内存一并归还。
+ */
+void RequestArena::Reset() {
+  allocated_ = 0;
+  FreeLargeBlocks();
+  if (blocks_ == nullptr) {
+    return;
+  }
+  if (blocks_->next_ == nullptr) {
+    cursor_ = reinterpret_cast<char *>(blocks_ + 1);
+    return;
+  }
+  size_t total = 0;
+  for (Block *block = blocks_; block; block = block->next_) {
+    total += block->size_;
+  }
+  FreeBlocks();
+  AddBlock(std::min(total, ARENA_MAX_RETAINED));
+}
+
+void RequestArena::FreeBlocks() {
+  while (blocks_) {
+    Block *next = blocks_->next_;
+    ::operator delete(blocks_);
+    blocks_ = next;
+  }
+  cursor_ = nullptr;
+  limit_ = nullptr;
+}
+
+void RequestArena::FreeLargeBlocks() {
+  while (large_) {
+    LargeBlock *next = large_->next_;
+    ::operator delete(large_, std::align_val_t(large_->alignment_));
+    large_ = next;
+  }
+}
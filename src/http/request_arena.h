@@ -0,0 +1,58 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+#include "common.h"
+#include <memory_resource>
+
+constexpr size_t ARENA_BLOCK_SIZE = 4096;           // 内存池每个内存块的默认大小
+constexpr size_t ARENA_MAX_RETAINED = 64 * 1024;    // 复位时最多保留的内存块大小
+
+// 连接级的单调内存池：处理一个请求期间的小块内存（请求头副本、响应头、响应体等）从当前内存块中
+// 顺序切分，释放时不回收，响应写完后由Reset一次性复位。复位时保留一个内存块，大小按上一轮的用量调整，
+// 稳态下处理请求不再调用malloc。超过块大小一半的分配（如缓存的大请求体）单独向上游申请，
+// 释放时立即归还，请求体反复扩容时不会占用多份内存。
+// 不是线程安全的，只能在连接所属的事件循环线程中使用。
+class RequestArena : public std::pmr::memory_resource {
+public:
+  explicit RequestArena(size_t block_size = ARENA_BLOCK_SIZE);
+  ~RequestArena() override;
+
+  RequestArena(const RequestArena &) = delete;
+  RequestArena &operator=(const RequestArena &) = delete;
+
+  // 释放本轮分配的全部内存，之前分配的内存都不能再使用
+  void Reset();
+  // 本轮已分配的字节数（不含对齐填充）
+  size_t BytesAllocated() const;
+
+private:
+  // 内存块头部，数据紧跟其后
+  struct Block {
+    Block *next_; // 上一个内存块
+    size_t size_; // 数据区字节数
+  };
+  // 单独申请的大块内存头部，组成双向链表，释放时O(1)摘除
+  struct LargeBlock {
+    LargeBlock *prev_;
+    LargeBlock *next_;
+    size_t alignment_; // 申请时使用的对齐，归还时需要
+  };
+
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+  void AddBlock(size_t min_size);        // 申请新的内存块作为当前块
+  void *AllocateLarge(size_t bytes, size_t alignment);
+  static size_t LargeHeaderSize(size_t alignment); // 大块内存头部占用的字节数（保持数据对齐）
+  void FreeBlocks();                     // 归还全部内存块
+  void FreeLargeBlocks();                // 归还全部大块内存
+
+  size_t block_size_;            // 新内存块的最小大小
+  Block *blocks_;                // 当前内存块，next_串起之前的内存块
+  char *cursor_;                 // 当前内存块中下一次分配的位置
+  char *limit_;                  // 当前内存块的末尾
+  LargeBlock *large_;            // 尚未释放的大块内存
+  size_t allocated_;             // 本轮已分配的字节数
+};
+
+#endif
@@ -1,7 +1,8 @@
 #include "logger.h"
+#include "thread_name.h"
 
 Logger::Logger(const std::string &log_file_name, bool async)
-    : running_(true), async_(async) {
+    : running_(true), async_(async), min_severity_(Severity(INFO)) {
   log_file_.open(log_file_name, std::ios::app);
   if (!log_file_.is_open()) {
     throw std::runtime_error("Failed to open log file: " + log_file_name);
@@ -29,8 +30,10 @@ std::string Logger::FormatLog(LogLevel level, const std::string &message) {
   std::ostringstream oss;
   auto now = std::chrono::system_clock::now();
   auto time = std::chrono::system_clock::to_time_t(now);
-  oss << "[" << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S")
-      << "] ";
+  // localtime返回共享的静态缓冲区，多个线程同时写日志时使用可重入的localtime_r
+  struct tm local_time;
+  localtime_r(&time, &local_time);
+  oss << "[" << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S") << "] ";
   switch (level) {
   case INFO:
     oss << "[INFO] ";
@@ -49,7 +52,32 @@ std::string Logger::FormatLog(LogLevel level, const std::string &message) {
   return oss.str();
 }
 
+int Logger::Severity(LogLevel level) {
+  switch (level) {
+  case DEBUG:
+    return 0;
+  case INFO:
+    return 1;
+  case WARN:
+    return 2;
+  case ERROR:
+    return 3;
+  }
+  return 3;
+}
+
+void Logger::SetLevel(LogLevel level) {
+  min_severity_.store(Severity(level), std::memory_order_relaxed);
+}
+
+bool Logger::IsEnabled(LogLevel level) const {
+  return Severity(level) >= min_severity_.load(std::memory_order_relaxed);
+}
+
 void Logger::Log(LogLevel level, const std::string &message) {
+  if (!IsEnabled(level)) {
+    return;
+  }
   std::string format_log = FormatLog(level, message);
   if (async_) {
     std::unique_lock<std::mutex> lock(log_queue_mutex_);
@@ -61,6 +89,7 @@ void Logger::Log(LogLevel level, const std::string &message) {
 }
 
 void Logger::AsyncWriteLog(){
+  SetCurrentThreadName("log-writer");
   while(running_.load()){
     std::unique_lock<std::mutex> lock(log_queue_mutex_);
     log_queue_cond_.wait(lock,[this](){
@@ -18,6 +18,10 @@ public:
 
   // 记录日志
   void Log(LogLevel level, const std::string &message);
+  // 设置最低记录级别（DEBUG < INFO < WARN < ERROR），低于该级别的日志直接丢弃，默认INFO
+  void SetLevel(LogLevel level);
+  // 该级别的日志是否会被记录；请求路径上的调用方先检查，避免为不记录的日志拼接字符串
+  bool IsEnabled(LogLevel level) const;
 
 private:
   Logger(const std::string &log_file_name, bool async = true);
@@ -25,6 +29,7 @@ private:
 
   void AsyncWriteLog();
   std::string FormatLog(LogLevel level, const std::string &message);
+  static int Severity(LogLevel level); // 级别的严重程度，越大越严重
 
   std::ofstream log_file_;                 // 日志文件
   std::atomic<bool> running_;              // 日志对象是否在运行
@@ -33,6 +38,7 @@ private:
   std::mutex log_queue_mutex_;             // 日志队列互斥锁
   std::condition_variable log_queue_cond_; // 日志队列条件变量
   bool async_;                             // 是否异步写入日志
+  std::atomic<int> min_severity_;          // 最低记录级别的严重程度
 };
 
 #endif
\ No newline at end of file
@@ -3,18 +3,38 @@
 #include "user_manager.h"
 #include "logger.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
         Logger& logger = Logger::GetInstance(LOGFILE);
         logger.Log(Logger::INFO, "Server initializing...");
 
+        // --cpu-affinity none|compact|scatter|<CPU列表>：事件循环线程和工作线程的CPU绑定，默认不绑定
+        CpuAffinity affinity;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--cpu-affinity" && i + 1 < argc) {
+                affinity = CpuAffinity::Parse(argv[++i]);
+            } else if (arg.compare(0, 15, "--cpu-affinity=") == 0) {
+                affinity = CpuAffinity::Parse(arg.substr(15));
+            } else {
+                throw std::runtime_error("Unknown argument: " + arg);
+            }
+        }
+
         ConnectionPool& pool = ConnectionPool::GetInstance();
         pool.Init("127.0.0.1", 3306, "root", "your_password", "webserver", 4, 10, 3600);
 
         SqlDatabase db_op(pool);
         UserManager user_manager(db_op);
 
-        Server server("0.0.0.0", 8080, user_manager);
+        // 每个CPU核心一个事件循环
+        size_t reactor_count = std::max(1u, std::thread::hardware_concurrency());
+        Server server("0.0.0.0", 8080, user_manager, 4, reactor_count, affinity);
+        server.SetMaxConnections(10000);
+        // 单个客户端的连接数和登录、注册频率，超过时回复429，不访问数据库
+        server.SetMaxConnectionsPerIp(256);
+        server.SetRateLimit("/login", "POST", 5, 10);
+        server.SetRateLimit("/register", "POST", 1, 5);
         Router& router = server.GetRouter();
         router.InitRouter(user_manager);
 
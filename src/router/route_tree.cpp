@@ -0,0 +1,207 @@
+#include "route_tree.h"
+
+namespace {
+constexpr size_t NO_ROUTE = static_cast<size_t>(-1);
+
+// pattern[pos]是否为参数或通配符的开始（只能出现在路径段的开头）
+inline bool IsCaptureStart(std::string_view pattern, size_t pos) {
+  return (pattern[pos] == ':' || pattern[pos] == '*') && pos > 0 &&
+         pattern[pos - 1] == '/';
+}
+
+[[noreturn]] void InvalidPattern(std::string_view pattern, const char *reason) {
+  throw std::runtime_error("Invalid route pattern '" + std::string(pattern) +
+                           "': " + reason);
+}
+} // namespace
+
+// 树节点：静态节点匹配prefix_，参数和通配符节点的prefix_为空，匹配内容由父节点截取
+struct RouteTree::Node {
+  std::string prefix_;                          // 本节点匹配的静态字节
+  std::string indices_;                         // 每个静态子节点prefix_的首字节，与children_一一对应
+  std::vector<std::unique_ptr<Node>> children_; // 静态子节点，首字节互不相同
+  std::unique_ptr<Node> param_;                 // ":name"子节点
+  std::unique_ptr<Node> wildcard_;              // "*name"子节点
+  std::string name_;                            // 参数或通配符节点的参数名
+  size_t route_ = NO_ROUTE;                     // 在此结束的路由编号
+};
+
+RouteTree::RouteTree() : root_(new Node) {}
+
+RouteTree::~RouteTree() = default;
+
+RouteTree::RouteTree(RouteTree &&) noexcept = default;
+
+RouteTree &RouteTree::operator=(RouteTree &&) noexcept = default;
+
+bool RouteTree::Empty() const {
+  return root_->children_.empty() && root_->route_ == NO_ROUTE;
+}
+
+/**
+ * @brief 注册路由模式
+ *
+ * 模式按静态段、":name"和"*name"切分：静态段并入前缀树，参数和通配符各自作为当前节点的特殊子节点。
+ * 同一位置只能有一个参数名，否则同一路径会得到含义不同的参数。
+ *
+ * @param pattern 路由模式
+ * @param route 路由编号
+ */
+void RouteTree::Insert(std::string_view pattern, size_t route) {
+  if (pattern.empty() || pattern[0] != '/') {
+    InvalidPattern(pattern, "must start with '/'");
+  }
+  Node *node = root_.get();
+  size_t params = 0;
+  size_t pos = 0;
+  while (pos < pattern.size()) {
+    if (!IsCaptureStart(pattern, pos)) {
+      size_t end = pos + 1;
+      while (end < pattern.size() && !IsCaptureStart(pattern, end)) {
+        ++end;
+      }
+      node = InsertStatic(node, pattern.substr(pos, end - pos));
+      pos = end;
+      continue;
+    }
+    bool wildcard = pattern[pos] == '*';
+    size_t end = wildcard ? pattern.size() : pattern.find('/', pos);
+    if (end == std::string_view::npos) {
+      end = pattern.size();
+    }
+    std::string_view name = pattern.substr(pos + 1, end - pos - 1);
+    if (name.empty()) {
+      InvalidPattern(pattern, "empty parameter name");
+    }
+    if (wildcard && name.find('/') != std::string_view::npos) {
+      InvalidPattern(pattern, "wildcard must be the last segment");
+    }
+    if (++params > MAX_ROUTE_PARAMS) {
+      InvalidPattern(pattern, "too many parameters");
+    }
+    std::unique_ptr<Node> &child = wildcard ? node->wildcard_ : node->param_;
+    if (!child) {
+      child.reset(new Node);
+      child->name_.assign(name.data(), name.size());
+    } else if (child->name_ != name) {
+      InvalidPattern(pattern, "conflicts with parameter name of another route");
+    }
+    node = child.get();
+    pos = end;
+  }
+  node->route_ = route;
+}
+
+RouteTree::Node *RouteTree::InsertStatic(Node *node, std::string_view text) {
+  while (!text.empty()) {
+    size_t index = node->indices_.find(text[0]);
+    if (index == std::string::npos) {
+      std::unique_ptr<Node> child(new Node);
+      child->prefix_.assign(text.data(), text.size());
+      node->indices_.push_back(text[0]);
+      node->children_.push_back(std::move(child));
+      return node->children_.back().get();
+    }
+    std::unique_ptr<Node> &child = node->children_[index];
+    size_t common = 0;
+    size_t limit = std::min(child->prefix_.size(), text.size());
+    while (common < limit && child->prefix_[common] == text[common]) {
+      ++common;
+    }
+    if (common < child->prefix_.size()) {
+      // 拆分：公共前缀成为新节点，原节点带着它的子树挂到新节点下
+      std::unique_ptr<Node> split(new Node);
+      split->prefix_ = child->prefix_.substr(0, common);
+      child->prefix_.erase(0, common);
+      split->indices_.push_back(child->prefix_[0]);
+      split->children_.push_back(std::move(child));
+      child = std::move(split);
+    }
+    node = child.get();
+    text.remove_prefix(common);
+  }
+  return node;
+}
+
+/**
+ * @brief 查找与路径匹配的路由
+ *
+ * 依次尝试静态子节点、参数子节点和通配符子节点，参数记录在调用方提供的match中，
+ * 分支失败时撤销本分支记录的参数，整个过程不分配内存。
+ *
+ * @param path 请求路径（不含查询字符串）
+ * @param match 输出匹配的路由编号和参数
+ * @return 找到匹配的路由返回true
+ */
+bool RouteTree::Find(std::string_view path, RouteMatch *match) const {
+  match->param_count_ = 0;
+  return Match(root_.get(), path, 0, match);
+}
+
+bool RouteTree::Match(const Node *node, std::string_view path, size_t pos,
+                      RouteMatch *match) {
+  // 沿静态节点向下：没有参数和通配符子节点的节点不会回溯，循环下降而不递归
+  for (;;) {
+    if (pos == path.size() && node->route_ != NO_ROUTE) {
+      match->route_ = node->route_;
+      return true;
+    }
+    const Node *child = FindStatic(node, path, pos);
+    if (node->param_ || node->wildcard_) {
+      if (child && Match(child, path, pos + child->prefix_.size(), match)) {
+        return true;
+      }
+      break;
+    }
+    if (!child) {
+      return false;
+    }
+    pos += child->prefix_.size();
+    node = child;
+  }
+  size_t count = match->param_count_;
+  if (node->param_ && pos < path.size() && path[pos] != '/') {
+    size_t end = path.find('/', pos);
+    if (end == std::string_view::npos) {
+      end = path.size();
+    }
+    match->names_[count] = node->param_->name_;
+    match->values_[count] = path.substr(pos, end - pos);
+    match->param_count_ = count + 1;
+    if (Match(node->param_.get(), path, end, match)) {
+      return true;
+    }
+    match->param_count_ = count;
+  }
+  if (node->wildcard_ && node->wildcard_->route_ != NO_ROUTE) {
+    match->names_[count] = node->wildcard_->name_;
+    match->values_[count] = path.substr(pos);
+    match->param_count_ = count + 1;
+    match->route_ = node->wildcard_->route_;
+    return true;
+  }
+  return false;
+}
+
+const RouteTree::Node *RouteTree::FindStatic(const Node *node,
+                                             std::string_view path,
+                                             size_t pos) {
+  if (pos == path.size()) {
+    return nullptr;
+  }
+  // 子节点很少，逐字节比较首字节比调用memchr更快
+  const char *indices = node->indices_.data();
+  for (size_t index = 0; index < node->indices_.size(); ++index) {
+    if (indices[index] != path[pos]) {
+      continue;
+    }
+    const Node *child = node->children_[index].get();
+    size_t size = child->prefix_.size();
+    if (size <= path.size() - pos &&
+        memcmp(path.data() + pos, child->prefix_.data(), size) == 0) {
+      return child;
+    }
+    return nullptr;
+  }
+  return nullptr;
+}
@@ -0,0 +1,51 @@
+#ifndef ROUTE_TREE_H
+#define ROUTE_TREE_H
+
+#include "common.h"
+
+constexpr size_t MAX_ROUTE_PARAMS = 8; // 一个路由模式最多的参数（含通配符）个数
+
+// 一次查找的结果：路由编号和按出现顺序捕获的参数，参数值指向查找的路径，名称由路由树持有
+struct RouteMatch {
+  size_t route_ = 0;
+  size_t param_count_ = 0;
+  std::string_view names_[MAX_ROUTE_PARAMS];
+  std::string_view values_[MAX_ROUTE_PARAMS];
+};
+
+// 压缩前缀树(radix tree)：一个HTTP方法的全部路由模式。
+// 静态部分按公共前缀合并成节点，":name"匹配一个非空路径段，"*name"（只能在末尾）匹配剩余的全部路径。
+// 匹配优先级为静态 > 参数 > 通配符，优先级高的分支匹配失败时回溯尝试下一个。
+// 查找只比较字节、不分配内存；注册不是线程安全的，应在服务启动前完成。
+class RouteTree {
+public:
+  RouteTree();
+  ~RouteTree();
+
+  RouteTree(const RouteTree &) = delete;
+  RouteTree &operator=(const RouteTree &) = delete;
+  RouteTree(RouteTree &&) noexcept;
+  RouteTree &operator=(RouteTree &&) noexcept;
+
+  // 注册路由模式，例如"/users/:id"、"/static/*path"；模式已存在时替换路由编号。
+  // 模式非法（不以/开头、参数名为空、通配符不在末尾、同一位置的参数名不同、参数过多）时抛出std::runtime_error
+  void Insert(std::string_view pattern, size_t route);
+  // 查找与path匹配的路由，找到时填写match并返回true
+  bool Find(std::string_view path, RouteMatch *match) const;
+  bool Empty() const;
+
+private:
+  struct Node;
+
+  // 在node的静态子节点中插入text，必要时拆分已有节点，返回text结束处的节点
+  static Node *InsertStatic(Node *node, std::string_view text);
+  static bool Match(const Node *node, std::string_view path, size_t pos,
+                    RouteMatch *match);
+  // node的静态子节点中与path[pos..]前缀匹配的节点，没有时返回nullptr
+  static const Node *FindStatic(const Node *node, std::string_view path,
+                                size_t pos);
+
+  std::unique_ptr<Node> root_;
+};
+
+#endif
@@ -1,91 +1,326 @@
 #include "router.h"
 
+namespace {
+// 解析HTTP日期，失败返回-1
+time_t ParseHttpDate(std::string_view date) {
+  char text[64];
+  if (date.size() >= sizeof(text)) {
+    return -1;
+  }
+  memcpy(text, date.data(), date.size());
+  text[date.size()] = '\0';
+  struct tm tm_time;
+  memset(&tm_time, 0, sizeof(tm_time));
+  const char *end = strptime(text, "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+  if (end == nullptr) {
+    return -1;
+  }
+  return timegm(&tm_time);
+}
+
+// 设置纯文本响应
+void SetTextResponse(HttpResponse &response, int status, std::string_view body) {
+  response.SetStatusCode(status);
+  response.SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
+  response.SetBody(body);
+}
+
+// 请求体不是合法表单时的响应：不是表单类型回复415，格式非法回复400
+void SetFormError(const HttpRequest &request, HttpResponse &response) {
+  if (IsFormContentType(request.GetHeader(HEADER_CONTENT_TYPE))) {
+    SetTextResponse(response, 400, "Malformed form body");
+  } else {
+    SetTextResponse(response, 415, "Unsupported Media Type");
+  }
+}
+
+// 通过异步完成回调回复纯文本响应
+void ReplyText(const Router::ResponseCallback &done, int status,
+               std::string_view body) {
+  HttpResponse response;
+  SetTextResponse(response, status, body);
+  done(response);
+}
+
+// If-None-Match中是否有与etag匹配的实体标签：弱比较，W/前缀不影响匹配
+bool EtagMatches(std::string_view if_none_match, const std::string &etag) {
+  return if_none_match == "*" ||
+         if_none_match.find(etag) != std::string_view::npos;
+}
+} // namespace
 
 Router::Router(UserManager &user_manager)
     : user_manager_(user_manager), logger_(Logger::GetInstance(LOGFILE)),
-      resource_path_("../../resource/web/") {
+      resource_path_("../../resource/web/"), upload_path_("/tmp") {
   InitRouter(user_manager);
 }
 
+RouteTree &Router::TreeFor(std::vector<MethodRoutes> &routes,
+                           const std::string &method) {
+  for (MethodRoutes &entry : routes) {
+    if (entry.method_ == method) {
+      return entry.tree_;
+    }
+  }
+  routes.push_back(MethodRoutes{method, RouteTree()});
+  return routes.back().tree_;
+}
+
+/**
+ * @brief 查找请求对应的路由
+ *
+ * 先按方法选出路由树，再用去掉查询字符串的路径查找，查找过程不分配内存。
+ * 匹配到的参数值指向请求路径，以偏移量记录到请求中。
+ *
+ * @param routes 各方法的路由树
+ * @param request 请求
+ * @param index 输出处理函数的下标
+ * @return 找到路由返回true
+ */
+bool Router::Route(const std::vector<MethodRoutes> &routes,
+                   HttpRequest &request, size_t *index) {
+  std::string_view method = request.GetMethod();
+  for (const MethodRoutes &entry : routes) {
+    if (entry.method_ != method) {
+      continue;
+    }
+    std::string_view path = request.GetPath();
+    path = path.substr(0, path.find('?'));
+    RouteMatch match;
+    if (!entry.tree_.Find(path, &match)) {
+      return false;
+    }
+    request.ClearParams();
+    for (size_t i = 0; i < match.param_count_; ++i) {
+      request.AddParam(match.names_[i], match.values_[i]);
+    }
+    *index = match.route_;
+    return true;
+  }
+  return false;
+}
+
 void Router::RegisterRouter(const std::string &path, const std::string &method,
                           RouterHandler handler) {
-  RouterKey key{method, path};
-  routes_[key] = std::move(handler);
+  TreeFor(routes_, method).Insert(path, handlers_.size());
+  handlers_.push_back(std::move(handler));
   logger_.Log(Logger::INFO, "Register router: " + method + " " + path);
 }
 
-bool Router::HandleRequest(const HttpRequest &request,
-                         HttpResponse &response) const {
-  RouterKey key{request.GetMethod(), request.GetPath()};
-  auto it = routes_.find(key);
+void Router::RegisterRouter(const std::string &path, const std::string &method,
+                            BodyReaderFactory factory) {
+  TreeFor(body_routes_, method).Insert(path, body_factories_.size());
+  body_factories_.push_back(std::move(factory));
+  logger_.Log(Logger::INFO,
+              "Register streaming router: " + method + " " + path);
+}
 
-  if (it != routes_.end()) {
-    it->second(request, response);
+/**
+ * @brief 注册接收表单的路由
+ *
+ * 同一路径注册两个路由：multipart请求在请求头到达时创建MultipartReader流式解析，
+ * 其他请求的请求体缓存后由普通路由按Content-Type解析。
+ * 解析结果尽量指向请求体，解码后的内容从请求的内存资源分配。
+ *
+ * @param path 路由模式
+ * @param method 请求方法
+ * @param handler 处理函数
+ */
+void Router::RegisterFormRouter(const std::string &path,
+                                const std::string &method,
+                                FormHandler handler) {
+  auto shared_handler = std::make_shared<FormHandler>(std::move(handler));
+  RegisterRouter(path, method,
+                 [this, shared_handler](const HttpRequest &head)
+                     -> std::shared_ptr<RequestBodyReader> {
+                   std::string_view boundary =
+                       MultipartBoundary(head.GetHeader(HEADER_CONTENT_TYPE));
+                   if (boundary.empty()) {
+                     return nullptr;
+                   }
+                   return std::make_shared<MultipartReader>(
+                       boundary, upload_path_, *shared_handler);
+                 });
+  RegisterRouter(path, method,
+                 [shared_handler](const HttpRequest &req, HttpResponse &resp) {
+                   FormData form(req.Resource());
+                   if (!form.Parse(req)) {
+                     SetFormError(req, resp);
+                     return;
+                   }
+                   (*shared_handler)(req, form, resp);
+                 });
+}
+
+void Router::RegisterAsyncRouter(const std::string &path,
+                                 const std::string &method,
+                                 AsyncRouterHandler handler) {
+  TreeFor(async_routes_, method).Insert(path, async_handlers_.size());
+  async_handlers_.push_back(std::move(handler));
+  logger_.Log(Logger::INFO, "Register async router: " + method + " " + path);
+}
+
+void Router::RegisterAsyncFormRouter(const std::string &path,
+                                     const std::string &method,
+                                     AsyncFormHandler handler) {
+  RegisterAsyncRouter(
+      path, method,
+      [handler](const HttpRequest &req, ResponseCallback done) {
+        FormData form(req.Resource());
+        if (!form.Parse(req)) {
+          HttpResponse response;
+          SetFormError(req, response);
+          done(response);
+          return;
+        }
+        handler(req, form, std::move(done));
+      });
+}
+
+const Router::AsyncRouterHandler *
+Router::FindAsyncHandler(HttpRequest &request) const {
+  // 流式接收请求体的请求由其处理器生成响应
+  if (async_handlers_.empty() || request.GetBodyReader() != nullptr) {
+    return nullptr;
+  }
+  size_t index = 0;
+  if (!Route(async_routes_, request, &index)) {
+    return nullptr;
+  }
+  return &async_handlers_[index];
+}
+
+void Router::SetUploadPath(const std::string &upload_path) {
+  upload_path_ = upload_path;
+}
+
+std::shared_ptr<RequestBodyReader>
+Router::OpenBodyReader(HttpRequest &head) const {
+  size_t index = 0;
+  if (!Route(body_routes_, head, &index)) {
+    return nullptr;
+  }
+  return body_factories_[index](head);
+}
+
+bool Router::HandleRequest(HttpRequest &request, HttpResponse &response) const {
+  // 请求体已经逐段交给了流式处理器，由它生成响应
+  if (RequestBodyReader *reader = request.GetBodyReader()) {
+    reader->OnComplete(request, response);
+    return true;
+  }
+  size_t index = 0;
+  if (Route(routes_, request, &index)) {
+    handlers_[index](request, response);
     return true;
   }
 
   // 处理静态资源请求
   if (request.GetMethod() == "GET") {
-    std::string file_path = resource_path_ + request.GetPath();
-    std::string content = ReadHtmlFile(file_path);
-    if (!content.empty()) {
-      response.SetStatusCode("200 OK");
-      response.SetHeader("Content-Type", "text/html; charset=utf-8");
-      response.SetBody(content);
-      return true;
-    }
+    return ServeStaticFile(request, response);
   }
 
   return false;
 }
 
 void Router::InitRouter(UserManager &user_manager) {
-  // 注册登录路由
-  RegisterRouter("/login", "POST",
-                [&](const HttpRequest &req, HttpResponse &resp) {
-                  // 从请求体中解析用户名和密码
-                  std::string username = req.GetBody();
-                  std::string password = req.GetBody();
-                  
-                  if (user_manager.Login(username, password)) {
-                    resp.SetStatusCode("200 OK");
-                    resp.SetHeader("Content-Type", "text/plain; charset=utf-8");
-                    resp.SetBody("Login successful");
-                  } else {
-                    resp.SetStatusCode("401 Unauthorized");
-                    resp.SetHeader("Content-Type", "text/plain; charset=utf-8");
-                    resp.SetBody("Invalid username or password");
-                  }
-                });
+  // 注册登录路由：数据库查询在UserManager的数据库线程中执行，不占用事件循环和工作线程
+  RegisterAsyncFormRouter(
+      "/login", "POST",
+      [&](const HttpRequest &, const FormData &form, ResponseCallback done) {
+        std::string username(form.Get("username"));
+        std::string password(form.Get("password"));
+        if (username.empty() || password.empty()) {
+          ReplyText(done, 400, "Missing username or password");
+          return;
+        }
+        bool queued = user_manager.LoginAsync(
+            std::move(username), std::move(password), [done](bool success) {
+              if (success) {
+                ReplyText(done, 200, "Login successful");
+              } else {
+                ReplyText(done, 401, "Invalid username or password");
+              }
+            });
+        if (!queued) {
+          ReplyText(done, 503, "Service Unavailable");
+        }
+      });
 
   // 注册注册路由
-  RegisterRouter("/register", "POST",
-                [&](const HttpRequest &req, HttpResponse &resp) {
-                  // 从请求体中解析用户名和密码
-                  std::string username = req.GetBody();
-                  std::string password = req.GetBody();
-
-                  if (user_manager.Register(username, password)) {
-                    resp.SetStatusCode("200 OK");
-                    resp.SetHeader("Content-Type", "text/plain; charset=utf-8");
-                    resp.SetBody("Registration successful");
-                  } else {
-                    resp.SetStatusCode("400 Bad Request");
-                    resp.SetHeader("Content-Type", "text/plain; charset=utf-8");
-                    resp.SetBody("Username already exists");
-                  }
-                });
-}
-
-std::string Router::ReadHtmlFile(const std::string &filename) const {
-  std::ifstream file(filename);
-  if (!file.is_open()) {
-    logger_.Log(Logger::ERROR, "Failed to open file: " + filename);
-    return "";
-  }
-
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  logger_.Log(Logger::DEBUG, "Successfully read file: " + filename);
-  return buffer.str();
-}
\ No newline at end of file
+  RegisterAsyncFormRouter(
+      "/register", "POST",
+      [&](const HttpRequest &, const FormData &form, ResponseCallback done) {
+        std::string username(form.Get("username"));
+        std::string password(form.Get("password"));
+        if (username.empty() || password.empty()) {
+          ReplyText(done, 400, "Missing username or password");
+          return;
+        }
+        bool queued = user_manager.RegisterAsync(
+            std::move(username), std::move(password), [done](bool success) {
+              if (success) {
+                ReplyText(done, 200, "Registration successful");
+              } else {
+                ReplyText(done, 400, "Username already exists");
+              }
+            });
+        if (!queued) {
+          ReplyText(done, 503, "Service Unavailable");
+        }
+      });
+}
+
+/**
+ * @brief 发送资源目录下的静态文件
+ *
+ * 资源来自StaticCache：小文件直接使用缓存的内容和预先构造的响应头块，大文件用sendfile发送。
+ * 按Accept-Encoding选择br、gzip或不压缩的表示。
+ * 请求的If-None-Match与ETag匹配，或没有If-None-Match而If-Modified-Since不早于文件修改时间时，
+ * 回复不带响应体的304。路径中含有".."时拒绝访问，防止读取资源目录之外的文件。
+ * 文件路径在每个线程复用的缓冲区中拼接，命中缓存时不分配内存。
+ *
+ * @param request 请求
+ * @param response 响应
+ * @return 文件不存在或不可访问时返回false
+ */
+bool Router::ServeStaticFile(const HttpRequest &request,
+                             HttpResponse &response) const {
+  std::string_view path = request.GetPath();
+  if (path.find("..") != std::string_view::npos) {
+    return false;
+  }
+  std::string_view accept_encoding = request.GetHeader(HEADER_ACCEPT_ENCODING);
+  EncodingMask accepted = accept_encoding.empty()
+                              ? (1u << ENCODING_IDENTITY)
+                              : ParseAcceptEncoding(accept_encoding);
+  thread_local std::string file_path;
+  file_path.assign(resource_path_).append(path.data(), path.size());
+  std::shared_ptr<const StaticAsset> asset = static_cache_.Get(file_path, accepted);
+  if (!asset) {
+    return false;
+  }
+  const StaticRepresentation &rep = asset->Select(accepted);
+  std::string_view if_none_match = request.GetHeader(HEADER_IF_NONE_MATCH);
+  std::string_view if_modified_since = request.GetHeader(HEADER_IF_MODIFIED_SINCE);
+  bool not_modified = false;
+  if (!if_none_match.empty()) {
+    not_modified = EtagMatches(if_none_match, rep.etag_);
+  } else if (!if_modified_since.empty()) {
+    time_t since = ParseHttpDate(if_modified_since);
+    not_modified = since >= 0 && asset->mtime_ <= since;
+  }
+  if (not_modified) {
+    response.SetStatusCode(304);
+    response.SetPrebuiltHeaders(rep.validators_);
+    return true;
+  }
+  response.SetStatusCode(200);
+  response.SetPrebuiltHeaders(rep.headers_);
+  if (rep.body_) {
+    response.SetSharedBody(rep.body_);
+  } else {
+    response.SetFileBody(rep.file_);
+  }
+  return true;
+}
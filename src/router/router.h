@@ -5,40 +5,85 @@
 #include "logger.h"
 #include "user_manager.h"
 #include "http_conn.h"
+#include "static_cache.h"
+#include "route_tree.h"
+#include "form_data.h"
 
 class Router {
 public:
   using RouterHandler =
       std::function<void(const HttpRequest &, HttpResponse &)>;
+  // 流式接收请求体的路由：请求头到达后调用，为每个请求创建一个处理器
+  using BodyReaderFactory =
+      std::function<std::shared_ptr<RequestBodyReader>(const HttpRequest &)>;
+  // 表单路由的处理函数，form为解析好的表单字段
+  using FormHandler = MultipartReader::Handler;
+  // 异步处理函数的完成回调：响应填写好后调用一次，可以在任意线程、在处理函数返回之后调用，
+  // 连接回到所属的事件循环发送响应；只有第一次调用有效，回调的全部副本都被销毁而没有调用时回复500
+  using ResponseCallback = std::function<void(HttpResponse &)>;
+  // 异步处理函数：在事件循环线程中调用，不能阻塞，应把耗时操作（如数据库查询）交给其他线程后立即返回，
+  // 结果就绪后调用done。request在done的全部副本销毁之前一直有效
+  using AsyncRouterHandler =
+      std::function<void(const HttpRequest &, ResponseCallback)>;
+  // 异步表单路由的处理函数，form只在处理函数返回之前有效，需要的字段应先拷贝
+  using AsyncFormHandler =
+      std::function<void(const HttpRequest &, const FormData &, ResponseCallback)>;
 
   Router(UserManager &user_manager);
-  // 注册路由
+  // 注册路由。path可以含有参数，例如"/users/:id"匹配一个路径段，"/static/*path"匹配其后的全部路径，
+  // 处理时通过HttpRequest::GetParam获取；同一路径同时匹配多个路由时静态路径优先，其次是参数，最后是通配符
   void RegisterRouter(const std::string &path, const std::string &method,
                       RouterHandler handler);
-  // 分发请求
-  bool HandleRequest(const HttpRequest &request, HttpResponse &response) const;
+  // 注册流式接收请求体的路由，请求体不受最大长度限制，也不在内存中缓存
+  void RegisterRouter(const std::string &path, const std::string &method,
+                      BodyReaderFactory factory);
+  // 注册接收表单的路由：urlencoded请求体缓存后解析，multipart请求体流式解析，文件内容写入上传目录的临时文件；
+  // 其他Content-Type回复415，表单格式非法时回复400，都不调用处理函数
+  void RegisterFormRouter(const std::string &path, const std::string &method,
+                          FormHandler handler);
+  // 注册异步路由；同一路径和方法同时注册了普通路由时异步路由优先
+  void RegisterAsyncRouter(const std::string &path, const std::string &method,
+                           AsyncRouterHandler handler);
+  // 注册异步表单路由：请求体（包括multipart）缓存后解析，其他Content-Type回复415，格式非法时回复400
+  void RegisterAsyncFormRouter(const std::string &path,
+                               const std::string &method,
+                               AsyncFormHandler handler);
+  // 查找请求对应的异步路由，找到时把路由参数记录到request中并返回处理函数，否则返回nullptr
+  const AsyncRouterHandler *FindAsyncHandler(HttpRequest &request) const;
+  // 设置multipart上传文件的临时目录，默认为/tmp
+  void SetUploadPath(const std::string &upload_path);
+  // 为请求创建流式请求体处理器，路由没有注册流式处理时返回nullptr；匹配的路由参数记录到head中
+  std::shared_ptr<RequestBodyReader> OpenBodyReader(HttpRequest &head) const;
+  // 分发请求，匹配的路由参数记录到request中
+  bool HandleRequest(HttpRequest &request, HttpResponse &response) const;
   // 初始化所有路由
   void InitRouter(UserManager& user_manager);
 
 private:
-  // 读取HTML文件的辅助函数
-  std::string ReadHtmlFile(const std::string &filename) const;
-  struct RouterKey {
+  // 发送静态资源文件，支持ETag/Last-Modified条件请求
+  bool ServeStaticFile(const HttpRequest &request, HttpResponse &response) const;
+  // 一个HTTP方法的路由树，树中保存处理函数的下标
+  struct MethodRoutes {
     std::string method_;
-    std::string path_;
-    bool operator==(const RouterKey &other) const {
-      return method_ == other.method_ && path_ == other.path_;
-    }
-  };
-  struct RouterKeyHash {
-    std::size_t operator()(const RouterKey &key) const {
-      return std::hash<std::string>()(key.method_ + key.path_);
-    }
+    RouteTree tree_;
   };
+  // 取得方法对应的路由树，不存在时创建
+  static RouteTree &TreeFor(std::vector<MethodRoutes> &routes,
+                            const std::string &method);
+  // 按请求的方法和路径（不含查询字符串）查找路由，找到时把参数记录到请求中，返回处理函数的下标
+  static bool Route(const std::vector<MethodRoutes> &routes,
+                    HttpRequest &request, size_t *index);
 
-  std::unordered_map<RouterKey, RouterHandler, RouterKeyHash> routes_;
+  std::vector<MethodRoutes> routes_;        // 每个方法一棵路由树，方法很少，顺序查找
+  std::vector<RouterHandler> handlers_;     // 处理函数，下标保存在路由树中
+  std::vector<MethodRoutes> body_routes_;   // 流式接收请求体的路由
+  std::vector<BodyReaderFactory> body_factories_; // 流式请求体处理器的工厂
+  std::vector<MethodRoutes> async_routes_;  // 异步路由
+  std::vector<AsyncRouterHandler> async_handlers_; // 异步处理函数
   UserManager &user_manager_;
   Logger &logger_;
   std::string resource_path_;
+  std::string upload_path_; // multipart上传文件的临时目录
+  mutable StaticCache static_cache_; // 静态资源缓存，查询时更新LRU顺序
 };
 #endif
\ No newline at end of file
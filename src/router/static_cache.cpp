@@ -0,0 +1,538 @@
+#include "static_cache.h"
+#include "thread_name.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+namespace {
+// 触发缓存失效的文件事件：内容被修改、属性变化、被删除或被重命名替换
+constexpr uint32_t WATCH_EVENTS = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                  IN_DELETE_SELF | IN_MOVE_SELF;
+// 触发缓存失效的目录事件：目录中新建或移入了文件（例如事后生成的预压缩文件）
+constexpr uint32_t DIR_WATCH_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+
+// 文件所在的目录
+std::string DirectoryOf(const std::string &path) {
+  size_t slash = path.rfind('/');
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// 目录中名为name的文件是否为path本身或它的预压缩文件
+bool IsFileOrEncoding(const std::string &path, const std::string &name) {
+  size_t slash = path.rfind('/');
+  size_t base = slash == std::string::npos ? 0 : slash + 1;
+  size_t base_len = path.size() - base;
+  if (name.size() < base_len ||
+      name.compare(0, base_len, path, base, base_len) != 0) {
+    return false;
+  }
+  for (int i = 0; i < ENCODING_COUNT; ++i) {
+    if (name.compare(base_len, std::string::npos,
+                     EncodingFileSuffix(static_cast<ContentEncoding>(i))) ==
+        0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 按扩展名确定静态资源的Content-Type，未知类型按二进制流处理
+const char *MimeTypeOf(const std::string &path) {
+  static const std::unordered_map<std::string, const char *> mime_types = {
+      {"html", "text/html; charset=utf-8"},
+      {"htm", "text/html; charset=utf-8"},
+      {"css", "text/css; charset=utf-8"},
+      {"js", "application/javascript; charset=utf-8"},
+      {"json", "application/json; charset=utf-8"},
+      {"txt", "text/plain; charset=utf-8"},
+      {"xml", "application/xml; charset=utf-8"},
+      {"svg", "image/svg+xml"},
+      {"png", "image/png"},
+      {"jpg", "image/jpeg"},
+      {"jpeg", "image/jpeg"},
+      {"gif", "image/gif"},
+      {"webp", "image/webp"},
+      {"ico", "image/x-icon"},
+      {"woff", "font/woff"},
+      {"woff2", "font/woff2"},
+      {"ttf", "font/ttf"},
+      {"pdf", "application/pdf"},
+      {"mp4", "video/mp4"},
+      {"wasm", "application/wasm"},
+  };
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos || path.find('/', dot) != std::string::npos) {
+    return "application/octet-stream";
+  }
+  std::string ext = path.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  auto it = mime_types.find(ext);
+  return it == mime_types.end() ? "application/octet-stream" : it->second;
+}
+
+// 格式化为HTTP日期，例如"Sun, 06 Nov 1994 08:49:37 GMT"
+std::string FormatHttpDate(time_t time) {
+  struct tm tm_time;
+  gmtime_r(&time, &tm_time);
+  char buf[64];
+  strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+  return buf;
+}
+
+// 读取整个文件
+bool ReadWholeFile(int fd, size_t size, std::string *content) {
+  content->resize(size);
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, &(*content)[done], size - done, done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// 是否为值得压缩的文本类型（图片、字体等已压缩格式压缩无收益）
+bool IsCompressibleType(const char *mime_type) {
+  return strncmp(mime_type, "text/", 5) == 0 ||
+         strncmp(mime_type, "application/javascript", 22) == 0 ||
+         strncmp(mime_type, "application/json", 16) == 0 ||
+         strncmp(mime_type, "application/xml", 15) == 0 ||
+         strcmp(mime_type, "application/wasm") == 0 ||
+         strcmp(mime_type, "image/svg+xml") == 0;
+}
+
+// 客户端偏好顺序：压缩率高的编码优先
+constexpr ContentEncoding PREFERRED_ENCODINGS[] = {ENCODING_BR, ENCODING_GZIP};
+
+// 在基础ETag的引号内加上编码后缀，使各编码的实体标签互不相同
+std::string EncodingEtag(const std::string &etag, ContentEncoding encoding) {
+  if (encoding == ENCODING_IDENTITY) {
+    return etag;
+  }
+  return etag.substr(0, etag.size() - 1) + "-" + EncodingName(encoding) + "\"";
+}
+
+// 构造一种编码表示的响应头块
+void BuildRepresentationHeaders(StaticRepresentation *rep,
+                                const std::string &base_etag,
+                                ContentEncoding encoding, const char *mime_type,
+                                const std::string &last_modified,
+                                bool negotiated) {
+  rep->etag_ = EncodingEtag(base_etag, encoding);
+  std::string validators =
+      "ETag: " + rep->etag_ + "\r\nLast-Modified: " + last_modified + "\r\n";
+  if (negotiated) {
+    // 同一URL有多种编码时告诉缓存服务器按Accept-Encoding区分
+    validators += "Vary: Accept-Encoding\r\n";
+  }
+  std::string headers = std::string("Content-Type: ") + mime_type + "\r\n";
+  if (encoding != ENCODING_IDENTITY) {
+    headers += std::string("Content-Encoding: ") + EncodingName(encoding) + "\r\n";
+  }
+  rep->headers_ = std::make_shared<const std::string>(headers + validators);
+  rep->validators_ = std::make_shared<const std::string>(validators);
+}
+
+// 资源在内存中占用的字节数
+size_t AssetBytes(const StaticAsset &asset) {
+  size_t bytes = 0;
+  for (const StaticRepresentation &rep : asset.representations_) {
+    if (rep.body_) {
+      bytes += rep.body_->size();
+    }
+  }
+  return bytes;
+}
+} // namespace
+
+const StaticRepresentation &StaticAsset::Select(EncodingMask accepted) const {
+  for (ContentEncoding encoding : PREFERRED_ENCODINGS) {
+    if ((accepted & (1u << encoding)) && Has(encoding)) {
+      return representations_[encoding];
+    }
+  }
+  return representations_[ENCODING_IDENTITY];
+}
+
+bool StaticAsset::Has(ContentEncoding encoding) const {
+  return static_cast<bool>(representations_[encoding].headers_);
+}
+
+StaticCache::StaticCache(size_t capacity_bytes, size_t max_file_size)
+    : capacity_bytes_(capacity_bytes), max_file_size_(max_file_size),
+      cached_bytes_(0), generation_(0),
+      inotify_fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      logger_(Logger::GetInstance(LOGFILE)),
+      compressor_(COMPRESS_THREADS, COMPRESS_THREADS, DEFAULT_POOL_QUEUE_LIMIT,
+                  QueueBackend::WORK_STEALING, "compress") {
+  if (inotify_fd_ < 0 || wakeup_fd_ < 0) {
+    // 无法感知文件变化时不缓存，每次请求都从磁盘加载，保证内容不过期
+    logger_.Log(Logger::WARN, "inotify unavailable, static cache disabled: " +
+                                  std::string(strerror(errno)));
+    return;
+  }
+  watch_thread_ = std::thread(&StaticCache::WatchLoop, this);
+}
+
+StaticCache::~StaticCache() {
+  if (watch_thread_.joinable()) {
+    uint64_t one = 1;
+    ssize_t n = write(wakeup_fd_, &one, sizeof(one));
+    (void)n;
+    watch_thread_.join();
+  }
+  // 压缩线程在成员析构时才停止，其间淘汰条目仍会移除监视，inotify实例在锁内关闭
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (inotify_fd_ >= 0) {
+      close(inotify_fd_);
+      inotify_fd_ = -1;
+    }
+  }
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+  }
+}
+
+/**
+ * @brief 获取静态资源
+ *
+ * 命中时只在锁内移动LRU位置并复制一个shared_ptr，不访问磁盘；未命中时在锁外加载文件，
+ * 先对文件、已存在的预压缩文件和所在目录建立inotify监视再读取内容，加载期间有文件变化时不缓存本次结果。
+ * 预压缩文件不存在时无法直接监视，由目录监视发现它之后的创建；文件本身或目录无法监视时不缓存。
+ *
+ * @param file_path 文件路径
+ * @param accepted 客户端可接受的内容编码
+ * @return 资源，文件不存在或不是普通文件时返回nullptr
+ */
+std::shared_ptr<const StaticAsset> StaticCache::Get(const std::string &file_path,
+                                                    EncodingMask accepted) {
+  if (!watch_thread_.joinable()) {
+    return Load(file_path);
+  }
+  std::shared_ptr<const StaticAsset> cached;
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(file_path);
+    if (it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      cached = it->second->asset_;
+    }
+    generation = generation_;
+  }
+  if (cached) {
+    AddEncoding(file_path, cached, accepted);
+    return cached;
+  }
+  std::vector<int> wds;
+  bool watched = true;
+  for (int i = 0; i < ENCODING_COUNT; ++i) {
+    std::string path =
+        file_path + EncodingFileSuffix(static_cast<ContentEncoding>(i));
+    int wd = inotify_add_watch(inotify_fd_, path.c_str(), WATCH_EVENTS);
+    if (wd >= 0) {
+      wds.push_back(wd);
+    } else if (i == ENCODING_IDENTITY) {
+      watched = false;
+    }
+  }
+  int dir_wd = inotify_add_watch(inotify_fd_, DirectoryOf(file_path).c_str(),
+                                 DIR_WATCH_EVENTS);
+  if (dir_wd >= 0) {
+    wds.push_back(dir_wd);
+  } else {
+    watched = false;
+  }
+  std::shared_ptr<StaticAsset> asset = Load(file_path);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 加载期间收到过文件变化事件时，读到的内容可能已经过期，不放入缓存
+    if (asset && asset->representations_[ENCODING_IDENTITY].body_ &&
+        watched && generation == generation_ &&
+        index_.find(file_path) == index_.end()) {
+      Insert(file_path, asset, std::move(wds));
+    } else {
+      for (int wd : wds) {
+        if (watched_.find(wd) == watched_.end()) {
+          inotify_rm_watch(inotify_fd_, wd);
+        }
+      }
+      return asset;
+    }
+  }
+  AddEncoding(file_path, asset, accepted);
+  return asset;
+}
+
+size_t StaticCache::CachedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cached_bytes_;
+}
+
+/**
+ * @brief 从磁盘加载资源并构造各编码表示的响应头块
+ *
+ * 不超过单文件上限的文件读入内存供缓存；更大的文件只保留打开的fd，由sendfile发送。
+ * 同目录下存在不比原文件旧的.gz/.br文件时作为对应编码的表示，不需要运行时压缩。
+ * ETag由文件大小和修改时间（纳秒）组成，文件内容变化后一定随之变化。
+ */
+std::shared_ptr<StaticAsset> StaticCache::Load(const std::string &file_path) const {
+  int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    // 文件不存在是普通的404，不记录错误日志
+    if (errno != ENOENT && errno != ENOTDIR) {
+      logger_.Log(Logger::ERROR, "Failed to open file: " + file_path);
+    }
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return nullptr;
+  }
+  std::shared_ptr<StaticAsset> asset = std::make_shared<StaticAsset>();
+  size_t size = static_cast<size_t>(st.st_size);
+  char etag[64];
+  snprintf(etag, sizeof(etag), "\"%lx-%lx%09lx\"",
+           static_cast<unsigned long>(size),
+           static_cast<unsigned long>(st.st_mtim.tv_sec),
+           static_cast<unsigned long>(st.st_mtim.tv_nsec));
+  asset->mtime_ = st.st_mtim.tv_sec;
+  const char *mime_type = MimeTypeOf(file_path);
+  asset->mime_type_ = mime_type;
+  std::string last_modified = FormatHttpDate(asset->mtime_);
+  asset->compressible_ =
+      IsCompressibleType(mime_type) && size >= MIN_COMPRESS_SIZE;
+
+  // 查找预压缩文件
+  bool negotiated = asset->compressible_;
+  for (ContentEncoding encoding : PREFERRED_ENCODINGS) {
+    std::string path = file_path + EncodingFileSuffix(encoding);
+    int encoded_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (encoded_fd < 0) {
+      continue;
+    }
+    struct stat encoded_st;
+    std::string content;
+    bool usable = fstat(encoded_fd, &encoded_st) == 0 &&
+                  S_ISREG(encoded_st.st_mode) &&
+                  encoded_st.st_mtime >= st.st_mtime;
+    StaticRepresentation &rep = asset->representations_[encoding];
+    if (usable && size <= max_file_size_) {
+      usable = ReadWholeFile(encoded_fd, encoded_st.st_size, &content);
+      close(encoded_fd);
+      if (usable) {
+        rep.body_ = std::make_shared<const std::string>(std::move(content));
+      }
+    } else if (usable) {
+      rep.file_ = std::make_shared<FileBody>(encoded_fd, encoded_st.st_size);
+    } else {
+      close(encoded_fd);
+    }
+    if (usable) {
+      negotiated = true;
+      asset->compress_tried_[encoding] = true;
+      BuildRepresentationHeaders(&rep, etag, encoding, mime_type,
+                                 last_modified, true);
+    }
+  }
+
+  StaticRepresentation &identity = asset->representations_[ENCODING_IDENTITY];
+  BuildRepresentationHeaders(&identity, etag, ENCODING_IDENTITY, mime_type,
+                             last_modified, negotiated);
+  if (size <= max_file_size_) {
+    std::string content;
+    bool ok = ReadWholeFile(fd, size, &content);
+    close(fd);
+    if (!ok) {
+      logger_.Log(Logger::ERROR, "Failed to read file: " + file_path);
+      return nullptr;
+    }
+    identity.body_ = std::make_shared<const std::string>(std::move(content));
+  } else {
+    identity.file_ = std::make_shared<FileBody>(fd, size);
+  }
+  logger_.Log(Logger::DEBUG, "Loaded static file: " + file_path);
+  return asset;
+}
+
+/**
+ * @brief 按需为缓存的资源补充压缩表示
+ *
+ * 只处理客户端可接受的最优编码：已有该表示或已尝试过时直接返回。压缩交给压缩线程，
+ * 不占用事件循环线程；同一文件的同一编码正在压缩时不重复提交，压缩完成之前的请求使用已有的表示。
+ * 压缩任务队列已满时放弃本次压缩，之后的请求再次尝试。
+ */
+void StaticCache::AddEncoding(const std::string &file_path,
+                              const std::shared_ptr<const StaticAsset> &asset,
+                              EncodingMask accepted) {
+  if (!asset->compressible_ ||
+      !asset->representations_[ENCODING_IDENTITY].body_) {
+    return;
+  }
+  ContentEncoding encoding = ENCODING_IDENTITY;
+  for (ContentEncoding candidate : PREFERRED_ENCODINGS) {
+    if (!(accepted & (1u << candidate))) {
+      continue;
+    }
+    if (asset->Has(candidate)) {
+      return;
+    }
+    if (!asset->compress_tried_[candidate] && CanCompress(candidate)) {
+      encoding = candidate;
+      break;
+    }
+  }
+  if (encoding == ENCODING_IDENTITY) {
+    return;
+  }
+  std::string key = file_path + EncodingFileSuffix(encoding);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!compressing_.insert(key).second) {
+      return;
+    }
+  }
+  try {
+    compressor_.Post([this, file_path, asset, encoding]() {
+      ApplyEncoding(file_path, asset, encoding);
+    });
+  } catch (const std::runtime_error &) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    compressing_.erase(key);
+  }
+}
+
+/**
+ * @brief 压缩资源并替换缓存条目
+ *
+ * 压缩在锁外进行，压缩后体积没有明显减小（例如内容本身已压缩）时只记录已尝试，之后不再压缩。
+ * 结果写入资源的副本，条目仍指向原资源时替换，否则（期间已失效或已被更新）丢弃。
+ * 替换条目和清除进行中标记在同一次加锁内完成，请求要么看到进行中，要么看到新的资源。
+ */
+void StaticCache::ApplyEncoding(const std::string &file_path,
+                                const std::shared_ptr<const StaticAsset> &asset,
+                                ContentEncoding encoding) {
+  const StaticRepresentation &identity =
+      asset->representations_[ENCODING_IDENTITY];
+  std::string compressed;
+  bool worthwhile = Compress(encoding, *identity.body_, &compressed) &&
+                    compressed.size() < identity.body_->size() * 9 / 10;
+  std::shared_ptr<StaticAsset> updated = std::make_shared<StaticAsset>(*asset);
+  updated->compress_tried_[encoding] = true;
+  if (worthwhile) {
+    StaticRepresentation &rep = updated->representations_[encoding];
+    BuildRepresentationHeaders(&rep, identity.etag_, encoding,
+                               asset->mime_type_,
+                               FormatHttpDate(asset->mtime_), true);
+    rep.body_ = std::make_shared<const std::string>(std::move(compressed));
+    logger_.Log(Logger::DEBUG, std::string("Compressed ") + file_path +
+                                   " with " + EncodingName(encoding));
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  compressing_.erase(file_path + EncodingFileSuffix(encoding));
+  auto it = index_.find(file_path);
+  if (it != index_.end() && it->second->asset_ == asset) {
+    size_t bytes = AssetBytes(*updated);
+    cached_bytes_ += bytes - it->second->bytes_;
+    it->second->bytes_ = bytes;
+    it->second->asset_ = std::move(updated);
+    while (cached_bytes_ > capacity_bytes_ && lru_.size() > 1) {
+      Erase(std::prev(lru_.end()));
+    }
+  }
+}
+
+void StaticCache::Insert(const std::string &file_path,
+                         std::shared_ptr<const StaticAsset> asset,
+                         std::vector<int> wds) {
+  size_t bytes = AssetBytes(*asset);
+  cached_bytes_ += bytes;
+  for (int wd : wds) {
+    watched_[wd].insert(file_path);
+  }
+  lru_.push_front(Entry{file_path, std::move(asset), bytes, std::move(wds)});
+  index_[file_path] = lru_.begin();
+  while (cached_bytes_ > capacity_bytes_ && !lru_.empty()) {
+    Erase(std::prev(lru_.end()));
+  }
+}
+
+void StaticCache::Erase(EntryList::iterator it) {
+  cached_bytes_ -= it->bytes_;
+  for (int wd : it->wds_) {
+    auto watch_it = watched_.find(wd);
+    if (watch_it == watched_.end()) {
+      continue;
+    }
+    watch_it->second.erase(it->path_);
+    if (watch_it->second.empty()) {
+      inotify_rm_watch(inotify_fd_, wd);
+      watched_.erase(watch_it);
+    }
+  }
+  index_.erase(it->path_);
+  lru_.erase(it);
+}
+
+/**
+ * @brief inotify事件处理线程
+ *
+ * 文件被修改、删除或替换时删除对应的全部缓存条目，下一次请求重新加载；
+ * 监视被内核移除（IN_IGNORED）时同样清理。目录事件带有文件名，只删除该文件本身
+ * 或以它为预压缩文件的条目，目录中其他文件的变化不影响缓存。
+ */
+void StaticCache::WatchLoop() {
+  SetCurrentThreadName("static-watch");
+  alignas(inotify_event) char buf[4096];
+  pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wakeup_fd_, POLLIN, 0}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      logger_.Log(Logger::ERROR, "inotify poll failed: " +
+                                     std::string(strerror(errno)));
+      return;
+    }
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+    ssize_t n;
+    while ((n = read(inotify_fd_, buf, sizeof(buf))) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++generation_;
+      for (char *p = buf; p < buf + n;) {
+        const inotify_event *event = reinterpret_cast<inotify_event *>(p);
+        p += sizeof(inotify_event) + event->len;
+        auto watch_it = watched_.find(event->wd);
+        if (watch_it == watched_.end()) {
+          continue;
+        }
+        std::unordered_set<std::string> paths = watch_it->second;
+        std::string name = event->len > 0 ? event->name : "";
+        for (const std::string &path : paths) {
+          if (!name.empty() && !IsFileOrEncoding(path, name)) {
+            continue;
+          }
+          auto it = index_.find(path);
+          if (it != index_.end()) {
+            logger_.Log(Logger::DEBUG, "Static file changed: " + path);
+            Erase(it->second);
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef STATIC_CACHE_H
+#define STATIC_CACHE_H
+#include "common.h"
+#include "content_encoding.h"
+#include "http_conn.h"
+#include "logger.h"
+#include "thread_pool.h"
+#include <unordered_set>
+
+constexpr size_t DEFAULT_STATIC_CACHE_BYTES = 64 * 1024 * 1024; // 静态资源缓存默认容量
+constexpr size_t MAX_CACHED_FILE_SIZE = 1024 * 1024; // 超过该大小的文件不缓存，用sendfile发送
+constexpr size_t MIN_COMPRESS_SIZE = 1024; // 小于该大小的内容压缩收益有限，不压缩
+constexpr size_t COMPRESS_THREADS = 2;      // 后台压缩线程数
+
+// 静态资源的一种内容编码表示
+struct StaticRepresentation {
+  std::shared_ptr<const std::string> headers_;    // 200响应的响应头块（Content-Type、编码及校验头）
+  std::shared_ptr<const std::string> validators_; // 304响应的响应头块（ETag、Last-Modified）
+  std::shared_ptr<const std::string> body_;       // 内容，不缓存的大文件为空
+  std::shared_ptr<FileBody> file_;                // 不缓存的大文件，以sendfile发送
+  std::string etag_;                              // 实体标签，各编码互不相同
+};
+
+// 一个静态资源：缓存的内容连同预先构造好的响应头块，或者不缓存的大文件。
+// 资源创建后不再修改，新增压缩表示时由StaticCache复制一份替换缓存条目。
+struct StaticAsset {
+  StaticRepresentation representations_[ENCODING_COUNT]; // 按编码索引，headers_为空表示没有该编码
+  bool compressible_ = false;                   // 是否为值得运行时压缩的文本内容
+  bool compress_tried_[ENCODING_COUNT] = {};    // 是否已尝试运行时压缩（无收益时不再尝试）
+  time_t mtime_ = 0;                            // 最后修改时间
+  const char *mime_type_ = nullptr;             // Content-Type取值（静态字符串）
+
+  // 在客户端可接受的编码中选择最优的已有表示：br优先，其次gzip，最后identity
+  const StaticRepresentation &Select(EncodingMask accepted) const;
+  // 表示是否存在
+  bool Has(ContentEncoding encoding) const;
+};
+
+// 静态资源的内存缓存：按字节数限制容量，超出时淘汰最久未使用的资源。
+// 文件（及其预压缩的.gz/.br文件）的变化通过inotify通知后台线程使对应条目失效，命中时不需要stat文件；
+// 同时监视所在目录，加载之后才出现的预压缩文件同样使条目失效。
+// 可压缩的资源在第一次被请求某种编码时交给后台线程压缩，压缩完成前以已有的表示响应，
+// 压缩结果随条目一起缓存。线程安全。
+class StaticCache {
+public:
+  explicit StaticCache(size_t capacity_bytes = DEFAULT_STATIC_CACHE_BYTES,
+                       size_t max_file_size = MAX_CACHED_FILE_SIZE);
+  ~StaticCache();
+
+  StaticCache(const StaticCache &) = delete;
+  StaticCache &operator=(const StaticCache &) = delete;
+
+  // 获取文件对应的资源，未命中时从磁盘加载，并按需在后台补充accepted中最优编码的压缩表示；
+  // 文件不存在或不是普通文件时返回nullptr
+  std::shared_ptr<const StaticAsset> Get(const std::string &file_path,
+                                         EncodingMask accepted);
+  // 当前缓存的字节数
+  size_t CachedBytes() const;
+
+private:
+  // 一个缓存条目
+  struct Entry {
+    std::string path_;                         // 文件路径
+    std::shared_ptr<const StaticAsset> asset_; // 资源
+    size_t bytes_;                             // 资源占用的字节数
+    std::vector<int> wds_;                     // inotify监视描述符（文件、预压缩文件及所在目录）
+  };
+  using EntryList = std::list<Entry>;
+
+  std::shared_ptr<StaticAsset> Load(const std::string &file_path) const; // 从磁盘加载资源
+  // 需要时提交后台任务，为缓存的资源补充编码表示
+  void AddEncoding(const std::string &file_path,
+                   const std::shared_ptr<const StaticAsset> &asset,
+                   EncodingMask accepted);
+  // 在压缩线程中压缩资源，条目仍指向asset时替换为带有新表示的资源
+  void ApplyEncoding(const std::string &file_path,
+                     const std::shared_ptr<const StaticAsset> &asset,
+                     ContentEncoding encoding);
+  // 插入条目并按容量淘汰，持有mutex_时调用
+  void Insert(const std::string &file_path,
+              std::shared_ptr<const StaticAsset> asset, std::vector<int> wds);
+  void Erase(EntryList::iterator it); // 删除条目，持有mutex_时调用
+  void WatchLoop();                   // inotify事件处理线程
+
+  size_t capacity_bytes_;  // 最大缓存字节数
+  size_t max_file_size_;   // 单个文件的缓存上限
+  size_t cached_bytes_;    // 当前缓存字节数
+  uint64_t generation_;    // 已处理的文件变化事件批次，用于丢弃加载期间过期的内容
+  EntryList lru_;          // 条目，头部为最近使用
+  std::unordered_map<std::string, EntryList::iterator> index_; // 路径到条目
+  std::unordered_map<int, std::unordered_set<std::string>> watched_; // 监视描述符到路径，目录监视对应其中缓存的文件
+  std::unordered_set<std::string> compressing_; // 正在后台压缩的文件路径加编码后缀，避免重复压缩
+  mutable std::mutex mutex_;   // 保护以上缓存状态
+  int inotify_fd_;             // inotify实例，创建失败时为-1，此时不缓存
+  int wakeup_fd_;              // 通知监视线程退出
+  std::thread watch_thread_;   // inotify事件处理线程
+  Logger &logger_;             // 日志记录器
+  ThreadPool compressor_;      // 压缩线程，最后声明、最先析构，析构时执行完已提交的压缩
+};
+
+#endif
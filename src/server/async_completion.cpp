@@ -0,0 +1,52 @@
+#include "async_completion.h"
+#include "reactor.h"
+
+AsyncCompletion::AsyncCompletion(std::shared_ptr<Connection> conn,
+                                 std::shared_ptr<HttpRequest> request)
+    : conn_(std::move(conn)), request_(std::move(request)) {}
+
+AsyncCompletion::~AsyncCompletion() {
+  if (!completed_.exchange(true)) {
+    auto response = std::make_shared<HttpResponse>();
+    response->SetStatusCode(500);
+    response->SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
+    response->SetBody("Internal Server Error");
+    Send(conn_, std::move(response));
+  }
+}
+
+const HttpRequest &AsyncCompletion::Request() const { return *request_; }
+
+void AsyncCompletion::Complete(HttpResponse &response) {
+  if (completed_.exchange(true)) {
+    return;
+  }
+  Send(conn_, std::make_shared<HttpResponse>(std::move(response)));
+}
+
+/**
+ * @brief 调用异步处理函数
+ *
+ * 请求拷贝一份到普通堆内存，在完成之前一直有效；处理函数得到的完成回调共享同一个完成状态。
+ * 完成回调可以在任意线程调用，响应通过QueueInLoop回到连接所属的事件循环发送，
+ * 连接在此期间保持等待响应的状态，管线化的后续请求等它完成后再处理。
+ *
+ * @param conn 连接
+ * @param request 请求，路由参数已经记录
+ * @param handler 异步处理函数
+ */
+void AsyncCompletion::Start(const std::shared_ptr<Connection> &conn,
+                            const HttpRequest &request,
+                            const Router::AsyncRouterHandler &handler) {
+  auto completion = std::make_shared<AsyncCompletion>(
+      conn, std::make_shared<HttpRequest>(request));
+  handler(completion->Request(), [completion](HttpResponse &response) {
+    completion->Complete(response);
+  });
+}
+
+void AsyncCompletion::Send(const std::shared_ptr<Connection> &conn,
+                           std::shared_ptr<HttpResponse> response) {
+  conn->GetLoop().QueueInLoop(
+      [conn, response]() { conn->SendResponse(*response); });
+}
@@ -0,0 +1,36 @@
+#ifndef ASYNC_COMPLETION_H
+#define ASYNC_COMPLETION_H
+#include "common.h"
+#include "connection.h"
+#include "router.h"
+
+// 一个异步请求的完成状态，由完成回调的全部副本共享：第一次完成时把响应交给连接所属的事件循环发送，
+// 处理函数丢弃了回调而没有调用时在析构中回复500，连接不会一直停在等待响应的状态
+class AsyncCompletion {
+public:
+  AsyncCompletion(std::shared_ptr<Connection> conn,
+                  std::shared_ptr<HttpRequest> request);
+  ~AsyncCompletion();
+
+  AsyncCompletion(const AsyncCompletion &) = delete;
+  AsyncCompletion &operator=(const AsyncCompletion &) = delete;
+
+  const HttpRequest &Request() const;
+  // 完成请求，只有第一次调用有效；响应被移走，可以在任意线程调用
+  void Complete(HttpResponse &response);
+
+  // 在事件循环线程中调用异步处理函数。处理函数抛出的异常继续抛给调用者，此时回调已随之销毁并回复了500
+  static void Start(const std::shared_ptr<Connection> &conn,
+                    const HttpRequest &request,
+                    const Router::AsyncRouterHandler &handler);
+
+private:
+  static void Send(const std::shared_ptr<Connection> &conn,
+                   std::shared_ptr<HttpResponse> response);
+
+  std::shared_ptr<Connection> conn_;
+  std::shared_ptr<HttpRequest> request_; // 请求的堆内存副本，完成之前一直有效
+  std::atomic<bool> completed_{false};
+};
+
+#endif
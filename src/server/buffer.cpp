@@ -0,0 +1,313 @@
+#include "buffer.h"
+#include "http_conn.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sys/sendfile.h>
+
+Buffer::Buffer(size_t initial_size)
+    : buffer_(initial_size), read_index_(0), write_index_(0) {}
+
+size_t Buffer::ReadableBytes() const { return write_index_ - read_index_; }
+
+const char *Buffer::Peek() const { return buffer_.data() + read_index_; }
+
+void Buffer::Retrieve(size_t len) {
+  if (len < ReadableBytes()) {
+    read_index_ += len;
+  } else {
+    RetrieveAll();
+  }
+}
+
+void Buffer::RetrieveAll() {
+  read_index_ = 0;
+  write_index_ = 0;
+}
+
+void Buffer::Append(const char *data, size_t len) {
+  EnsureWritable(len);
+  std::copy(data, data + len, buffer_.begin() + write_index_);
+  write_index_ += len;
+}
+
+/**
+ * @brief 确保缓冲区尾部至少有len字节可写空间
+ *
+ * 优先把未读数据挪回头部复用已消费区域，空间仍不足时才扩容。
+ *
+ * @param len 需要的可写字节数
+ */
+void Buffer::EnsureWritable(size_t len) {
+  if (buffer_.size() - write_index_ >= len) {
+    return;
+  }
+  size_t readable = ReadableBytes();
+  if (read_index_ + (buffer_.size() - write_index_) >= len) {
+    std::copy(buffer_.begin() + read_index_, buffer_.begin() + write_index_,
+              buffer_.begin());
+  } else {
+    std::vector<char> grown(std::max(buffer_.size() * 2, readable + len));
+    std::copy(buffer_.begin() + read_index_, buffer_.begin() + write_index_,
+              grown.begin());
+    buffer_.swap(grown);
+  }
+  read_index_ = 0;
+  write_index_ = readable;
+}
+
+/**
+ * @brief 从非阻塞fd读取数据直到EAGAIN或缓冲区中的可读数据达到上限
+ *
+ * 边缘触发模式下必须一次读空内核缓冲区，除非达到上限：此时剩余数据留在内核中，由TCP流量控制让对端等待，
+ * 调用方需要在数据被消费后主动再次读取。使用readv同时读入缓冲区剩余空间和栈上的临时空间，
+ * 避免为了一次可能很小的读取预先扩容。
+ *
+ * @param fd 非阻塞套接字
+ * @param max_readable 可读数据的上限，达到后停止读取
+ * @param peer_closed 对端关闭连接时置为true
+ * @param saved_errno 出错时保存errno
+ * @return 本次读取的总字节数，出错返回-1
+ */
+ssize_t Buffer::ReadFd(int fd, size_t max_readable, bool *peer_closed,
+                       int *saved_errno) {
+  char extra_buffer[65536];
+  ssize_t total = 0;
+  *peer_closed = false;
+  while (ReadableBytes() < max_readable) {
+    size_t limit = max_readable - ReadableBytes();
+    iovec vec[2];
+    size_t writable = std::min(buffer_.size() - write_index_, limit);
+    vec[0].iov_base = buffer_.data() + write_index_;
+    vec[0].iov_len = writable;
+    vec[1].iov_base = extra_buffer;
+    vec[1].iov_len = std::min(sizeof(extra_buffer), limit - writable);
+    ssize_t n = readv(fd, vec, 2);
+    if (n > 0) {
+      if (static_cast<size_t>(n) <= writable) {
+        write_index_ += n;
+      } else {
+        write_index_ += writable;
+        Append(extra_buffer, n - writable);
+      }
+      total += n;
+    } else if (n == 0) {
+      *peer_closed = true;
+      return total;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return total;
+    } else {
+      *saved_errno = errno;
+      return -1;
+    }
+  }
+  return total;
+}
+
+void OutputQueue::Append(std::pmr::string &&data) {
+  if (data.empty()) {
+    return;
+  }
+  pending_bytes_ += data.size();
+  // 移动构造保留data的内存资源，移动赋值给默认构造的数据段会按默认资源重新分配并拷贝
+  Tail().emplace_back(std::move(data));
+}
+
+void OutputQueue::AppendView(std::string_view data) {
+  if (data.empty()) {
+    return;
+  }
+  pending_bytes_ += data.size();
+  std::vector<Chunk> &tail = Tail();
+  tail.emplace_back();
+  tail.back().view_ = data;
+}
+
+void OutputQueue::AppendFile(std::shared_ptr<FileBody> file) {
+  if (!file || file->Size() == 0) {
+    return;
+  }
+  pending_bytes_ += file->Size();
+  std::vector<Chunk> &tail = Tail();
+  tail.emplace_back();
+  tail.back().file_ = std::move(file);
+}
+
+void OutputQueue::AppendShared(std::shared_ptr<const std::string> data) {
+  if (!data || data->empty()) {
+    return;
+  }
+  pending_bytes_ += data->size();
+  std::vector<Chunk> &tail = Tail();
+  tail.emplace_back();
+  tail.back().shared_ = std::move(data);
+}
+
+const char *OutputQueue::Chunk::Data() const {
+  if (shared_) {
+    return shared_->data();
+  }
+  return view_.empty() ? data_.data() : view_.data();
+}
+
+size_t OutputQueue::Chunk::Length() const {
+  if (file_) {
+    return file_->Size();
+  }
+  if (shared_) {
+    return shared_->size();
+  }
+  return view_.empty() ? data_.size() : view_.size();
+}
+
+bool OutputQueue::Empty() const { return head_ == chunks_.size(); }
+
+size_t OutputQueue::PendingBytes() const { return pending_bytes_; }
+
+OutputQueue::Chunk &OutputQueue::Front() { return chunks_[head_]; }
+
+const OutputQueue::Chunk &OutputQueue::Front() const { return chunks_[head_]; }
+
+/**
+ * @brief 丢弃已发送完的队首数据段
+ *
+ * 文件和共享数据的引用立即释放；数组本身在队列写空时才清空，保留容量供后续响应复用，
+ * 同时把溢出数组中的数据段合并进来。
+ */
+void OutputQueue::PopFront() {
+  Chunk &front = Front();
+  front.file_.reset();
+  front.shared_.reset();
+  if (++head_ == chunks_.size()) {
+    chunks_.clear();
+    head_ = 0;
+    Compact();
+  }
+}
+
+/**
+ * @brief 选择新数据段追加到的数组
+ *
+ * chunks_扩容会移动其中的数据段，使指向短数据（存放在数据段内部）的在途iovec失效。
+ * 因此chunks_已满且仍有待发送数据时改为追加到溢出数组，等没有在途发送时再合并；
+ * 队列为空时没有在途发送，可以直接扩容。
+ *
+ * @return chunks_或overflow_
+ */
+std::vector<OutputQueue::Chunk> &OutputQueue::Tail() {
+  if (overflow_.empty() &&
+      (chunks_.empty() || chunks_.size() < chunks_.capacity())) {
+    return chunks_;
+  }
+  return overflow_;
+}
+
+/**
+ * @brief 把溢出数组中的数据段按顺序合并到chunks_末尾
+ *
+ * 只在没有在途iovec时调用。合并用移动构造，保留自有数据的内存资源；
+ * 两个数组都保留容量，chunks_扩容到足够大后稳态下不再溢出。
+ */
+void OutputQueue::Compact() {
+  if (overflow_.empty()) {
+    return;
+  }
+  for (Chunk &chunk : overflow_) {
+    chunks_.push_back(std::move(chunk));
+  }
+  overflow_.clear();
+}
+
+/**
+ * @brief 把排队的数据段写入非阻塞套接字
+ *
+ * 连续的内存数据段每次writev最多聚合IOV_MAX个，文件数据段用sendfile直接从页缓存发送。
+ * 部分写出时只前移偏移量，剩余数据留在队列中，等EPOLLOUT到来时继续发送。
+ *
+ * @param fd 非阻塞套接字
+ * @param saved_errno 出错时保存errno
+ * @return 写出结果
+ */
+OutputQueue::WriteStatus OutputQueue::WriteFd(int fd, int *saved_errno) {
+  iovec vec[64 < IOV_MAX ? 64 : IOV_MAX];
+  const size_t max_vec = sizeof(vec) / sizeof(vec[0]);
+  while (!Empty()) {
+    ssize_t n;
+    if (FrontIsFile()) {
+      n = SendFile(fd);
+    } else {
+      size_t count = FillIovec(vec, max_vec);
+      n = writev(fd, vec, static_cast<int>(count));
+      if (n >= 0) {
+        Advance(static_cast<size_t>(n));
+      }
+    }
+    if (n >= 0) {
+      continue;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return WRITE_AGAIN;
+    } else {
+      *saved_errno = errno;
+      return WRITE_ERROR;
+    }
+  }
+  return WRITE_COMPLETE;
+}
+
+size_t OutputQueue::FillIovec(iovec *vec, size_t max_count) {
+  Compact();
+  size_t count = 0;
+  for (size_t i = head_; i < chunks_.size() && !chunks_[i].file_ &&
+                         count < max_count;
+       ++i, ++count) {
+    const Chunk &chunk = chunks_[i];
+    vec[count].iov_base = const_cast<char *>(chunk.Data()) + chunk.offset_;
+    vec[count].iov_len = chunk.Length() - chunk.offset_;
+  }
+  return count;
+}
+
+bool OutputQueue::FrontIsFile() const {
+  return !Empty() && Front().file_;
+}
+
+/**
+ * @brief 用sendfile发送队首文件数据段的剩余部分
+ *
+ * 文件在打开后被截断时sendfile会返回0，此时按EIO出错处理，避免无限重试。
+ *
+ * @param fd 非阻塞套接字
+ * @return 发送的字节数，出错返回-1并设置errno
+ */
+ssize_t OutputQueue::SendFile(int fd) {
+  Chunk &front = Front();
+  off_t offset = static_cast<off_t>(front.offset_);
+  ssize_t n = sendfile(fd, front.file_->Fd(), &offset,
+                       front.file_->Size() - front.offset_);
+  if (n == 0) {
+    errno = EIO;
+    return -1;
+  }
+  if (n > 0) {
+    Advance(static_cast<size_t>(n));
+  }
+  return n;
+}
+
+void OutputQueue::Advance(size_t bytes) {
+  pending_bytes_ -= bytes;
+  while (bytes > 0 && !Empty()) {
+    Chunk &front = Front();
+    size_t remaining = front.Length() - front.offset_;
+    if (bytes < remaining) {
+      front.offset_ += bytes;
+      return;
+    }
+    bytes -= remaining;
+    PopFront();
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+#include "common.h"
+#include <memory_resource>
+#include <sys/uio.h>
+
+class FileBody;
+
+// 可增长的连接缓冲区：[0, read_index_)为已消费区域，[read_index_, write_index_)为可读数据
+class Buffer {
+public:
+  explicit Buffer(size_t initial_size = BUFFER_SIZE);
+
+  // 可读字节数
+  size_t ReadableBytes() const;
+  // 可读数据起始地址
+  const char *Peek() const;
+  // 消费len字节
+  void Retrieve(size_t len);
+  // 清空缓冲区
+  void RetrieveAll();
+  // 追加数据
+  void Append(const char *data, size_t len);
+  // 从fd读取数据直到EAGAIN或可读数据达到max_readable字节，返回读取的总字节数；
+  // 对端关闭时置*peer_closed为true，出错时返回-1
+  ssize_t ReadFd(int fd, size_t max_readable, bool *peer_closed,
+                 int *saved_errno);
+
+private:
+  void EnsureWritable(size_t len); // 确保至少有len字节可写空间
+
+  std::vector<char> buffer_; // 底层存储
+  size_t read_index_;        // 读位置
+  size_t write_index_;       // 写位置
+};
+
+// 连接的输出队列：每个响应的头部和响应体作为独立的数据段排队，用writev一次写出多个段，
+// 响应体不需要拼接进头部字符串；文件数据段用sendfile发送，不经过用户态缓冲区。
+// 数据段保存在复用的数组中，队列写空时才统一销毁，稳态下排队不分配内存。
+// 发送在途时iovec指向数据段（短数据就在数据段内部），数组满了以后追加的数据段先放进溢出数组，
+// 等下一次填充iovec时再合并，保证在途的iovec一直有效
+class OutputQueue {
+public:
+  // 写出结果
+  enum WriteStatus {
+    WRITE_COMPLETE, // 全部写完
+    WRITE_AGAIN,    // 内核发送缓冲区已满，需等待EPOLLOUT
+    WRITE_ERROR     // 写出错
+  };
+
+  // 追加一个数据段（移动，不拷贝）
+  void Append(std::pmr::string &&data);
+  // 追加一段不归队列所有的数据，调用方保证它在写完之前有效（静态数据或连接内存池中的数据）
+  void AppendView(std::string_view data);
+  // 追加一个文件数据段，发送完后释放
+  void AppendFile(std::shared_ptr<FileBody> file);
+  // 追加一个共享的只读数据段，发送完后释放引用
+  void AppendShared(std::shared_ptr<const std::string> data);
+  // 是否没有待发送的数据
+  bool Empty() const;
+  // 待发送字节数
+  size_t PendingBytes() const;
+  // 尽量写出所有数据段，出错时保存errno
+  WriteStatus WriteFd(int fd, int *saved_errno);
+  // 把待发送的内存数据段依次填入vec，最多max_count个，遇到文件数据段停止，返回填入的个数。
+  // 之前填入的iovec在调用后失效，调用方应在上一次发送完成之后再调用
+  size_t FillIovec(iovec *vec, size_t max_count);
+  // 队首是否为文件数据段
+  bool FrontIsFile() const;
+  // 用sendfile发送一次队首的文件数据段，返回发送的字节数，出错返回-1并设置errno
+  ssize_t SendFile(int fd);
+  // 标记已发送bytes字节，丢弃已发送完的数据段
+  void Advance(size_t bytes);
+
+private:
+  // 一个待发送的数据段：自有数据、外部数据、共享数据或文件
+  struct Chunk {
+    Chunk() = default;
+    // 移动构造保留data的内存资源
+    explicit Chunk(std::pmr::string &&data) : data_(std::move(data)) {}
+
+    std::pmr::string data_;                      // 自有数据
+    std::string_view view_;                      // 外部数据，非空时忽略data_
+    size_t offset_ = 0;                          // 已发送的字节数
+    std::shared_ptr<FileBody> file_;             // 文件数据段，非空时忽略data_
+    std::shared_ptr<const std::string> shared_;  // 共享数据段，非空时忽略data_
+    const char *Data() const;                    // 内存数据起始地址
+    size_t Length() const;                       // 数据段总字节数
+  };
+  Chunk &Front();           // 队首数据段
+  const Chunk &Front() const;
+  void PopFront();          // 丢弃已发送完的队首数据段，队列写空时清空数组
+  std::vector<Chunk> &Tail(); // 新数据段应追加到的数组
+  void Compact();           // 把溢出数组中的数据段合并到chunks_末尾
+
+  std::vector<Chunk> chunks_;   // 数据段，[head_, size)为待发送部分
+  std::vector<Chunk> overflow_; // chunks_已满时追加的数据段，非空时chunks_中一定还有待发送数据段
+  size_t head_ = 0;           // 第一个待发送数据段的下标
+  size_t pending_bytes_ = 0;  // 待发送字节数
+};
+
+#endif
@@ -0,0 +1,411 @@
+#include "connection.h"
+#include "reactor.h"
+#include <charconv>
+
+namespace {
+// 每批最多处理的管线化请求数，每个响应占两个数据段，一批响应恰好可以由一次writev写出
+constexpr size_t MAX_PIPELINE_BATCH = 32;
+
+// 客户端发送请求体前等待的临时响应
+constexpr char CONTINUE_RESPONSE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+
+// 流式响应体每次生成的最大字节数（chunked编码时即一个chunk的大小）
+constexpr size_t RESPONSE_STREAM_BUFFER_SIZE = 64 * 1024;
+// chunk长度行（十六进制长度加CRLF）预留的字节数
+constexpr size_t CHUNK_SIZE_LINE_MAX = 2 * sizeof(size_t) + 2;
+// 每个chunk数据之后的CRLF
+constexpr std::string_view CHUNK_END = "\r\n";
+// 结束chunked编码的最后一个chunk（不带trailer）
+constexpr std::string_view LAST_CHUNK = "0\r\n\r\n";
+} // namespace
+
+Connection::Connection(Reactor &loop, int fd, uint64_t id,
+                       const Options &options, in_addr_t peer_address)
+    : loop_(loop), fd_(fd), id_(id), peer_address_(peer_address),
+      state_(kReading), keep_alive_(false), peer_closed_(false),
+      dispatching_(false), http11_(false), head_admitted_(false),
+      parser_(&arena_), stream_chunked_(false), stream_remaining_(0),
+      options_(options),
+      logger_(Logger::GetInstance(LOGFILE)) {
+  parser_.SetMaxBodySize(options_.max_body_size);
+}
+
+Connection::~Connection() {
+  if (state_ != kClosed) {
+    close(fd_);
+  }
+}
+
+int Connection::Fd() const { return fd_; }
+
+uint64_t Connection::Id() const { return id_; }
+
+in_addr_t Connection::PeerAddress() const { return peer_address_; }
+
+Reactor &Connection::GetLoop() const { return loop_; }
+
+bool Connection::IsClosed() const { return state_ == kClosed; }
+
+bool Connection::IsProcessing() const { return state_ == kProcessing; }
+
+bool Connection::CloseAfterWrite() const {
+  return state_ == kWriting && !keep_alive_ && !body_producer_;
+}
+
+Buffer &Connection::Input() { return input_; }
+
+OutputQueue &Connection::Output() { return output_; }
+
+RequestArena &Connection::Arena() { return arena_; }
+
+/**
+ * @brief 处理I/O后端读到的数据
+ *
+ * 只有处于kReading状态时才解析请求，处理中或写响应期间到达的数据（例如客户端提前发送的下一个请求）
+ * 留在缓冲区中，等当前响应写完后再解析。
+ *
+ * @param peer_closed 对端是否已关闭写端
+ */
+void Connection::OnInputReceived(bool peer_closed) {
+  if (state_ == kClosed) {
+    return;
+  }
+  loop_.TouchConnection(*this);
+  if (peer_closed) {
+    peer_closed_ = true;
+  }
+  if (state_ == kReading) {
+    ProcessInput();
+  }
+}
+
+/**
+ * @brief 依次解析输入缓冲区中的完整请求并交给上层
+ *
+ * 支持HTTP/1.1管线化：上层在回调中同步给出响应时，响应只进入输出队列，继续解析下一个请求，
+ * 一批请求处理完后再统一写出，多个响应合并为一次写操作。上层异步处理时停止解析，保证响应按请求顺序发送。
+ * 每批最多处理MAX_PIPELINE_BATCH个请求，剩余请求在本批响应写完后继续处理。
+ * 流式接收的请求体每解析出一段就交给处理器，随后从输入缓冲区移除，不会整体缓存。
+ * 请求从连接的内存池分配，解析器移出请求时不拷贝。
+ * 没有请求体的请求在交给上层之前做准入检查，被拒绝时直接回复429，连接保持。
+ * 请求非法时回复400、请求体过大时回复413并关闭连接；对端已关闭且没有完整请求时直接关闭。
+ * 输入缓冲区达到MAX_INPUT_BUFFER时I/O后端暂停读取，本次处理使它回落到高水位以下时恢复读取。
+ */
+void Connection::ProcessInput() {
+  std::shared_ptr<Connection> guard = shared_from_this();
+  bool input_full = input_.ReadableBytes() >= MAX_INPUT_BUFFER;
+  dispatching_ = true;
+  size_t batched = 0;
+  while (state_ == kReading && input_.ReadableBytes() > 0 &&
+         batched < MAX_PIPELINE_BATCH) {
+    HttpRequest request(&arena_);
+    size_t consumed = 0;
+    HttpRequest::ParseStatus status = parser_.Parse(
+        input_.Peek(), input_.ReadableBytes(), &request, &consumed);
+    if (status == HttpRequest::PARSE_ERROR) {
+      logger_.Log(Logger::WARN, "Malformed request, closing connection");
+      SendErrorAndClose(400, "Bad Request");
+      break;
+    }
+    if (status == HttpRequest::PARSE_TOO_LARGE) {
+      SendErrorAndClose(413, "Payload Too Large");
+      break;
+    }
+    // 请求体片段指向输入缓冲区，交给处理器之后才能消费
+    bool aborted = false;
+    if (body_reader_ && !parser_.BodyData().empty()) {
+      aborted = !body_reader_->OnBody(parser_.BodyData());
+    }
+    input_.Retrieve(consumed);
+    if (aborted) {
+      // 处理器拒绝了请求体：剩余的请求体不再接收，响应后关闭连接
+      if (status != HttpRequest::PARSE_COMPLETE) {
+        request = parser_.TakeRequest();
+      }
+      input_.RetrieveAll();
+      keep_alive_ = false;
+    } else if (status == HttpRequest::PARSE_HEAD_COMPLETE) {
+      if (!OnRequestHead()) {
+        break;
+      }
+      continue;
+    } else if (status == HttpRequest::PARSE_BODY_DATA) {
+      continue;
+    } else if (status == HttpRequest::PARSE_INCOMPLETE) {
+      break;
+    } else {
+      keep_alive_ = request.KeepAlive();
+    }
+    http11_ = request.GetVersion() == "HTTP/1.1";
+    body_reader_.reset();
+    state_ = kProcessing;
+    ++batched;
+    bool admitted = head_admitted_ || AdmitRequest(request);
+    head_admitted_ = false;
+    if (!admitted) {
+      SendTooManyRequests();
+      continue;
+    }
+    options_.request_callback(guard, request);
+  }
+  dispatching_ = false;
+  if (state_ == kClosed) {
+    return;
+  }
+  if (input_full && input_.ReadableBytes() < MAX_INPUT_BUFFER) {
+    // 输入缓冲区达到高水位后I/O后端暂停了读取，数据消费后恢复
+    loop_.ResumeRead(*this);
+  }
+  if (!output_.Empty()) {
+    // 仍有请求在异步处理时也先写出已完成的响应
+    if (state_ == kReading) {
+      state_ = kWriting;
+    }
+    loop_.StartWrite(*this);
+    return;
+  }
+  if (state_ == kReading && peer_closed_) {
+    Close();
+  }
+}
+
+/**
+ * @brief 请求头解析完成，请求体尚未接收
+ *
+ * 先做准入检查：被拒绝时回复429并关闭连接，请求体不再接收，也不创建流式处理器。
+ * 路由为该请求注册了流式处理器时请求体逐段交给处理器，否则缓存在请求中，
+ * Content-Length超过最大长度时直接回复413。客户端带有Expect: 100-continue且请求体尚未到达时，
+ * 先回复100 Continue。
+ *
+ * @return 可以继续接收请求体返回true
+ */
+bool Connection::OnRequestHead() {
+  HttpRequest &head = parser_.Request();
+  if (!AdmitRequest(head)) {
+    SendErrorAndClose(429, "Too Many Requests");
+    return false;
+  }
+  head_admitted_ = true;
+  // 请求体接收完之前不能关闭连接（例如100 Continue写完之后）
+  keep_alive_ = true;
+  if (options_.body_reader_factory) {
+    body_reader_ = options_.body_reader_factory(head);
+    head.SetBodyReader(body_reader_);
+  }
+  if (parser_.StartBody(body_reader_ != nullptr) ==
+      HttpRequest::PARSE_TOO_LARGE) {
+    SendErrorAndClose(413, "Payload Too Large");
+    return false;
+  }
+  if (input_.ReadableBytes() == 0 &&
+      EqualsIgnoreCase(head.GetHeader(HEADER_EXPECT), "100-continue")) {
+    output_.AppendView(
+        std::string_view(CONTINUE_RESPONSE, sizeof(CONTINUE_RESPONSE) - 1));
+  }
+  return true;
+}
+
+bool Connection::AdmitRequest(const HttpRequest &head) const {
+  return !options_.request_filter || options_.request_filter(*this, head);
+}
+
+void Connection::SendTooManyRequests() {
+  HttpResponse response(&arena_);
+  response.SetStatusCode(429);
+  response.SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
+  response.SetHeader(HEADER_RETRY_AFTER, "1");
+  response.SetBody("Too Many Requests");
+  SendResponse(response);
+}
+
+void Connection::SendErrorAndClose(int status, std::string_view body) {
+  HttpResponse response(&arena_);
+  response.SetStatusCode(status);
+  response.SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
+  if (status == 429) {
+    response.SetHeader(HEADER_RETRY_AFTER, "1");
+  }
+  response.SetBody(body);
+  body_reader_.reset();
+  head_admitted_ = false;
+  parser_.Reset();
+  keep_alive_ = false;
+  state_ = kProcessing;
+  SendResponse(response);
+}
+
+/**
+ * @brief 发送当前请求的响应
+ *
+ * 响应头在连接的内存池中构造，和响应体作为两个数据段放入输出队列，由I/O后端聚合写出，响应体不会被拼接拷贝；
+ * 文件响应体作为文件数据段排队，由sendfile发送。流式响应体先生成第一段，其余部分在输出队列写空后逐段生成，
+ * 流式响应写完之前连接保持kWriting，管线化的后续请求等它写完再处理。
+ * 在ProcessInput的批处理过程中同步调用时只排队，由ProcessInput统一写出。
+ * 内核发送缓冲区已满时剩余数据留在队列中，等套接字可写时继续发送，不会阻塞当前线程。
+ *
+ * @param response 待发送的响应
+ */
+void Connection::SendResponse(HttpResponse &response) {
+  if (state_ != kProcessing) {
+    return;
+  }
+  if (response.HasBodyProducer()) {
+    StartBodyStream(response);
+  }
+  response.SetKeepAlive(keep_alive_);
+  output_.AppendView(response.BuildHeaders(&arena_));
+  output_.Append(response.ReleaseBody());
+  output_.AppendShared(response.ReleaseSharedBody());
+  output_.AppendFile(response.ReleaseFileBody());
+  if (body_producer_) {
+    ProduceBody();
+  }
+  loop_.TouchConnection(*this);
+  if (dispatching_) {
+    // 发送缓冲区中的数据写出之前不能处理下一个请求，否则下一个流式响应会覆盖它
+    state_ = keep_alive_ && stream_buffer_.empty() ? kReading : kWriting;
+    return;
+  }
+  state_ = kWriting;
+  loop_.StartWrite(*this);
+}
+
+/**
+ * @brief 开始发送流式响应体
+ *
+ * 长度已知时按Content-Length发送；长度未知时HTTP/1.1请求使用chunked编码，
+ * HTTP/1.0请求不支持chunked，发送完后关闭连接来标记响应体结束。
+ * 1xx、204和304响应没有响应体，不调用生产者。
+ *
+ * @param response 带有流式响应体的响应
+ */
+void Connection::StartBodyStream(HttpResponse &response) {
+  std::shared_ptr<ResponseBodyProducer> producer =
+      response.ReleaseBodyProducer();
+  int status = response.GetStatusCode();
+  if (status < 200 || status == 204 || status == 304) {
+    return;
+  }
+  stream_remaining_ = response.BodyProducerLength();
+  stream_chunked_ = false;
+  if (stream_remaining_ == UNKNOWN_BODY_LENGTH) {
+    if (http11_) {
+      stream_chunked_ = true;
+      response.SetHeader(HEADER_TRANSFER_ENCODING, "chunked");
+    } else {
+      keep_alive_ = false;
+    }
+  }
+  body_producer_ = std::move(producer);
+}
+
+/**
+ * @brief 生成下一段流式响应体放入输出队列
+ *
+ * 反复调用生产者直到填满发送缓冲区或响应体结束，整段作为一个数据段（chunked编码时为一个chunk）排队，
+ * 生产者每次只写出几个字节时也不会产生大量小数据段。只有输出队列写空后才生成下一段，
+ * 每个连接最多缓存一段响应体。长度已知的响应体不会生成超过声明长度的数据，
+ * 提前结束或生产者出错时发送完已生成的部分后关闭连接，客户端能够发现响应体不完整。
+ */
+void Connection::ProduceBody() {
+  if (stream_buffer_.empty()) {
+    stream_buffer_.resize(CHUNK_SIZE_LINE_MAX + RESPONSE_STREAM_BUFFER_SIZE +
+                          CHUNK_END.size() + LAST_CHUNK.size());
+  }
+  char *data = &stream_buffer_[CHUNK_SIZE_LINE_MAX];
+  size_t capacity = std::min(RESPONSE_STREAM_BUFFER_SIZE, stream_remaining_);
+  size_t size = 0;
+  ResponseBodyProducer::Status status = ResponseBodyProducer::BODY_MORE;
+  while (size < capacity && status == ResponseBodyProducer::BODY_MORE) {
+    size_t written = 0;
+    status = body_producer_->Read(data + size, capacity - size, &written);
+    if (status == ResponseBodyProducer::BODY_MORE && written == 0) {
+      logger_.Log(Logger::ERROR, "Response body producer made no progress");
+      status = ResponseBodyProducer::BODY_ERROR;
+    }
+    size += std::min(written, capacity - size);
+  }
+  if (stream_remaining_ != UNKNOWN_BODY_LENGTH) {
+    stream_remaining_ -= size;
+    if (stream_remaining_ == 0 && status == ResponseBodyProducer::BODY_MORE) {
+      status = ResponseBodyProducer::BODY_END;
+    } else if (stream_remaining_ > 0 &&
+               status == ResponseBodyProducer::BODY_END) {
+      logger_.Log(Logger::ERROR, "Response body shorter than Content-Length");
+      status = ResponseBodyProducer::BODY_ERROR;
+    }
+  }
+  char *begin = data;
+  char *end = data + size;
+  if (stream_chunked_ && size > 0) {
+    char line[CHUNK_SIZE_LINE_MAX];
+    char *line_end = std::to_chars(line, line + sizeof(line), size, 16).ptr;
+    *line_end++ = '\r';
+    *line_end++ = '\n';
+    begin -= line_end - line;
+    memcpy(begin, line, line_end - line);
+    memcpy(end, CHUNK_END.data(), CHUNK_END.size());
+    end += CHUNK_END.size();
+  }
+  if (stream_chunked_ && status == ResponseBodyProducer::BODY_END) {
+    memcpy(end, LAST_CHUNK.data(), LAST_CHUNK.size());
+    end += LAST_CHUNK.size();
+  }
+  if (end > begin) {
+    output_.AppendView(std::string_view(begin, end - begin));
+  }
+  if (status != ResponseBodyProducer::BODY_MORE) {
+    body_producer_.reset();
+    if (status == ResponseBodyProducer::BODY_ERROR) {
+      keep_alive_ = false;
+    }
+  }
+}
+
+/**
+ * @brief 输出队列已全部写出
+ *
+ * 流式响应体尚未发送完时生成下一段继续写出。
+ * 写出的是批处理中已完成的响应而下一个请求仍在处理时，保持kProcessing等待其响应。
+ * 否则本轮的请求和响应都已处理完，内存池一次性复位；请求头已解析、请求体还在接收的请求
+ * （管线化的下一个请求，或刚写完100 Continue）先移出内存池，复位后再移回，
+ * 持续管线化的客户端不会让内存池无限增长。
+ */
+void Connection::OnWriteComplete() {
+  if (state_ != kWriting) {
+    return;
+  }
+  if (body_producer_) {
+    loop_.TouchConnection(*this);
+    ProduceBody();
+    loop_.StartWrite(*this);
+    return;
+  }
+  if (!stream_buffer_.empty()) {
+    std::string().swap(stream_buffer_);
+  }
+  if (!keep_alive_) {
+    Close();
+    return;
+  }
+  if (parser_.InProgress()) {
+    // 下一个请求已部分到达：移出内存池，复位后再移回，内存池在每轮响应写完后都能复位
+    std::string partial = parser_.DetachRequest();
+    arena_.Reset();
+    parser_.AttachRequest(partial);
+  } else {
+    arena_.Reset();
+  }
+  state_ = kReading;
+  ProcessInput();
+}
+
+void Connection::Close() {
+  if (state_ == kClosed) {
+    return;
+  }
+  std::shared_ptr<Connection> guard = shared_from_this();
+  state_ = kClosed;
+  body_producer_.reset();
+  loop_.RemoveConnection(*this);
+}
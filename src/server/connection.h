@@ -0,0 +1,127 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+#include "common.h"
+#include "buffer.h"
+#include "http_conn.h"
+#include "http_parser.h"
+#include "logger.h"
+#include "request_arena.h"
+
+class Reactor;
+
+// 输入缓冲区的高水位：缓存的未处理数据达到该长度后暂停读取，等数据被消费后再恢复。
+// 必须大于MAX_HEADER_SIZE，否则不完整的请求头可能永远等不到剩余数据
+constexpr size_t MAX_INPUT_BUFFER = 256 * 1024;
+static_assert(MAX_INPUT_BUFFER > MAX_HEADER_SIZE,
+              "input high-water mark must hold a complete request head");
+
+// 一个客户端连接：缓存跨多次读取的输入，增量解析出完整请求后交给上层处理，并在同一连接上发送响应。
+// Connection只维护协议状态，套接字读写由所属Reactor的I/O后端（epoll或io_uring）完成。
+// 除特别说明外，所有成员函数只能在所属Reactor的事件循环线程中调用。
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+  // 收到完整请求时的回调，处理完成后需调用SendResponse
+  using RequestCallback =
+      std::function<void(const std::shared_ptr<Connection> &, HttpRequest &)>;
+  // 请求头到达、任何处理之前调用，返回false时直接回复429（请求带有请求体时回复后关闭连接）
+  using RequestFilter =
+      std::function<bool(const Connection &, const HttpRequest &)>;
+  // 请求头解析完、请求体到达之前调用，返回非空时请求体逐段交给它，不在内存中缓存；
+  // 可以在请求头中记录路由参数
+  using BodyReaderFactory =
+      std::function<std::shared_ptr<RequestBodyReader>(HttpRequest &)>;
+
+  // 请求处理配置，由Server创建，同一事件循环的所有连接共享
+  struct Options {
+    RequestCallback request_callback;      // 请求处理回调
+    RequestFilter request_filter;          // 请求准入检查，可以为空
+    BodyReaderFactory body_reader_factory; // 流式接收请求体的处理器，可以为空
+    size_t max_body_size = DEFAULT_MAX_BODY_SIZE; // 缓存请求体的最大长度
+  };
+
+  Connection(Reactor &loop, int fd, uint64_t id, const Options &options,
+             in_addr_t peer_address = htonl(INADDR_ANY));
+  ~Connection();
+
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  int Fd() const;
+  uint64_t Id() const;
+  // 客户端IPv4地址（网络字节序），未取得时为INADDR_ANY
+  in_addr_t PeerAddress() const;
+  Reactor &GetLoop() const;
+  bool IsClosed() const;
+  // 请求是否正在由上层处理（处理期间连接没有读写活动，不应按空闲超时关闭）
+  bool IsProcessing() const;
+  // 输出队列写完后是否关闭连接
+  bool CloseAfterWrite() const;
+
+  // 输入缓冲区，I/O后端把读到的数据追加到这里
+  Buffer &Input();
+  // 输出队列，I/O后端从这里取数据写出
+  OutputQueue &Output();
+  // 请求级内存池：本连接的请求、响应头和响应体从这里分配，本轮响应全部写完后复位。
+  // 只能在事件循环线程中使用
+  RequestArena &Arena();
+
+  // I/O后端读到新数据（或对端关闭）后调用
+  void OnInputReceived(bool peer_closed);
+  // I/O后端写完输出队列中的全部数据后调用
+  void OnWriteComplete();
+  // 发送当前请求的响应，管线化的后续请求在响应排队后继续处理
+  void SendResponse(HttpResponse &response);
+  // 关闭连接并从所属事件循环中移除
+  void Close();
+
+private:
+  friend class Reactor; // Reactor维护空闲链表中的位置和最近活跃时间
+
+  // 连接状态
+  enum State {
+    kReading,    // 等待完整请求
+    kProcessing, // 请求已交给上层处理，等待响应
+    kWriting,    // 响应尚未完全写出
+    kClosed      // 已关闭
+  };
+
+  void ProcessInput(); // 依次解析并分发输入缓冲区中的完整请求
+  // 请求头解析完成：选择请求体的接收方式，需要时回复100 Continue
+  bool OnRequestHead();
+  // 回复错误响应并在写完后关闭连接
+  void SendErrorAndClose(int status, std::string_view body);
+  // 请求准入检查，没有配置时总是接受
+  bool AdmitRequest(const HttpRequest &head) const;
+  // 回复429，不经过上层处理
+  void SendTooManyRequests();
+  // 开始发送流式响应体：选择chunked编码或发送完后关闭连接
+  void StartBodyStream(HttpResponse &response);
+  // 生成下一段流式响应体放入输出队列
+  void ProduceBody();
+
+  Reactor &loop_;                   // 所属事件循环
+  int fd_;                          // 客户端套接字
+  uint64_t id_;                     // 连接编号，在所属事件循环内唯一，不随fd复用
+  in_addr_t peer_address_;          // 客户端IPv4地址
+  State state_;                     // 连接状态
+  bool keep_alive_;                 // 当前请求是否保持连接
+  bool peer_closed_;                // 对端是否已关闭写端
+  bool dispatching_;                // 是否正在批量分发管线化请求，此时响应只排队不写出
+  bool http11_;                     // 当前请求是否为HTTP/1.1，可以使用chunked编码
+  bool head_admitted_;              // 当前请求已在请求头阶段通过准入检查
+  RequestArena arena_;              // 请求级内存池，必须在使用它的解析器和输出队列之前构造、之后析构
+  Buffer input_;                    // 输入缓冲区
+  HttpParser parser_;               // 请求解析器，保存跨多次读取的解析进度
+  std::shared_ptr<RequestBodyReader> body_reader_; // 当前请求的流式请求体处理器
+  OutputQueue output_;              // 输出队列
+  std::shared_ptr<ResponseBodyProducer> body_producer_; // 正在发送的流式响应体
+  bool stream_chunked_;             // 流式响应体是否使用chunked编码
+  size_t stream_remaining_;         // 流式响应体尚未生成的字节数，长度未知时为UNKNOWN_BODY_LENGTH
+  std::string stream_buffer_;       // 流式响应体的发送缓冲区，输出队列写空后才复用，发送结束后释放
+  const Options &options_;          // 请求处理配置（由所属Reactor持有）
+  std::list<Connection *>::iterator idle_pos_;        // 在所属Reactor空闲链表中的位置
+  std::chrono::steady_clock::time_point last_active_; // 最近一次读写活动时间
+  Logger &logger_;                  // 日志记录器
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "epoll_reactor.h"
+
+EpollReactor::EpollReactor(int listen_fd, AdmissionControl &admission,
+                           Connection::Options options)
+    : Reactor(listen_fd, admission, std::move(options)),
+      epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+  if (epoll_fd_ < 0) {
+    throw std::runtime_error("epoll_create1 failed: " +
+                             std::string(strerror(errno)));
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+  event.data.fd = wakeup_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event);
+}
+
+EpollReactor::~EpollReactor() {
+  CloseAllConnections();
+  close(epoll_fd_);
+}
+
+/**
+ * @brief 运行事件循环
+ *
+ * 监听套接字上的事件在本线程内完成accept，连接上的事件交给对应的Connection处理，
+ * 每轮事件处理完后执行其他线程投递的任务（例如线程池处理完请求后回写响应）。
+ */
+void EpollReactor::Loop() {
+  running_.store(true);
+  epoll_event events[MAX_EVENTS];
+  while (running_.load()) {
+    int epoll_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+    if (epoll_count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      logger_.Log(Logger::ERROR,
+                  "epoll_wait failed: " + std::string(strerror(errno)));
+      break;
+    }
+    loop_time_ = std::chrono::steady_clock::now();
+    for (int i = 0; i < epoll_count; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == listen_fd_) {
+        HandleAccept();
+      } else if (fd == wakeup_fd_) {
+        uint64_t value = 0;
+        ssize_t n = read(wakeup_fd_, &value, sizeof(value));
+        (void)n;
+      } else {
+        // 持有一份引用，防止处理过程中连接关闭导致对象被析构
+        std::shared_ptr<Connection> conn = FindConnection(fd);
+        if (conn) {
+          HandleEvent(*conn, events[i].events);
+        }
+      }
+    }
+    DoPendingTasks();
+  }
+}
+
+/**
+ * @brief 接收新连接
+ *
+ * 监听套接字是水平触发的，但仍一次循环accept4直到EAGAIN，减少高并发建连时的epoll_wait次数。
+ * 新连接直接以非阻塞方式创建；连接数达到上限时回复503后立即关闭，不进入事件循环。
+ * 连接注册时同时关注EPOLLIN和EPOLLOUT（边缘触发），发送缓冲区从满变为可写时会收到一次通知，
+ * 不需要在每次写阻塞时再用epoll_ctl开关EPOLLOUT。
+ */
+void EpollReactor::HandleAccept() {
+  while (true) {
+    int client_fd =
+        accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno == EMFILE || errno == ENFILE) {
+        HandleFdExhausted();
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        logger_.Log(Logger::ERROR,
+                    "accept4 failed: " + std::string(strerror(errno)));
+      }
+      return;
+    }
+    if (!AddConnection(client_fd)) {
+      continue;
+    }
+    epoll_event client_event{};
+    client_event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    client_event.data.fd = client_fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &client_event);
+  }
+}
+
+void EpollReactor::HandleEvent(Connection &conn, uint32_t events) {
+  if ((events & (EPOLLHUP | EPOLLERR)) && !(events & EPOLLIN)) {
+    conn.Close();
+    return;
+  }
+  if (events & (EPOLLIN | EPOLLRDHUP)) {
+    HandleRead(conn);
+  }
+  if ((events & EPOLLOUT) && !conn.IsClosed() && !conn.Output().Empty()) {
+    StartWrite(conn);
+  }
+}
+
+/**
+ * @brief 处理可读事件
+ *
+ * 边缘触发模式下一次读空套接字，数据追加到连接的输入缓冲区后交给Connection解析。
+ * 输入缓冲区达到MAX_INPUT_BUFFER时停止读取，剩余数据留在内核中，由ResumeRead再次读取。
+ */
+void EpollReactor::HandleRead(Connection &conn) {
+  if (conn.IsClosed()) {
+    return;
+  }
+  bool peer_closed = false;
+  int saved_errno = 0;
+  ssize_t n = conn.Input().ReadFd(conn.Fd(), MAX_INPUT_BUFFER, &peer_closed,
+                                  &saved_errno);
+  if (n < 0) {
+    logger_.Log(Logger::ERROR, "Failed to read from client: " +
+                                   std::string(strerror(saved_errno)));
+    conn.Close();
+    return;
+  }
+  if (n > 0 || peer_closed) {
+    conn.OnInputReceived(peer_closed);
+  }
+}
+
+void EpollReactor::StartWrite(Connection &conn) {
+  int saved_errno = 0;
+  switch (conn.Output().WriteFd(conn.Fd(), &saved_errno)) {
+  case OutputQueue::WRITE_COMPLETE:
+    conn.OnWriteComplete();
+    break;
+  case OutputQueue::WRITE_AGAIN:
+    // 等待边缘触发的EPOLLOUT
+    TouchConnection(conn);
+    break;
+  case OutputQueue::WRITE_ERROR:
+    logger_.Log(Logger::ERROR, "Failed to send response: " +
+                                   std::string(strerror(saved_errno)));
+    conn.Close();
+    break;
+  }
+}
+
+/**
+ * @brief 输入缓冲区回落到高水位以下后恢复读取
+ *
+ * 边缘触发不会为留在内核中的数据再次通知，需要主动读取。调用方是Connection的处理流程，
+ * 推迟到当前调用栈结束后读取，避免重入。
+ */
+void EpollReactor::ResumeRead(Connection &conn) {
+  std::weak_ptr<Connection> weak = conn.shared_from_this();
+  QueueInLoop([this, weak]() {
+    std::shared_ptr<Connection> conn = weak.lock();
+    if (conn) {
+      HandleRead(*conn);
+    }
+  });
+}
+
+void EpollReactor::OnConnectionRemoved(Connection &conn) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn.Fd(), nullptr);
+  close(conn.Fd());
+}
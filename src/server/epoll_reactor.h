@@ -0,0 +1,27 @@
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+#include "reactor.h"
+
+// 基于epoll边缘触发的I/O后端
+class EpollReactor : public Reactor {
+public:
+  EpollReactor(int listen_fd, AdmissionControl &admission,
+               Connection::Options options);
+  ~EpollReactor() override;
+
+  void Loop() override;
+  void StartWrite(Connection &conn) override;
+  void ResumeRead(Connection &conn) override;
+
+protected:
+  void OnConnectionRemoved(Connection &conn) override;
+
+private:
+  void HandleAccept();       // 接收所有待处理的新连接并注册到本循环
+  void HandleEvent(Connection &conn, uint32_t events); // 处理连接上的事件
+  void HandleRead(Connection &conn);                   // 读空套接字
+
+  int epoll_fd_; // epoll实例
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "io_uring.h"
+
+#ifdef TINY_SERVER_HAS_IO_URING
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace {
+int SysSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysEnter(int fd, unsigned to_submit, unsigned min_complete,
+             unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int SysRegister(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+} // namespace
+
+/**
+ * @brief 创建io_uring实例并映射提交/完成队列
+ *
+ * 优先启用COOP_TASKRUN和SUBMIT_ALL，内核不支持时退回默认参数。
+ * 内核不支持io_uring或被禁用时抛出std::runtime_error，由调用方退回epoll。
+ */
+IoUring::IoUring(unsigned entries, unsigned cq_factor)
+    : ring_fd_(-1), sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)),
+      sqe_head_(0), sqe_tail_(0), sq_ring_ptr_(MAP_FAILED), sq_ring_size_(0),
+      cq_ring_ptr_(MAP_FAILED), cq_ring_size_(0), sqes_size_(0) {
+  io_uring_params params{};
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN |
+                 IORING_SETUP_SUBMIT_ALL;
+  params.cq_entries = entries * cq_factor;
+  ring_fd_ = SysSetup(entries, &params);
+  if (ring_fd_ < 0 && errno == EINVAL) {
+    params = io_uring_params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * cq_factor;
+    ring_fd_ = SysSetup(entries, &params);
+  }
+  if (ring_fd_ < 0) {
+    throw std::runtime_error("io_uring_setup failed: " +
+                             std::string(strerror(errno)));
+  }
+  if (!(params.features & IORING_FEAT_NODROP)) {
+    Release();
+    throw std::runtime_error("io_uring lacks IORING_FEAT_NODROP");
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ptr_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ptr_ != MAP_FAILED) {
+    cq_ring_ptr_ = single_mmap
+                       ? sq_ring_ptr_
+                       : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring_fd_,
+                              IORING_OFF_CQ_RING);
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  if (cq_ring_ptr_ != MAP_FAILED) {
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  }
+  if (sqes_ == MAP_FAILED) {
+    std::string error = strerror(errno);
+    Release();
+    throw std::runtime_error("io_uring mmap failed: " + error);
+  }
+
+  char *sq = static_cast<char *>(sq_ring_ptr_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_entries_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_ptr_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  sqe_head_ = sqe_tail_ = *sq_tail_;
+}
+
+IoUring::~IoUring() { Release(); }
+
+void IoUring::Release() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ptr_ != MAP_FAILED && cq_ring_ptr_ != sq_ring_ptr_) {
+    munmap(cq_ring_ptr_, cq_ring_size_);
+  }
+  if (sq_ring_ptr_ != MAP_FAILED) {
+    munmap(sq_ring_ptr_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+  sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+  cq_ring_ptr_ = sq_ring_ptr_ = MAP_FAILED;
+  ring_fd_ = -1;
+}
+
+io_uring_sqe *IoUring::GetSqe() {
+  unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sqe_tail_ - head >= *sq_entries_) {
+    // 提交队列已满：先把已填写的项交给内核
+    SubmitAndWait(0);
+    head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= *sq_entries_) {
+      return nullptr;
+    }
+  }
+  io_uring_sqe *sqe = &sqes_[sqe_tail_ & *sq_mask_];
+  ++sqe_tail_;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+unsigned IoUring::FlushSq() {
+  unsigned tail = *sq_tail_;
+  while (sqe_head_ != sqe_tail_) {
+    sq_array_[tail & *sq_mask_] = sqe_head_ & *sq_mask_;
+    ++tail;
+    ++sqe_head_;
+  }
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+  return tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief 提交并等待完成事件
+ *
+ * 一次io_uring_enter同时完成本轮所有请求的提交和等待，这是io_uring后端减少系统调用的关键。
+ *
+ * @param wait_nr 至少等待的完成事件数，0表示只提交不等待
+ * @return 成功提交的数量，失败返回负的errno
+ */
+int IoUring::SubmitAndWait(unsigned wait_nr) {
+  unsigned to_submit = FlushSq();
+  if (to_submit == 0 && wait_nr == 0) {
+    return 0;
+  }
+  unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+  int ret = SysEnter(ring_fd_, to_submit, wait_nr, flags);
+  return ret < 0 ? -errno : ret;
+}
+
+int IoUring::RegisterBufferRing(io_uring_buf_ring *ring, unsigned entries,
+                                unsigned short group_id) {
+  io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+  reg.ring_entries = entries;
+  reg.bgid = group_id;
+  int ret = SysRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1);
+  return ret < 0 ? -errno : 0;
+}
+
+#endif // TINY_SERVER_HAS_IO_URING
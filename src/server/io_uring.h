@@ -0,0 +1,76 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+#include "common.h"
+
+#ifdef TINY_SERVER_HAS_IO_URING
+#include <linux/io_uring.h>
+
+// io_uring的最小封装：直接使用系统调用和共享内存环，不依赖liburing。
+// 只在创建它的事件循环线程中使用，不是线程安全的。
+class IoUring {
+public:
+  // entries为提交队列大小，完成队列大小为其cq_factor倍（多次触发的accept/recv会产生较多完成事件）
+  explicit IoUring(unsigned entries, unsigned cq_factor = 4);
+  ~IoUring();
+
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  // 获取一个空闲的提交项，提交队列已满时先提交已填写的项再重试，仍失败返回nullptr
+  io_uring_sqe *GetSqe();
+  // 提交所有已填写的提交项，并等待至少wait_nr个完成事件
+  int SubmitAndWait(unsigned wait_nr);
+  // 依次处理所有已到达的完成事件，返回处理的个数
+  template <typename Handler> unsigned ForEachCqe(Handler &&handler);
+
+  // 注册一个提供缓冲区环，返回0表示成功，否则为负的errno
+  int RegisterBufferRing(io_uring_buf_ring *ring, unsigned entries,
+                         unsigned short group_id);
+  // 解除映射并关闭实例，可以重复调用，之后不能再使用
+  void Release();
+
+private:
+  unsigned FlushSq(); // 把本地填写的提交项发布给内核，返回待提交的数量
+
+  int ring_fd_;                 // io_uring实例
+  // 提交队列
+  unsigned *sq_head_;           // 内核消费位置
+  unsigned *sq_tail_;           // 用户生产位置
+  unsigned *sq_mask_;
+  unsigned *sq_entries_;
+  unsigned *sq_array_;
+  io_uring_sqe *sqes_;
+  unsigned sqe_head_;           // 本地已发布的位置
+  unsigned sqe_tail_;           // 本地已填写的位置
+  // 完成队列
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  io_uring_cqe *cqes_;
+  // 映射的内存
+  void *sq_ring_ptr_;
+  size_t sq_ring_size_;
+  void *cq_ring_ptr_;
+  size_t cq_ring_size_;
+  size_t sqes_size_;
+};
+
+template <typename Handler> unsigned IoUring::ForEachCqe(Handler &&handler) {
+  unsigned head = *cq_head_;
+  unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  unsigned count = 0;
+  while (head != tail) {
+    handler(cqes_[head & *cq_mask_]);
+    ++head;
+    ++count;
+    // 每处理一个就归还，处理过程中提交的新请求产生的完成事件不会因队列满而溢出
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    if (head == tail) {
+      tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    }
+  }
+  return count;
+}
+
+#endif // TINY_SERVER_HAS_IO_URING
+#endif
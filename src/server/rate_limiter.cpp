@@ -0,0 +1,162 @@
+#include "rate_limiter.h"
+
+RateLimiter::RateLimiter() : max_connections_per_ip_(0) {}
+
+void RateLimiter::SetMaxConnectionsPerIp(size_t max_connections) {
+  max_connections_per_ip_ = max_connections;
+}
+
+void RateLimiter::AddRule(const std::string &method, const std::string &path,
+                          RateLimit limit) {
+  if (!(limit.rate_ > 0) || !(limit.burst_ > 0)) {
+    throw std::runtime_error("Invalid rate limit for " + method + " " + path);
+  }
+  MethodRules *entry = nullptr;
+  for (MethodRules &rules : rules_) {
+    if (rules.method_ == method) {
+      entry = &rules;
+      break;
+    }
+  }
+  if (entry == nullptr) {
+    rules_.push_back(MethodRules{method, RouteTree()});
+    entry = &rules_.back();
+  }
+  entry->tree_.Insert(path, limits_.size());
+  limits_.push_back(limit);
+}
+
+bool RateLimiter::HasConnectionLimit() const {
+  return max_connections_per_ip_ > 0;
+}
+
+bool RateLimiter::HasRules() const { return !limits_.empty(); }
+
+RateLimiter::Shard &RateLimiter::ShardFor(in_addr_t ip) {
+  // 乘法哈希后按高位映射到分片，同一网段的相邻地址也能分散到不同分片
+  uint32_t hash = static_cast<uint32_t>(ip) * 0x9E3779B1u;
+  return shards_[(static_cast<uint64_t>(hash) * RATE_LIMITER_SHARDS) >> 32];
+}
+
+int64_t RateLimiter::NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool RateLimiter::AcquireConnection(in_addr_t ip) {
+  if (max_connections_per_ip_ == 0) {
+    return true;
+  }
+  Shard &shard = ShardFor(ip);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  Client &client = shard.clients_[ip];
+  if (client.connections_ >= max_connections_per_ip_) {
+    return false;
+  }
+  ++client.connections_;
+  return true;
+}
+
+void RateLimiter::ReleaseConnection(in_addr_t ip) {
+  if (max_connections_per_ip_ == 0) {
+    return;
+  }
+  Shard &shard = ShardFor(ip);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  auto it = shard.clients_.find(ip);
+  if (it != shard.clients_.end() && it->second.connections_ > 0) {
+    --it->second.connections_;
+  }
+}
+
+bool RateLimiter::MatchRule(const HttpRequest &request, size_t *rule) const {
+  std::string_view method = request.GetMethod();
+  for (const MethodRules &rules : rules_) {
+    if (rules.method_ != method) {
+      continue;
+    }
+    std::string_view path = request.GetPath();
+    path = path.substr(0, path.find('?'));
+    RouteMatch match;
+    if (!rules.tree_.Find(path, &match)) {
+      return false;
+    }
+    *rule = match.route_;
+    return true;
+  }
+  return false;
+}
+
+void RateLimiter::Refill(Bucket &bucket, const RateLimit &limit, int64_t now) {
+  double elapsed = static_cast<double>(now - bucket.last_) / 1e9;
+  bucket.tokens_ = std::min(limit.burst_, bucket.tokens_ + elapsed * limit.rate_);
+  bucket.last_ = now;
+}
+
+/**
+ * @brief 判断是否接受请求
+ *
+ * 规则匹配在加锁之前完成，临界区内只补充并消耗一个令牌。
+ * 客户端第一次命中规则时令牌桶是满的，可以立即发送burst个请求。
+ *
+ * @param ip 客户端IP（网络字节序）
+ * @param request 请求（只需要请求行）
+ * @return 接受请求返回true，应回复429时返回false
+ */
+bool RateLimiter::AllowRequest(in_addr_t ip, const HttpRequest &request) {
+  size_t rule = 0;
+  if (!MatchRule(request, &rule)) {
+    return true;
+  }
+  const RateLimit &limit = limits_[rule];
+  int64_t now = NowNanos();
+  Shard &shard = ShardFor(ip);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  Client &client = shard.clients_[ip];
+  if (client.buckets_.empty()) {
+    client.buckets_.resize(limits_.size());
+    for (size_t i = 0; i < limits_.size(); ++i) {
+      client.buckets_[i].tokens_ = limits_[i].burst_;
+      client.buckets_[i].last_ = now;
+    }
+  }
+  Bucket &bucket = client.buckets_[rule];
+  Refill(bucket, limit, now);
+  if (bucket.tokens_ < 1) {
+    return false;
+  }
+  bucket.tokens_ -= 1;
+  return true;
+}
+
+/**
+ * @brief 清理空闲的客户端
+ *
+ * 没有连接、全部令牌桶都已补满的客户端与从未出现过的客户端状态相同，可以删除。
+ * 逐个分片加锁，每次只阻塞落在同一分片的请求。
+ *
+ * @return 删除的客户端数
+ */
+size_t RateLimiter::Sweep() {
+  int64_t now = NowNanos();
+  size_t removed = 0;
+  for (Shard &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    for (auto it = shard.clients_.begin(); it != shard.clients_.end();) {
+      Client &client = it->second;
+      bool idle = client.connections_ == 0;
+      for (size_t i = 0; idle && i < client.buckets_.size(); ++i) {
+        Refill(client.buckets_[i], limits_[i], now);
+        idle = client.buckets_[i].tokens_ >= limits_[i].burst_;
+      }
+      if (idle) {
+        it = shard.clients_.erase(it);
+        ++removed;
+      } else {
+        ++it;
+      }
+    }
+  }
+  return removed;
+}
@@ -0,0 +1,79 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+#include "common.h"
+#include "http_conn.h"
+#include "route_tree.h"
+
+constexpr size_t RATE_LIMITER_SHARDS = 64; // 客户端表的分片数，每个分片一把锁
+
+// 令牌桶参数
+struct RateLimit {
+  double rate_ = 0;  // 每秒补充的令牌数，即允许的平均请求速率
+  double burst_ = 0; // 桶容量，即允许的突发请求数
+};
+
+// 按客户端IP的准入控制：限制每个IP的并发连接数，并按路由用令牌桶限制每个IP的请求速率。
+// 客户端状态保存在按IP哈希分片的表中，每个分片一把锁，不同IP的连接和请求很少竞争同一把锁。
+// 配置（SetMaxConnectionsPerIp、AddRule）需在服务启动前完成，之后的成员函数都是线程安全的。
+class RateLimiter {
+public:
+  RateLimiter();
+
+  RateLimiter(const RateLimiter &) = delete;
+  RateLimiter &operator=(const RateLimiter &) = delete;
+
+  // 每个IP的最大并发连接数，0表示不限制
+  void SetMaxConnectionsPerIp(size_t max_connections);
+  // 限制匹配method和path的请求速率。path的写法与路由相同，可以含有参数和通配符（如"/api/*rest"），
+  // 同一请求匹配多条规则时使用最具体的一条（静态路径优先于参数，参数优先于通配符）；
+  // rate或burst不是正数时抛出std::runtime_error
+  void AddRule(const std::string &method, const std::string &path,
+               RateLimit limit);
+  bool HasConnectionLimit() const;
+  bool HasRules() const;
+
+  // 接入新连接：未超过上限时该IP的连接数加一并返回true
+  bool AcquireConnection(in_addr_t ip);
+  // 连接关闭，与返回true的AcquireConnection一一对应
+  void ReleaseConnection(in_addr_t ip);
+  // 请求头到达时调用：匹配的规则还有令牌时消耗一个并返回true，没有匹配的规则时返回true
+  bool AllowRequest(in_addr_t ip, const HttpRequest &request);
+  // 删除没有连接且令牌桶已补满的客户端，返回删除的个数；由定时任务周期调用，限制表的大小
+  size_t Sweep();
+
+private:
+  // 一个令牌桶
+  struct Bucket {
+    double tokens_ = 0; // 当前令牌数
+    int64_t last_ = 0;  // 上次补充令牌的时间（纳秒）
+  };
+  // 一个客户端IP的状态
+  struct Client {
+    size_t connections_ = 0;      // 当前连接数
+    std::vector<Bucket> buckets_; // 每条规则一个令牌桶，下标为规则编号，第一次请求时创建
+  };
+  // 一个分片，独占缓存行，避免相邻分片的锁互相干扰
+  struct alignas(64) Shard {
+    std::mutex mutex_;
+    std::unordered_map<in_addr_t, Client> clients_;
+  };
+  // 一个HTTP方法的规则树，树中保存规则编号
+  struct MethodRules {
+    std::string method_;
+    RouteTree tree_;
+  };
+
+  Shard &ShardFor(in_addr_t ip);
+  // 查找请求匹配的规则编号
+  bool MatchRule(const HttpRequest &request, size_t *rule) const;
+  // 按经过的时间补充令牌，不超过桶容量
+  static void Refill(Bucket &bucket, const RateLimit &limit, int64_t now);
+  static int64_t NowNanos();
+
+  size_t max_connections_per_ip_;      // 每个IP的最大连接数，0表示不限制
+  std::vector<RateLimit> limits_;      // 各规则的限速参数，下标为规则编号
+  std::vector<MethodRules> rules_;     // 每个方法一棵规则树
+  Shard shards_[RATE_LIMITER_SHARDS];  // 客户端表
+};
+
+#endif
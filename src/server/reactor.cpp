@@ -0,0 +1,228 @@
+#include "reactor.h"
+
+namespace {
+// 每次超时扫描最多关闭的连接数，避免一次扫描长时间占用事件循环
+constexpr size_t MAX_IDLE_CLOSE_BATCH = 4096;
+
+// 连接数超限时直接写回的响应，不经过解析和路由
+constexpr char SERVICE_UNAVAILABLE_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "Content-Length: 19\r\n"
+    "Retry-After: 1\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Service Unavailable";
+
+// 单个IP的连接数超限时直接写回的响应
+constexpr char TOO_MANY_CONNECTIONS_RESPONSE[] =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "Content-Length: 17\r\n"
+    "Retry-After: 1\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Too Many Requests";
+
+// 取得套接字对端的IPv4地址（网络字节序），失败时返回INADDR_ANY
+in_addr_t PeerAddress(int fd) {
+  sockaddr_in addr{};
+  socklen_t len = sizeof(addr);
+  if (getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0 ||
+      addr.sin_family != AF_INET) {
+    return htonl(INADDR_ANY);
+  }
+  return addr.sin_addr.s_addr;
+}
+} // namespace
+
+Reactor::Reactor(int listen_fd, AdmissionControl &admission,
+                 Connection::Options options)
+    : listen_fd_(listen_fd),
+      wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      reserve_fd_(open("/dev/null", O_RDONLY | O_CLOEXEC)), running_(false),
+      loop_time_(std::chrono::steady_clock::now()),
+      logger_(Logger::GetInstance(LOGFILE)), admission_(admission),
+      options_(std::move(options)), next_connection_id_(1) {
+  if (wakeup_fd_ < 0) {
+    throw std::runtime_error("Reactor init failed: " +
+                             std::string(strerror(errno)));
+  }
+}
+
+Reactor::~Reactor() {
+  for (auto &entry : connections_) {
+    ReleaseAdmission(*entry.second);
+  }
+  connections_.clear();
+  if (reserve_fd_ >= 0) {
+    close(reserve_fd_);
+  }
+  close(wakeup_fd_);
+}
+
+void Reactor::Stop() {
+  running_.store(false);
+  Wakeup();
+}
+
+void Reactor::QueueInLoop(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_tasks_.push_back(std::move(task));
+  }
+  Wakeup();
+}
+
+void Reactor::Wakeup() {
+  uint64_t one = 1;
+  ssize_t n = write(wakeup_fd_, &one, sizeof(one));
+  (void)n;
+}
+
+void Reactor::DoPendingTasks() {
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    tasks.swap(pending_tasks_);
+  }
+  for (auto &task : tasks) {
+    task();
+  }
+}
+
+/**
+ * @brief 接入一个新连接
+ *
+ * 连接数达到上限时回复503后立即关闭，不进入事件循环；配置了按IP的限制时取得对端地址，
+ * 该IP的连接数达到上限时回复429后关闭。否则创建Connection并放到空闲链表尾部。
+ *
+ * @param client_fd 已accept的非阻塞套接字
+ * @return 新连接，被拒绝时返回nullptr
+ */
+std::shared_ptr<Connection> Reactor::AddConnection(int client_fd) {
+  if (admission_.max_connections > 0 &&
+      admission_.active_connections.load() >= admission_.max_connections) {
+    RejectConnection(client_fd);
+    return nullptr;
+  }
+  RateLimiter &limiter = admission_.rate_limiter;
+  in_addr_t peer = htonl(INADDR_ANY);
+  if (limiter.HasConnectionLimit() || limiter.HasRules()) {
+    peer = PeerAddress(client_fd);
+    if (!limiter.AcquireConnection(peer)) {
+      RejectConnection(client_fd, true);
+      return nullptr;
+    }
+  }
+  ++admission_.active_connections;
+  std::shared_ptr<Connection> conn = std::make_shared<Connection>(
+      *this, client_fd, next_connection_id_++, options_, peer);
+  conn->idle_pos_ = idle_list_.insert(idle_list_.end(), conn.get());
+  conn->last_active_ = loop_time_;
+  connections_[client_fd] = conn;
+  return conn;
+}
+
+std::shared_ptr<Connection> Reactor::FindConnection(int fd) const {
+  auto it = connections_.find(fd);
+  return it == connections_.end() ? nullptr : it->second;
+}
+
+void Reactor::RejectConnection(int client_fd, bool per_ip) {
+  const char *response = SERVICE_UNAVAILABLE_RESPONSE;
+  size_t size = sizeof(SERVICE_UNAVAILABLE_RESPONSE) - 1;
+  if (per_ip) {
+    ++admission_.rate_limited;
+    response = TOO_MANY_CONNECTIONS_RESPONSE;
+    size = sizeof(TOO_MANY_CONNECTIONS_RESPONSE) - 1;
+  } else {
+    ++admission_.rejected_connections;
+  }
+  // 新连接的发送缓冲区是空的，一次非阻塞send即可写完
+  ssize_t n = send(client_fd, response, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+  (void)n;
+  close(client_fd);
+}
+
+/**
+ * @brief 文件描述符耗尽时的处理
+ *
+ * 不接收待处理连接会导致监听套接字持续就绪、事件循环空转。临时释放预留的fd，
+ * 接收一个连接回复503后立即关闭，让客户端尽快得到失败反馈，再重新占住预留fd。
+ */
+void Reactor::HandleFdExhausted() {
+  logger_.Log(Logger::WARN, "File descriptors exhausted, dropping connection");
+  if (reserve_fd_ < 0) {
+    return;
+  }
+  close(reserve_fd_);
+  int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (client_fd >= 0) {
+    RejectConnection(client_fd);
+  }
+  reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void Reactor::RemoveConnection(Connection &conn) {
+  auto it = connections_.find(conn.Fd());
+  if (it == connections_.end() || it->second.get() != &conn) {
+    return;
+  }
+  OnConnectionRemoved(conn);
+  idle_list_.erase(conn.idle_pos_);
+  ReleaseAdmission(conn);
+  connections_.erase(it);
+}
+
+void Reactor::ReleaseAdmission(const Connection &conn) {
+  --admission_.active_connections;
+  admission_.rate_limiter.ReleaseConnection(conn.PeerAddress());
+}
+
+void Reactor::CloseAllConnections() {
+  while (!connections_.empty()) {
+    std::shared_ptr<Connection> conn = connections_.begin()->second;
+    conn->Close();
+  }
+}
+
+void Reactor::TouchConnection(Connection &conn) {
+  conn.last_active_ = loop_time_;
+  idle_list_.splice(idle_list_.end(), idle_list_, conn.idle_pos_);
+}
+
+/**
+ * @brief 批量关闭空闲超时的连接
+ *
+ * 空闲链表按最近活跃时间有序，从头部开始检查，遇到第一个未超时的连接即可停止，
+ * 代价只与本次超时的连接数有关。正在处理请求的连接没有读写活动但并不空闲，刷新后跳过。
+ *
+ * @param timeout 空闲超时时间
+ */
+void Reactor::CloseIdleConnections(std::chrono::milliseconds timeout) {
+  if (timeout.count() <= 0) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  loop_time_ = now;
+  size_t closed = 0;
+  while (!idle_list_.empty() && closed < MAX_IDLE_CLOSE_BATCH) {
+    Connection *conn = idle_list_.front();
+    if (now - conn->last_active_ < timeout) {
+      break;
+    }
+    if (conn->IsProcessing()) {
+      TouchConnection(*conn);
+      continue;
+    }
+    conn->Close();
+    ++closed;
+  }
+  if (closed > 0) {
+    logger_.Log(Logger::INFO,
+                "Closed " + std::to_string(closed) + " idle connection(s)");
+  }
+}
+
+size_t Reactor::ConnectionCount() const { return connections_.size(); }
@@ -0,0 +1,91 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+#include "common.h"
+#include "connection.h"
+#include "logger.h"
+#include "rate_limiter.h"
+#include <cerrno>
+#include <sys/eventfd.h>
+
+// 多个事件循环共享的连接准入控制状态
+struct AdmissionControl {
+  size_t max_connections = 0;                      // 最大连接数，0表示不限制
+  std::atomic<size_t> active_connections{0};      // 当前连接数
+  std::atomic<uint64_t> rejected_connections{0};  // 因连接数超限被拒绝的连接数
+  std::atomic<uint64_t> rejected_requests{0};     // 因处理队列已满被拒绝的请求数
+  RateLimiter rate_limiter;                        // 按客户端IP的连接数和请求速率限制
+  std::atomic<uint64_t> rate_limited{0};          // 因超过单个IP的连接数或请求速率被拒绝的连接和请求数
+};
+
+// 事件循环(one loop per thread)：负责一个监听套接字以及由它接入的全部连接。
+// 连接表、空闲回收、准入控制和跨线程任务投递与I/O后端无关，由本类实现；
+// 套接字的等待与读写由子类（EpollReactor、UringReactor）实现。
+// 连接的读写只在本循环线程进行，其他线程通过QueueInLoop把操作投递回来。
+class Reactor {
+public:
+  Reactor(int listen_fd, AdmissionControl &admission,
+          Connection::Options options);
+  virtual ~Reactor();
+
+  Reactor(const Reactor &) = delete;
+  Reactor &operator=(const Reactor &) = delete;
+
+  // 运行事件循环，直到Stop()被调用
+  virtual void Loop() = 0;
+  // 停止事件循环（线程安全）
+  void Stop();
+  // 投递任务到事件循环线程执行（线程安全）
+  void QueueInLoop(std::function<void()> task);
+
+  // 连接的输出队列有待发送数据时调用，由I/O后端负责写出并在写完后回调Connection::OnWriteComplete
+  virtual void StartWrite(Connection &conn) = 0;
+  // 连接的输入缓冲区从高水位回落后调用，由I/O后端恢复读取
+  virtual void ResumeRead(Connection &conn) = 0;
+  // 从事件循环中移除连接并关闭套接字，由Connection::Close调用
+  void RemoveConnection(Connection &conn);
+  // 刷新连接的最近活跃时间：把连接移到空闲链表尾部，O(1)且不分配内存
+  void TouchConnection(Connection &conn);
+  // 关闭空闲超过timeout的连接，只能在事件循环线程调用
+  void CloseIdleConnections(std::chrono::milliseconds timeout);
+  // 当前连接数
+  size_t ConnectionCount() const;
+
+protected:
+  // 接入一个已accept的非阻塞套接字；连接数超限时回复503、单个IP的连接数超限时回复429并关闭，返回nullptr
+  std::shared_ptr<Connection> AddConnection(int client_fd);
+  // 查找连接
+  std::shared_ptr<Connection> FindConnection(int fd) const;
+  // I/O后端移除连接：注销事件并关闭套接字
+  virtual void OnConnectionRemoved(Connection &conn) = 0;
+  // 唤醒阻塞在等待I/O事件的循环线程
+  void Wakeup();
+  // 执行其他线程投递的任务
+  void DoPendingTasks();
+  // 关闭本循环的全部连接，子类析构时调用
+  void CloseAllConnections();
+  // 回复503（或单个IP超限时的429）并关闭被拒绝的连接
+  void RejectConnection(int client_fd, bool per_ip = false);
+  // 释放连接占用的准入名额
+  void ReleaseAdmission(const Connection &conn);
+  // 文件描述符耗尽时丢弃一个待接收连接
+  void HandleFdExhausted();
+
+  int listen_fd_;               // 监听套接字（由Server持有）
+  int wakeup_fd_;               // 跨线程唤醒用的eventfd
+  int reserve_fd_;              // 预留的文件描述符，fd耗尽时释放它来接收并关闭一个连接
+  std::atomic<bool> running_;   // 事件循环运行标志
+  std::chrono::steady_clock::time_point loop_time_; // 本轮等待返回的时间，供刷新活跃时间复用
+  Logger &logger_;              // 日志记录器
+
+private:
+  AdmissionControl &admission_; // 连接准入控制（由Server持有）
+  Connection::Options options_;  // 连接的请求处理配置，本循环的所有连接共享
+  uint64_t next_connection_id_; // 下一个连接编号
+  std::unordered_map<int, std::shared_ptr<Connection>> connections_; // 本循环的连接
+  // 按最近活跃时间排序的连接，头部最久未活跃；超时扫描只需从头部检查到第一个未超时的连接
+  std::list<Connection *> idle_list_;
+  std::mutex pending_mutex_;                          // 保护pending_tasks_
+  std::vector<std::function<void()>> pending_tasks_; // 其他线程投递的任务
+};
+
+#endif
@@ -1,13 +1,38 @@
 #include "server.h"
+#include "async_completion.h"
+#include "thread_name.h"
 
 Server::Server(const std::string &ip, int port, UserManager &user_manager,
-               size_t thread_count)
-    : ip_(ip), port_(port),  thread_pool_(thread_count),
+               size_t thread_count, size_t reactor_count,
+               const CpuAffinity &affinity)
+    : ip_(ip), port_(port), reactor_count_(reactor_count),
+      idle_timeout_ms_(DEFAULT_IDLE_TIMEOUT_MS),
+      max_body_size_(DEFAULT_MAX_BODY_SIZE), io_backend_(IoBackend::EPOLL),
+      affinity_(affinity),
+      thread_pool_(thread_count, DEFAULT_POOL_MAX_THREADS,
+                   DEFAULT_POOL_QUEUE_LIMIT, QueueBackend::WORK_STEALING,
+                   "worker", affinity.From(std::max<size_t>(reactor_count, 1))),
       timer_([this](std::function<void()> task) {
-        thread_pool_.EnqueueTask(std::move(task));
+        try {
+          thread_pool_.Post(std::move(task));
+        } catch (const std::runtime_error &) {
+          // 线程池队列已满时在定时器线程直接执行，定时任务都很轻量
+          task();
+        }
       }),router_(user_manager),
       logger_(Logger::GetInstance(LOGFILE)) {
-  InitSocket();
+  // 对端关闭后继续写套接字会触发SIGPIPE，默认处理会终止进程
+  signal(SIGPIPE, SIG_IGN);
+  if (reactor_count_ == 0) {
+    // 单事件循环：主线程accept并监听读事件，请求交给线程池处理
+    listen_fds_.push_back(CreateListenSocket(false));
+  } else {
+    // 多事件循环：每个循环独占一个SO_REUSEPORT监听套接字，由内核在它们之间分配新连接，
+    // 连接的读写与处理都在所属循环线程内完成
+    for (size_t i = 0; i < reactor_count_; ++i) {
+      listen_fds_.push_back(CreateListenSocket(true));
+    }
+  }
   // 添加一个测试定时任务
   // timer_.AddTimer([this]() {
   //   logger_.Log(Logger::DEBUG, "Timer task executed");
@@ -16,87 +41,284 @@ Server::Server(const std::string &ip, int port, UserManager &user_manager,
   //   logger_.Log(Logger::DEBUG, "Timer task completed");
   // }, 5000, true);  // 每5秒执行一次
   logger_.Log(Logger::INFO,
-              "Server init success on" + ip_ + " " + std::to_string(port_));
+              "Server init success on" + ip_ + " " + std::to_string(port_) +
+                  " with " + std::to_string(listen_fds_.size()) + " event loop(s)");
 }
 
-Server::~Server() { close(server_fd_); }
+Server::~Server() {
+  Stop();
+  for (int fd : listen_fds_) {
+    close(fd);
+  }
+}
 
-void Server::InitSocket() {
-  server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+int Server::CreateListenSocket(bool reuse_port) {
+  // 监听套接字设为非阻塞，事件循环可以循环accept4直到EAGAIN
+  int listen_fd =
+      socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    throw std::runtime_error("Failed to create socket: " +
+                             std::string(strerror(errno)));
+  }
   int opt = 1;
-  setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  if (reuse_port) {
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+  }
   sockaddr_in server_addr{};
   server_addr.sin_family = AF_INET;
   server_addr.sin_port = htons(port_);
   inet_pton(AF_INET, ip_.c_str(), &server_addr.sin_addr);
-  bind(server_fd_, reinterpret_cast<sockaddr *>(&server_addr),
-       sizeof(server_addr));
-  listen(server_fd_, SOMAXCONN);
-}
-
-void Server::Start() { EventLoop(); }
-
-void Server::EventLoop() {
-  int epoll_fd = epoll_create1(0);
-  epoll_event event{}, events[MAX_EVENTS];
-  event.events = EPOLLIN;
-  event.data.fd = server_fd_;
-  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd_, &event);
-  while (true) {
-    int epoll_count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
-    for (int i = 0; i < epoll_count; ++i) {
-      if (events[i].data.fd == server_fd_) {
-        int client_fd = accept(server_fd_, nullptr, nullptr);
-        epoll_event client_event{};
-        client_event.events = EPOLLIN | EPOLLET;
-        client_event.data.fd = client_fd;
-        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &client_event);
-      } else {
-        int client_fd = events[i].data.fd;
-        thread_pool_.EnqueueTask(
-            [this, client_fd]() { HandleClient(client_fd); });
+  if (bind(listen_fd, reinterpret_cast<sockaddr *>(&server_addr),
+           sizeof(server_addr)) < 0 ||
+      listen(listen_fd, SOMAXCONN) < 0) {
+    std::string error = strerror(errno);
+    close(listen_fd);
+    throw std::runtime_error("Failed to listen on " + ip_ + ":" +
+                             std::to_string(port_) + ": " + error);
+  }
+  return listen_fd;
+}
+
+/**
+ * @brief 为监听套接字创建指定I/O后端的事件循环
+ *
+ * 未编译io_uring支持或内核不支持所需特性（多次触发的accept/recv、提供缓冲区环）时，
+ * 记录警告并回退到epoll。
+ *
+ * @param listen_fd 监听套接字
+ * @return 事件循环
+ */
+std::unique_ptr<Reactor> Server::CreateReactor(int listen_fd) {
+  Connection::Options options;
+  options.request_callback = [this](const std::shared_ptr<Connection> &conn,
+                                    HttpRequest &request) {
+    HandleRequest(conn, request);
+  };
+  options.body_reader_factory = [this](HttpRequest &head) {
+    return router_.OpenBodyReader(head);
+  };
+  if (admission_.rate_limiter.HasRules()) {
+    options.request_filter = [this](const Connection &conn,
+                                    const HttpRequest &head) {
+      if (admission_.rate_limiter.AllowRequest(conn.PeerAddress(), head)) {
+        return true;
       }
+      ++admission_.rate_limited;
+      return false;
+    };
+  }
+  options.max_body_size = max_body_size_;
+  if (io_backend_ == IoBackend::IO_URING) {
+#ifdef TINY_SERVER_HAS_IO_URING
+    try {
+      return std::unique_ptr<Reactor>(
+          new UringReactor(listen_fd, admission_, options));
+    } catch (const std::runtime_error &e) {
+      logger_.Log(Logger::WARN, std::string("io_uring unavailable (") +
+                                    e.what() + "), falling back to epoll");
     }
+#else
+    logger_.Log(Logger::WARN,
+                "io_uring support not compiled in, falling back to epoll");
+#endif
+    io_backend_ = IoBackend::EPOLL;
   }
+  return std::unique_ptr<Reactor>(
+      new EpollReactor(listen_fd, admission_, options));
 }
 
-void Server::HandleClient(int fd) {
-  char buffer[BUFFER_SIZE] = {0};
-  ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
-  if (bytes_read <= 0) {
-    logger_.Log(Logger::ERROR,"Failed to read from client");
-    close(fd);
+/**
+ * @brief 启动服务器
+ *
+ * 单事件循环模式下直接在调用线程运行事件循环；多事件循环模式下为每个循环启动一个线程，
+ * 调用线程阻塞等待全部循环退出。启用CPU绑定时，运行事件循环的线程按序号绑定到对应的CPU。
+ */
+void Server::Start() {
+  for (int listen_fd : listen_fds_) {
+    reactors_.push_back(CreateReactor(listen_fd));
+  }
+  StartIdleReaper();
+  StartRateLimitSweeper();
+  if (reactor_count_ == 0) {
+    affinity_.PinCurrentThread(0);
+    reactors_[0]->Loop();
     return;
   }
- // 输出请求内容
-  logger_.Log(Logger::DEBUG, "Request: " + std::string(buffer));
-  HttpRequest request;
-  if (!request.Parse(buffer)) {
-    close(fd);
+  for (size_t i = 0; i < reactors_.size(); ++i) {
+    Reactor *loop = reactors_[i].get();
+    reactor_threads_.emplace_back([this, loop, i]() {
+      SetCurrentThreadName("reactor-" + std::to_string(i));
+      affinity_.PinCurrentThread(i);
+      loop->Loop();
+    });
+  }
+  for (std::thread &thread : reactor_threads_) {
+    thread.join();
+  }
+  reactor_threads_.clear();
+}
+
+void Server::SetIoBackend(IoBackend backend) { io_backend_ = backend; }
+
+void Server::Stop() {
+  for (auto &reactor : reactors_) {
+    reactor->Stop();
+  }
+}
+
+/**
+ * @brief 处理连接上解析出的完整请求
+ *
+ * 多事件循环模式下直接在循环线程内处理并回写响应，响应从连接的内存池分配；单事件循环模式下把路由处理交给线程池，
+ * 处理完成后通过QueueInLoop回到连接所属的事件循环发送响应，套接字读写始终只在循环线程进行。
+ * 连接的内存池不是线程安全的，交给线程池的请求先拷贝一份到普通堆内存，响应也在普通堆内存中构造。
+ */
+void Server::HandleRequest(const std::shared_ptr<Connection> &conn,
+                           HttpRequest &request) {
+  if (const Router::AsyncRouterHandler *handler =
+          router_.FindAsyncHandler(request)) {
+    HandleAsyncRequest(conn, request, *handler);
+    return;
+  }
+  if (reactor_count_ > 0) {
+    HttpResponse response(&conn->Arena());
+    ProcessRequest(request, response);
+    conn->SendResponse(response);
     return;
   }
-// 添加请求信息日志
-  logger_.Log(Logger::DEBUG, "Method: " + request.GetMethod());
-  logger_.Log(Logger::DEBUG, "Path: " + request.GetPath());
-  logger_.Log(Logger::DEBUG, "Version: " + request.GetVersion());
+  std::shared_ptr<HttpRequest> shared_request =
+      std::make_shared<HttpRequest>(request);
+  try {
+    thread_pool_.Post([this, conn, shared_request]() {
+      std::shared_ptr<HttpResponse> response = std::make_shared<HttpResponse>();
+      ProcessRequest(*shared_request, *response);
+      conn->GetLoop().QueueInLoop(
+          [conn, response]() { conn->SendResponse(*response); });
+    });
+  } catch (const std::runtime_error &) {
+    // 线程池队列已满：在事件循环内直接回复503，不让异常终止事件循环
+    RejectRequest(conn);
+  }
+}
 
+/**
+ * @brief 调用异步处理函数
+ *
+ * 处理函数在事件循环线程中直接调用，不经过线程池，它把耗时操作交给其他线程后立即返回，
+ * 事件循环继续处理其他连接。完成回调的语义见AsyncCompletion。
+ * 处理函数抛出异常时完成回调随之销毁，回复500，这里只记录日志。
+ *
+ * @param conn 连接
+ * @param request 请求，路由参数已经记录
+ * @param handler 异步处理函数
+ */
+void Server::HandleAsyncRequest(const std::shared_ptr<Connection> &conn,
+                                HttpRequest &request,
+                                const Router::AsyncRouterHandler &handler) {
+  if (logger_.IsEnabled(Logger::DEBUG)) {
+    logger_.Log(Logger::DEBUG, "Async request: " +
+                                   std::string(request.GetMethod()) + " " +
+                                   std::string(request.GetPath()));
+  }
+  try {
+    AsyncCompletion::Start(conn, request, handler);
+  } catch (const std::exception &e) {
+    logger_.Log(Logger::ERROR, "Async handler failed: " + std::string(e.what()));
+  }
+}
+
+void Server::RejectRequest(const std::shared_ptr<Connection> &conn) {
+  ++admission_.rejected_requests;
+  HttpResponse response(&conn->Arena());
+  response.SetStatusCode(503);
+  response.SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
+  response.SetHeader(HEADER_RETRY_AFTER, "1");
+  response.SetBody("Service Unavailable");
+  conn->SendResponse(response);
+}
 
+void Server::ProcessRequest(HttpRequest &request, HttpResponse &response) {
+  // 添加请求信息日志，未开启DEBUG级别时不拼接日志内容
+  if (logger_.IsEnabled(Logger::DEBUG)) {
+    logger_.Log(Logger::DEBUG, "Request: " + std::string(request.GetMethod()) +
+                                   " " + std::string(request.GetPath()) + " " +
+                                   std::string(request.GetVersion()));
+  }
 
-//输出请求路径
-logger_.Log(Logger::DEBUG, "Request path: " + request.GetPath());
-  HttpResponse response;
   if (!router_.HandleRequest(request, response)) {
-    response.SetStatusCode("404 Not Found");
-    response.SetHeader("Content-Type", "text/plain; charset=utf-8");
+    response.SetStatusCode(404);
+    response.SetHeader(HEADER_CONTENT_TYPE, "text/plain; charset=utf-8");
     response.SetBody("Path Not Found");
   }
+}
+
+Router &Server::GetRouter() { return router_; }
+
+void Server::SetIdleTimeout(size_t timeout_ms) { idle_timeout_ms_ = timeout_ms; }
+
+void Server::SetMaxBodySize(size_t max_body_size) {
+  max_body_size_ = max_body_size;
+}
+
+void Server::SetMaxConnections(size_t max_connections) {
+  admission_.max_connections = max_connections;
+}
+
+uint64_t Server::GetRejectedConnections() const {
+  return admission_.rejected_connections.load();
+}
 
-  std::string response_str = response.BuildHttpResponse();
-  logger_.Log(Logger::DEBUG, "Response: " + response_str);
-  ssize_t bytes_sent = send(fd, response_str.c_str(), response_str.size(), 0);
-  if (bytes_sent <= 0) {
-    logger_.Log(Logger::ERROR, "Failed to send response");
+uint64_t Server::GetRejectedRequests() const {
+  return admission_.rejected_requests.load();
+}
+
+void Server::SetMaxConnectionsPerIp(size_t max_connections) {
+  admission_.rate_limiter.SetMaxConnectionsPerIp(max_connections);
+}
+
+void Server::SetRateLimit(const std::string &path, const std::string &method,
+                          double rate, double burst) {
+  admission_.rate_limiter.AddRule(method, path, RateLimit{rate, burst});
+  logger_.Log(Logger::INFO, "Rate limit: " + method + " " + path + " " +
+                                std::to_string(rate) + "/s, burst " +
+                                std::to_string(burst));
+}
+
+uint64_t Server::GetRateLimited() const {
+  return admission_.rate_limited.load();
+}
+
+/**
+ * @brief 启动空闲连接回收
+ *
+ * 只注册一个周期性定时任务，而不是为每个连接创建定时器：各事件循环自己维护按活跃时间排序的
+ * 空闲链表，定时任务把扫描投递回每个循环线程执行，超时连接在一次扫描中批量关闭。
+ */
+void Server::StartIdleReaper() {
+  if (idle_timeout_ms_ == 0) {
+    return;
   }
+  std::chrono::milliseconds timeout(idle_timeout_ms_);
+  size_t interval = std::min<size_t>(idle_timeout_ms_, 1000);
+  timer_.AddTimer(
+      [this, timeout]() {
+        for (auto &reactor : reactors_) {
+          Reactor *loop = reactor.get();
+          loop->QueueInLoop(
+              [loop, timeout]() { loop->CloseIdleConnections(timeout); });
+        }
+      },
+      interval, true);
+  logger_.Log(Logger::INFO, "Idle connection timeout: " +
+                                std::to_string(idle_timeout_ms_) + "ms");
 }
 
-Router &Server::GetRouter() { return router_; }
+void Server::StartRateLimitSweeper() {
+  RateLimiter &limiter = admission_.rate_limiter;
+  if (!limiter.HasConnectionLimit() && !limiter.HasRules()) {
+    return;
+  }
+  timer_.AddTimer([&limiter]() { limiter.Sweep(); }, RATE_LIMIT_SWEEP_MS,
+                  true);
+}
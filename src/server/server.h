@@ -5,26 +5,79 @@
 #include "timer.h"
 #include "router.h"
 #include "user_manager.h"
+#include "epoll_reactor.h"
+#include "uring_reactor.h"
+
+constexpr size_t DEFAULT_IDLE_TIMEOUT_MS = 60000; // 默认连接空闲超时时间
+constexpr size_t RATE_LIMIT_SWEEP_MS = 10000;     // 清理限速表中空闲客户端的间隔
+
+// 事件循环的I/O后端
+enum class IoBackend {
+    EPOLL,   // epoll边缘触发 + 非阻塞读写
+    IO_URING // io_uring多次触发accept/recv + 提供缓冲区环，不可用时回退到EPOLL
+};
 
 class Server{
     public:
-    Server(const std::string &ip,int port,UserManager& user_manager,size_t thread_count=4);
+    // reactor_count为0时使用单事件循环+线程池模式；
+    // 大于0时启动reactor_count个事件循环线程，每个循环拥有独立的SO_REUSEPORT监听套接字。
+    // affinity启用时第i个事件循环线程绑定到序列中第i个CPU（单事件循环模式下绑定调用Start()的线程），
+    // 线程池的工作线程从事件循环之后的CPU开始绑定
+    Server(const std::string &ip,int port,UserManager& user_manager,size_t thread_count=4,
+           size_t reactor_count=0,const CpuAffinity &affinity=CpuAffinity());
     ~Server();
     void Start();
+    void Stop();
     Router& GetRouter();
+    // 设置连接空闲超时时间（毫秒），0表示不关闭空闲连接；需在Start()之前调用
+    void SetIdleTimeout(size_t timeout_ms);
+    // 设置最大并发连接数，0表示不限制；需在Start()之前调用
+    void SetMaxConnections(size_t max_connections);
+    // 设置单个客户端IP的最大并发连接数，超过时回复429并关闭，0表示不限制；需在Start()之前调用
+    void SetMaxConnectionsPerIp(size_t max_connections);
+    // 按客户端IP限制匹配path和method的请求速率（令牌桶：平均每秒rate个，允许burst个突发），超过时回复429，
+    // 不调用处理函数。path的写法与路由相同，例如"/login"、"/api/*rest"；需在Start()之前调用
+    void SetRateLimit(const std::string &path, const std::string &method,
+                      double rate, double burst);
+    // 设置缓存请求体的最大长度，超过时回复413；流式接收请求体的路由不受限制。需在Start()之前调用
+    void SetMaxBodySize(size_t max_body_size);
+    // 选择事件循环的I/O后端，默认EPOLL；需在Start()之前调用
+    void SetIoBackend(IoBackend backend);
+    // 因连接数超限被拒绝的连接数
+    uint64_t GetRejectedConnections() const;
+    // 因线程池队列已满被拒绝的请求数
+    uint64_t GetRejectedRequests() const;
+    // 因超过单个IP的连接数或请求速率被拒绝（回复429）的连接和请求数
+    uint64_t GetRateLimited() const;
 
     private:
-        void InitSocket();
-        void EventLoop();
-        void HandleClient(int fd);
+        int CreateListenSocket(bool reuse_port);
+        std::unique_ptr<Reactor> CreateReactor(int listen_fd); // 按选定的I/O后端创建事件循环
+        // 处理一个完整请求：单事件循环模式下转交线程池，多事件循环模式下在循环线程内处理
+        void HandleRequest(const std::shared_ptr<Connection> &conn, HttpRequest &request);
+        void ProcessRequest(HttpRequest &request, HttpResponse &response);
+        // 调用异步处理函数，响应就绪后回到连接所属的事件循环发送
+        void HandleAsyncRequest(const std::shared_ptr<Connection> &conn, HttpRequest &request,
+                                const Router::AsyncRouterHandler &handler);
+        void StartIdleReaper(); // 通过定时器周期性地让每个事件循环关闭空闲连接
+        void StartRateLimitSweeper(); // 通过定时器周期性地清理限速表中的空闲客户端
+        void RejectRequest(const std::shared_ptr<Connection> &conn); // 回复503
 
-        int server_fd_;
         std::string ip_;
         int port_;
+        size_t reactor_count_;                              // 事件循环线程数
+        size_t idle_timeout_ms_;                            // 连接空闲超时时间（毫秒）
+        size_t max_body_size_;                              // 缓存请求体的最大长度
+        IoBackend io_backend_;                              // 事件循环的I/O后端
+        CpuAffinity affinity_;                              // 事件循环线程的CPU绑定
+        AdmissionControl admission_;                        // 连接准入控制，所有事件循环共享
+        std::vector<int> listen_fds_;                       // 监听套接字，每个事件循环一个
+        std::vector<std::unique_ptr<Reactor>> reactors_;    // 事件循环
+        std::vector<std::thread> reactor_threads_;          // 事件循环线程
         ThreadPool thread_pool_;
         Timer timer_;
         Router router_;
         Logger& logger_;
 };
 
-#endif 
\ No newline at end of file
+#endif 
@@ -0,0 +1,542 @@
+#include "uring_reactor.h"
+
+#ifdef TINY_SERVER_HAS_IO_URING
+#include <poll.h>
+#include <sys/mman.h>
+
+namespace {
+constexpr unsigned RING_ENTRIES = 4096;          // 提交队列大小
+constexpr unsigned RECV_BUFFER_COUNT = 1024;     // 接收缓冲区个数（2的幂）
+constexpr unsigned RECV_BUFFER_SIZE = 4096;      // 每个接收缓冲区的大小
+constexpr unsigned short RECV_BUFFER_GROUP = 0;  // 缓冲区组编号
+constexpr uint64_t OP_SHIFT = 56;
+constexpr uint64_t ID_MASK = (1ULL << OP_SHIFT) - 1;
+} // namespace
+
+UringReactor::UringReactor(int listen_fd, AdmissionControl &admission,
+                           Connection::Options options)
+    : Reactor(listen_fd, admission, std::move(options)),
+      ring_(RING_ENTRIES), buf_ring_(nullptr),
+      buf_ring_size_(RECV_BUFFER_COUNT * sizeof(io_uring_buf)),
+      buf_base_(nullptr), buf_tail_(0), wakeup_value_(0),
+      accept_armed_(false), wakeup_armed_(false) {
+  void *ring_mem = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring_mem == MAP_FAILED) {
+    throw std::runtime_error("Failed to allocate io_uring buffer ring");
+  }
+  buf_ring_ = static_cast<io_uring_buf_ring *>(ring_mem);
+  buf_base_ = new char[static_cast<size_t>(RECV_BUFFER_COUNT) *
+                       RECV_BUFFER_SIZE];
+  int ret =
+      ring_.RegisterBufferRing(buf_ring_, RECV_BUFFER_COUNT, RECV_BUFFER_GROUP);
+  if (ret < 0) {
+    munmap(buf_ring_, buf_ring_size_);
+    delete[] buf_base_;
+    throw std::runtime_error("io_uring buffer ring registration failed: " +
+                             std::string(strerror(-ret)));
+  }
+  for (unsigned i = 0; i < RECV_BUFFER_COUNT; ++i) {
+    RecycleBuffer(static_cast<unsigned short>(i));
+  }
+}
+
+/**
+ * @brief 关闭全部连接并释放缓冲区
+ *
+ * 内核可能仍在访问在途请求引用的接收缓冲区、缓冲区环、iovec和eventfd读取目标，
+ * 先取消全部请求并等到它们完成、关闭io_uring实例，再释放这些内存。
+ */
+UringReactor::~UringReactor() {
+  running_.store(false);
+  CloseAllConnections();
+  DrainRing();
+  ring_.Release();
+  states_.clear();
+  munmap(buf_ring_, buf_ring_size_);
+  delete[] buf_base_;
+}
+
+uint64_t UringReactor::Encode(Op op, uint64_t id) {
+  return (static_cast<uint64_t>(op) << OP_SHIFT) | (id & ID_MASK);
+}
+
+io_uring_sqe *UringReactor::NextSqe() {
+  io_uring_sqe *sqe = ring_.GetSqe();
+  if (!sqe) {
+    logger_.Log(Logger::ERROR, "io_uring submission queue is full");
+  }
+  return sqe;
+}
+
+/**
+ * @brief 运行事件循环
+ *
+ * 每轮先用一次io_uring_enter提交上一轮产生的全部请求并等待完成事件，再依次处理完成事件，
+ * 最后执行其他线程投递的任务（它们产生的发送请求在下一轮一并提交）。
+ */
+void UringReactor::Loop() {
+  running_.store(true);
+  ArmAccept();
+  ArmWakeup();
+  while (running_.load()) {
+    int ret = ring_.SubmitAndWait(1);
+    if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+      logger_.Log(Logger::ERROR,
+                  "io_uring_enter failed: " + std::string(strerror(-ret)));
+      break;
+    }
+    loop_time_ = std::chrono::steady_clock::now();
+    ring_.ForEachCqe([this](const io_uring_cqe &cqe) { HandleCqe(cqe); });
+    DoPendingTasks();
+  }
+}
+
+void UringReactor::ArmAccept() {
+  io_uring_sqe *sqe = NextSqe();
+  if (!sqe) {
+    return;
+  }
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = listen_fd_;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = Encode(OP_ACCEPT, 0);
+  accept_armed_ = true;
+}
+
+void UringReactor::ArmWakeup() {
+  io_uring_sqe *sqe = NextSqe();
+  if (!sqe) {
+    return;
+  }
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = wakeup_fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&wakeup_value_);
+  sqe->len = sizeof(wakeup_value_);
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->user_data = Encode(OP_WAKEUP, 0);
+  wakeup_armed_ = true;
+}
+
+void UringReactor::ArmRecv(UringConnection &state) {
+  io_uring_sqe *sqe = NextSqe();
+  if (!sqe) {
+    state.conn_->Close();
+    return;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = state.conn_->Fd();
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = RECV_BUFFER_GROUP;
+  sqe->user_data = Encode(OP_RECV, state.conn_->Id());
+  state.recv_armed_ = true;
+}
+
+void UringReactor::CancelRecv(UringConnection &state) {
+  if (!state.recv_armed_ || state.recv_canceled_) {
+    return;
+  }
+  CancelOp(OP_RECV, state.conn_->Id());
+  state.recv_canceled_ = true;
+}
+
+void UringReactor::CancelOp(Op op, uint64_t id) {
+  io_uring_sqe *sqe = NextSqe();
+  if (!sqe) {
+    return;
+  }
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = Encode(op, id);
+  sqe->user_data = Encode(OP_CANCEL, id);
+}
+
+void UringReactor::ArmPollOut(UringConnection &state) {
+  io_uring_sqe *sqe = NextSqe();
+  if (!sqe) {
+    state.conn_->Close();
+    return;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = state.conn_->Fd();
+  sqe->poll32_events = POLLOUT;
+  sqe->user_data = Encode(OP_POLL_OUT, state.conn_->Id());
+  state.poll_armed_ = true;
+}
+
+void UringReactor::HandleCqe(const io_uring_cqe &cqe) {
+  Op op = static_cast<Op>(cqe.user_data >> OP_SHIFT);
+  uint64_t id = cqe.user_data & ID_MASK;
+  switch (op) {
+  case OP_ACCEPT:
+    HandleAccept(cqe);
+    return;
+  case OP_WAKEUP:
+    wakeup_armed_ = false;
+    if (running_.load()) {
+      ArmWakeup();
+    }
+    return;
+  case OP_CANCEL:
+    return;
+  default:
+    break;
+  }
+  auto it = states_.find(id);
+  if (it == states_.end()) {
+    if (op == OP_RECV && (cqe.flags & IORING_CQE_F_BUFFER)) {
+      RecycleBuffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+    return;
+  }
+  UringConnection &state = *it->second;
+  switch (op) {
+  case OP_RECV:
+    HandleRecv(state, cqe);
+    break;
+  case OP_SEND:
+    HandleSend(state, cqe);
+    break;
+  case OP_CLOSE:
+    HandleClose(state, cqe);
+    break;
+  case OP_POLL_OUT:
+    HandlePollOut(state, cqe);
+    break;
+  default:
+    break;
+  }
+  MaybeRelease(id);
+}
+
+void UringReactor::HandleAccept(const io_uring_cqe &cqe) {
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    accept_armed_ = false;
+    if (running_.load()) {
+      ArmAccept();
+    }
+  }
+  if (!running_.load()) {
+    // 循环已停止（析构时等待在途请求期间）：不再接入新连接
+    if (cqe.res >= 0) {
+      close(cqe.res);
+    }
+    return;
+  }
+  if (cqe.res < 0) {
+    if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+      HandleFdExhausted();
+    } else if (cqe.res != -ECANCELED) {
+      logger_.Log(Logger::ERROR,
+                  "accept failed: " + std::string(strerror(-cqe.res)));
+    }
+    return;
+  }
+  // 链接的close已经释放了fd但完成事件尚未处理时，新连接可能复用同一个fd，先移除旧连接
+  std::shared_ptr<Connection> stale = FindConnection(cqe.res);
+  if (stale) {
+    stale->Close();
+  }
+  std::shared_ptr<Connection> conn = AddConnection(cqe.res);
+  if (!conn) {
+    return;
+  }
+  std::unique_ptr<UringConnection> state(new UringConnection());
+  state->conn_ = conn;
+  UringConnection &ref = *state;
+  states_[conn->Id()] = std::move(state);
+  ArmRecv(ref);
+}
+
+/**
+ * @brief 处理recv完成事件
+ *
+ * 数据位于内核选出的提供缓冲区中，拷贝进连接的输入缓冲区后立即归还。多次触发的recv在缓冲区
+ * 耗尽或出错时会停止，此时如果连接仍然有效且不是被主动取消的就重新挂上。
+ * 输入缓冲区达到MAX_INPUT_BUFFER时取消recv，由ResumeRead在数据被消费后重新挂上。
+ */
+void UringReactor::HandleRecv(UringConnection &state,
+                              const io_uring_cqe &cqe) {
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    state.recv_armed_ = false;
+  }
+  Connection &conn = *state.conn_;
+  if (cqe.res > 0) {
+    unsigned short buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    if (!state.removed_) {
+      conn.Input().Append(buf_base_ + static_cast<size_t>(buffer_id) *
+                                          RECV_BUFFER_SIZE,
+                          static_cast<size_t>(cqe.res));
+    }
+    RecycleBuffer(buffer_id);
+    if (!state.removed_) {
+      conn.OnInputReceived(false);
+    }
+    if (!state.removed_ && state.recv_armed_ && !state.recv_paused_ &&
+        conn.Input().ReadableBytes() >= MAX_INPUT_BUFFER) {
+      // 多次触发的recv无法把数据留在内核中，取消它；取消生效前已完成的数据仍会追加进来
+      CancelOp(OP_RECV, conn.Id());
+      state.recv_paused_ = true;
+    }
+  } else if (cqe.res == 0) {
+    if (!state.removed_) {
+      conn.OnInputReceived(true);
+    }
+    return;
+  } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+    if (!state.removed_) {
+      logger_.Log(Logger::ERROR, "Failed to read from client: " +
+                                     std::string(strerror(-cqe.res)));
+      conn.Close();
+    }
+    return;
+  }
+  // 已主动取消的recv不能重新挂上：链接的close释放fd后，同一fd可能已分配给新连接
+  if (!state.recv_armed_ && !state.removed_ && !state.recv_canceled_ &&
+      !state.recv_paused_) {
+    ArmRecv(state);
+  }
+}
+
+/**
+ * @brief 发送连接输出队列中的数据
+ *
+ * 每个连接同一时刻最多一个在途的sendmsg。如果本次发送覆盖了全部待发送数据且响应后要关闭连接，
+ * 就以MSG_WAITALL发送并把close链接在其后，发送成功后由内核直接关闭套接字；发送失败时链接的
+ * close会被取消，由完成事件处理兜底关闭。
+ */
+void UringReactor::StartWrite(Connection &conn) {
+  auto it = states_.find(conn.Id());
+  if (it == states_.end()) {
+    return;
+  }
+  UringConnection &state = *it->second;
+  if (state.send_in_flight_ || state.poll_armed_ || state.removed_) {
+    return;
+  }
+  if (!SendFileChunks(state)) {
+    return;
+  }
+  size_t count = conn.Output().FillIovec(state.iov_, MAX_SEND_IOVEC);
+  if (count == 0) {
+    conn.OnWriteComplete();
+    return;
+  }
+  size_t bytes = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bytes += state.iov_[i].iov_len;
+  }
+  bool link_close =
+      conn.CloseAfterWrite() && bytes == conn.Output().PendingBytes();
+  if (link_close) {
+    CancelRecv(state);
+  }
+  io_uring_sqe *sqe = NextSqe();
+  if (!sqe) {
+    conn.Close();
+    return;
+  }
+  state.msg_ = msghdr{};
+  state.msg_.msg_iov = state.iov_;
+  state.msg_.msg_iovlen = count;
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = conn.Fd();
+  sqe->addr = reinterpret_cast<uint64_t>(&state.msg_);
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL | (link_close ? MSG_WAITALL : 0);
+  sqe->user_data = Encode(OP_SEND, conn.Id());
+  state.send_in_flight_ = true;
+  if (link_close) {
+    io_uring_sqe *close_sqe = NextSqe();
+    if (close_sqe) {
+      sqe->flags |= IOSQE_IO_LINK;
+      close_sqe->opcode = IORING_OP_CLOSE;
+      close_sqe->fd = conn.Fd();
+      close_sqe->user_data = Encode(OP_CLOSE, conn.Id());
+      state.close_linked_ = true;
+    }
+  }
+}
+
+/**
+ * @brief 发送队首的文件数据段
+ *
+ * io_uring没有直接从文件发往套接字的操作（splice需要中间管道），文件数据段在循环线程内
+ * 用非阻塞sendfile发送，同样不经过用户态缓冲区；套接字发送缓冲区已满时挂一个POLLOUT等待。
+ *
+ * @return 队首已没有文件数据段时返回true；需要等待可写或连接已关闭时返回false
+ */
+bool UringReactor::SendFileChunks(UringConnection &state) {
+  Connection &conn = *state.conn_;
+  while (conn.Output().FrontIsFile()) {
+    ssize_t n = conn.Output().SendFile(conn.Fd());
+    if (n > 0) {
+      TouchConnection(conn);
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      ArmPollOut(state);
+      return false;
+    } else {
+      logger_.Log(Logger::ERROR,
+                  "Failed to send file: " + std::string(strerror(errno)));
+      conn.Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void UringReactor::HandlePollOut(UringConnection &state,
+                                 const io_uring_cqe &cqe) {
+  state.poll_armed_ = false;
+  if (state.removed_) {
+    return;
+  }
+  if (cqe.res < 0) {
+    state.conn_->Close();
+    return;
+  }
+  StartWrite(*state.conn_);
+}
+
+void UringReactor::HandleSend(UringConnection &state,
+                              const io_uring_cqe &cqe) {
+  state.send_in_flight_ = false;
+  Connection &conn = *state.conn_;
+  if (cqe.res < 0) {
+    if (!state.removed_ && !state.close_linked_) {
+      logger_.Log(Logger::ERROR, "Failed to send response: " +
+                                     std::string(strerror(-cqe.res)));
+      conn.Close();
+    }
+    return;
+  }
+  conn.Output().Advance(static_cast<size_t>(cqe.res));
+  if (state.removed_ || state.close_linked_) {
+    // 链接的close完成后再关闭连接
+    return;
+  }
+  TouchConnection(conn);
+  if (conn.Output().Empty()) {
+    conn.OnWriteComplete();
+  } else {
+    StartWrite(conn);
+  }
+}
+
+void UringReactor::HandleClose(UringConnection &state,
+                               const io_uring_cqe &cqe) {
+  state.close_linked_ = false;
+  if (cqe.res == 0) {
+    state.fd_closed_ = true;
+  }
+  if (!state.removed_) {
+    state.conn_->Close();
+  } else if (!state.fd_closed_) {
+    close(state.conn_->Fd());
+    state.fd_closed_ = true;
+  }
+}
+
+/**
+ * @brief 输入缓冲区回落到高水位以下后恢复recv
+ *
+ * 暂停时提交的取消可能尚未生效，此时recv仍在途，它结束后由HandleRecv重新挂上。
+ */
+void UringReactor::ResumeRead(Connection &conn) {
+  auto it = states_.find(conn.Id());
+  if (it == states_.end()) {
+    return;
+  }
+  UringConnection &state = *it->second;
+  if (!state.recv_paused_ || state.removed_) {
+    return;
+  }
+  state.recv_paused_ = false;
+  if (!state.recv_armed_) {
+    ArmRecv(state);
+  }
+}
+
+/**
+ * @brief 连接从事件循环移除
+ *
+ * 套接字上仍可能挂着多次触发的recv，关闭fd并不会结束它，需要显式取消。
+ * 如果已有链接的close在途，由它关闭套接字，避免重复close误关复用了同一fd的新连接。
+ */
+void UringReactor::OnConnectionRemoved(Connection &conn) {
+  auto it = states_.find(conn.Id());
+  if (it == states_.end()) {
+    close(conn.Fd());
+    return;
+  }
+  UringConnection &state = *it->second;
+  state.removed_ = true;
+  CancelRecv(state);
+  if (state.poll_armed_) {
+    CancelOp(OP_POLL_OUT, conn.Id());
+  }
+  if (!state.close_linked_ && !state.fd_closed_) {
+    close(conn.Fd());
+    state.fd_closed_ = true;
+  }
+  if (!state.recv_armed_ && !state.send_in_flight_ && !state.poll_armed_ &&
+      !state.close_linked_) {
+    // 没有在途请求，延迟到当前调用栈结束后释放，调用方可能仍在使用state
+    uint64_t id = conn.Id();
+    QueueInLoop([this, id]() { MaybeRelease(id); });
+  }
+}
+
+void UringReactor::RecycleBuffer(unsigned short buffer_id) {
+  // 内核头文件用__DECLARE_FLEX_ARRAY声明bufs，在C++中其偏移量不为0，直接按数组下标定位
+  io_uring_buf *buf = reinterpret_cast<io_uring_buf *>(buf_ring_) +
+                      (buf_tail_ & (RECV_BUFFER_COUNT - 1));
+  buf->addr = reinterpret_cast<uint64_t>(
+      buf_base_ + static_cast<size_t>(buffer_id) * RECV_BUFFER_SIZE);
+  buf->len = RECV_BUFFER_SIZE;
+  buf->bid = buffer_id;
+  ++buf_tail_;
+  __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+}
+
+void UringReactor::MaybeRelease(uint64_t id) {
+  auto it = states_.find(id);
+  if (it == states_.end()) {
+    return;
+  }
+  UringConnection &state = *it->second;
+  if (state.removed_ && !state.recv_armed_ && !state.send_in_flight_ &&
+      !state.poll_armed_ && !state.close_linked_) {
+    states_.erase(it);
+  }
+}
+
+/**
+ * @brief 取消全部在途请求并等待它们完成
+ *
+ * 连接已全部关闭，它们的recv和poll取消已经提交；再提交一个匹配任意请求的取消，覆盖accept、
+ * eventfd读取和在途的发送。随后处理完成事件直到没有在途请求，已移除连接的状态在此过程中释放。
+ */
+void UringReactor::DrainRing() {
+  io_uring_sqe *sqe = NextSqe();
+  if (sqe) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data = Encode(OP_CANCEL, 0);
+  }
+  while (accept_armed_ || wakeup_armed_ || !states_.empty()) {
+    int ret = ring_.SubmitAndWait(1);
+    if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+      logger_.Log(Logger::ERROR,
+                  "io_uring_enter failed: " + std::string(strerror(-ret)));
+      return;
+    }
+    ring_.ForEachCqe([this](const io_uring_cqe &cqe) { HandleCqe(cqe); });
+    DoPendingTasks();
+  }
+}
+
+#endif // TINY_SERVER_HAS_IO_URING
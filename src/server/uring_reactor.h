@@ -0,0 +1,91 @@
+#ifndef URING_REACTOR_H
+#define URING_REACTOR_H
+#include "reactor.h"
+
+#ifdef TINY_SERVER_HAS_IO_URING
+#include "io_uring.h"
+
+// 基于io_uring的I/O后端：
+// - 监听套接字上挂一个多次触发(multishot)的accept，新连接不需要额外的系统调用；
+// - 每个连接挂一个多次触发的recv，数据写入内核从提供缓冲区环中选出的缓冲区，用完立即归还；
+// - 响应用sendmsg聚合写出，需要关闭连接时把close链接在最后一次发送之后；
+// - 文件响应体在循环线程内用非阻塞sendfile发送，套接字不可写时挂一个poll等待；
+// - 每轮循环的所有提交和等待合并为一次io_uring_enter。
+class UringReactor : public Reactor {
+public:
+  // 内核不支持所需特性时抛出std::runtime_error
+  UringReactor(int listen_fd, AdmissionControl &admission,
+               Connection::Options options);
+  ~UringReactor() override;
+
+  void Loop() override;
+  void StartWrite(Connection &conn) override;
+  void ResumeRead(Connection &conn) override;
+
+protected:
+  void OnConnectionRemoved(Connection &conn) override;
+
+private:
+  static constexpr size_t MAX_SEND_IOVEC = 64; // 每次sendmsg最多聚合的数据段数
+
+  // 完成事件对应的操作类型，编码在user_data的高8位
+  enum Op : uint64_t {
+    OP_ACCEPT = 1,
+    OP_WAKEUP,
+    OP_RECV,
+    OP_SEND,
+    OP_CLOSE,
+    OP_CANCEL,
+    OP_POLL_OUT
+  };
+
+  // 连接在io_uring上的状态。在途请求完成前一直持有连接引用，保证内核访问的输出缓冲区、
+  // iovec和msghdr有效；以连接编号为键，不受fd复用影响。
+  struct UringConnection {
+    std::shared_ptr<Connection> conn_;
+    bool recv_armed_ = false;     // 多次触发的recv是否仍在途
+    bool recv_canceled_ = false;  // 是否已提交取消recv
+    bool recv_paused_ = false;    // 输入缓冲区达到高水位，暂停recv直到数据被消费
+    bool send_in_flight_ = false; // 是否有在途的sendmsg
+    bool poll_armed_ = false;     // 是否在等待套接字可写（发送文件数据段时）
+    bool close_linked_ = false;   // 是否有链接在发送之后的close
+    bool removed_ = false;        // 连接已从事件循环移除
+    bool fd_closed_ = false;      // 套接字已关闭
+    iovec iov_[MAX_SEND_IOVEC];
+    msghdr msg_;
+  };
+
+  static uint64_t Encode(Op op, uint64_t id);
+  io_uring_sqe *NextSqe(); // 获取提交项，队列满且无法提交时记录错误返回nullptr
+
+  void ArmAccept();
+  void ArmWakeup();
+  void ArmRecv(UringConnection &state);
+  void CancelRecv(UringConnection &state);
+  void ArmPollOut(UringConnection &state);
+  void CancelOp(Op op, uint64_t id); // 取消连接上的一个在途请求
+  bool SendFileChunks(UringConnection &state); // 同步发送队首的文件数据段，返回false表示需等待或已关闭
+
+  void HandleCqe(const io_uring_cqe &cqe);
+  void HandleAccept(const io_uring_cqe &cqe);
+  void HandleRecv(UringConnection &state, const io_uring_cqe &cqe);
+  void HandleSend(UringConnection &state, const io_uring_cqe &cqe);
+  void HandleClose(UringConnection &state, const io_uring_cqe &cqe);
+  void HandlePollOut(UringConnection &state, const io_uring_cqe &cqe);
+  void RecycleBuffer(unsigned short buffer_id); // 把缓冲区归还给缓冲区环
+  void MaybeRelease(uint64_t id); // 连接已移除且没有在途请求时释放状态
+  void DrainRing(); // 取消全部在途请求并等待它们完成，析构时调用
+
+  IoUring ring_;                   // io_uring实例
+  io_uring_buf_ring *buf_ring_;    // 提供缓冲区环
+  size_t buf_ring_size_;           // 缓冲区环占用的内存
+  char *buf_base_;                 // 接收缓冲区内存
+  unsigned short buf_tail_;        // 缓冲区环的本地尾部位置
+  uint64_t wakeup_value_;          // eventfd读取目标
+  bool accept_armed_;              // 多次触发的accept是否仍在途
+  bool wakeup_armed_;              // eventfd的读取是否仍在途
+  std::unordered_map<uint64_t, std::unique_ptr<UringConnection>> states_; // 连接编号到状态
+};
+
+#endif // TINY_SERVER_HAS_IO_URING
+#endif
@@ -0,0 +1,201 @@
+#include "cpu_affinity.h"
+#include <dirent.h>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+constexpr char CPU_SYSFS_PATH[] = "/sys/devices/system/cpu/cpu";
+
+// 一个CPU的拓扑位置
+struct CpuInfo {
+  int cpu_;
+  int node_;    // NUMA节点
+  int package_; // 物理CPU（插槽）
+  int core_;    // 插槽内的物理核心
+  int smt_;     // 在同一物理核心的超线程中的序号
+};
+
+int ReadSysInt(const std::string &path, int fallback) {
+  std::ifstream in(path);
+  int value;
+  return in >> value ? value : fallback;
+}
+
+/**
+ * @brief 读取进程可用的CPU的拓扑
+ *
+ * 只包含当前亲和性掩码（受taskset、容器cpuset限制）中的CPU，第一次调用时读取并缓存。
+ */
+const std::vector<CpuInfo> &Topology() {
+  static const std::vector<CpuInfo> topology = [] {
+    std::vector<CpuInfo> cpus;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+      return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (!CPU_ISSET(cpu, &set)) {
+        continue;
+      }
+      std::string base = CPU_SYSFS_PATH + std::to_string(cpu) + "/topology/";
+      cpus.push_back({cpu, CpuNode(cpu),
+                      ReadSysInt(base + "physical_package_id", 0),
+                      ReadSysInt(base + "core_id", cpu), 0});
+    }
+    // 同一物理核心的超线程按CPU编号排序
+    std::map<std::pair<int, int>, int> siblings;
+    for (CpuInfo &info : cpus) {
+      info.smt_ = siblings[{info.package_, info.core_}]++;
+    }
+    return cpus;
+  }();
+  return topology;
+}
+
+std::vector<int> CompactOrder(std::vector<CpuInfo> cpus) {
+  std::sort(cpus.begin(), cpus.end(), [](const CpuInfo &a, const CpuInfo &b) {
+    return std::tie(a.node_, a.package_, a.core_, a.smt_) <
+           std::tie(b.node_, b.package_, b.core_, b.smt_);
+  });
+  std::vector<int> order;
+  for (const CpuInfo &info : cpus) {
+    order.push_back(info.cpu_);
+  }
+  return order;
+}
+
+std::vector<int> ScatterOrder(std::vector<CpuInfo> cpus) {
+  // 每个节点内先排各物理核心的第一个超线程，再排第二个
+  std::sort(cpus.begin(), cpus.end(), [](const CpuInfo &a, const CpuInfo &b) {
+    return std::tie(a.smt_, a.package_, a.core_, a.cpu_) <
+           std::tie(b.smt_, b.package_, b.core_, b.cpu_);
+  });
+  std::map<int, std::vector<int>> nodes;
+  for (const CpuInfo &info : cpus) {
+    nodes[info.node_].push_back(info.cpu_);
+  }
+  // 各节点轮流取一个
+  std::vector<int> order;
+  for (size_t i = 0; order.size() < cpus.size(); ++i) {
+    for (const auto &node : nodes) {
+      if (i < node.second.size()) {
+        order.push_back(node.second[i]);
+      }
+    }
+  }
+  return order;
+}
+
+// 解析CPU列表，如"0-3,8,10-11"
+bool ParseCpuList(const std::string &spec, std::vector<int> *cpus) {
+  std::stringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    size_t dash = item.find('-');
+    try {
+      size_t end = 0;
+      int first = std::stoi(item.substr(0, dash), &end);
+      if (end != (dash == std::string::npos ? item.size() : dash)) {
+        return false;
+      }
+      int last = first;
+      if (dash != std::string::npos) {
+        last = std::stoi(item.substr(dash + 1), &end);
+        if (end != item.size() - dash - 1) {
+          return false;
+        }
+      }
+      if (first < 0 || last < first || last >= CPU_SETSIZE) {
+        return false;
+      }
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus->push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      return false;
+    }
+  }
+  return !cpus->empty();
+}
+} // namespace
+
+CpuAffinity::CpuAffinity(AffinityPolicy policy, std::vector<int> cpus) {
+  switch (policy) {
+  case AffinityPolicy::NONE:
+    break;
+  case AffinityPolicy::COMPACT:
+    order_ = CompactOrder(Topology());
+    break;
+  case AffinityPolicy::SCATTER:
+    order_ = ScatterOrder(Topology());
+    break;
+  case AffinityPolicy::EXPLICIT:
+    order_ = std::move(cpus);
+    break;
+  }
+}
+
+CpuAffinity CpuAffinity::Parse(const std::string &spec) {
+  if (spec.empty() || spec == "none") {
+    return CpuAffinity();
+  }
+  if (spec == "compact") {
+    return CpuAffinity(AffinityPolicy::COMPACT);
+  }
+  if (spec == "scatter") {
+    return CpuAffinity(AffinityPolicy::SCATTER);
+  }
+  std::vector<int> cpus;
+  if (!ParseCpuList(spec, &cpus)) {
+    throw std::runtime_error("Invalid CPU affinity: " + spec);
+  }
+  return CpuAffinity(AffinityPolicy::EXPLICIT, std::move(cpus));
+}
+
+CpuAffinity CpuAffinity::From(size_t offset) const {
+  CpuAffinity affinity = *this;
+  affinity.offset_ += offset;
+  return affinity;
+}
+
+int CpuAffinity::CpuFor(size_t index) const {
+  if (order_.empty()) {
+    return -1;
+  }
+  return order_[(offset_ + index) % order_.size()];
+}
+
+bool CpuAffinity::PinCurrentThread(size_t index) const {
+  int cpu = CpuFor(index);
+  if (cpu < 0) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * @brief CPU所在的NUMA节点
+ *
+ * 内核在/sys/devices/system/cpu/cpuN/下为CPU所在的节点创建nodeK链接。
+ */
+int CpuNode(int cpu) {
+  std::string path = CPU_SYSFS_PATH + std::to_string(cpu);
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return 0;
+  }
+  int node = 0;
+  while (dirent *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 &&
+        isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
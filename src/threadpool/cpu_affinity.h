@@ -0,0 +1,39 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+#include "common.h"
+
+// 线程绑定CPU的策略
+enum class AffinityPolicy {
+  NONE,    // 不绑定，由内核调度
+  COMPACT, // 先填满一个NUMA节点，节点内按物理核心顺序，同一核心的超线程相邻
+  SCATTER, // 轮流使用各NUMA节点，节点内先用不同的物理核心，再用超线程
+  EXPLICIT // 按给定的CPU列表依次使用
+};
+
+// 一组线程的CPU绑定配置：按策略把进程可用的CPU排成一个序列，第index个线程绑定到序列中的第index个CPU，
+// 线程数超过CPU数时从头循环。拓扑从/sys/devices/system/cpu读取，读不到时所有CPU视为同一个节点
+class CpuAffinity {
+public:
+  CpuAffinity() = default;
+  explicit CpuAffinity(AffinityPolicy policy, std::vector<int> cpus = {});
+
+  // 解析"none"、"compact"、"scatter"或CPU列表（如"0-3,8"，即EXPLICIT），格式非法时抛出std::runtime_error
+  static CpuAffinity Parse(const std::string &spec);
+
+  // 从序列中第offset个CPU开始分配的副本，用于让不同用途的线程（如事件循环和线程池）错开
+  CpuAffinity From(size_t offset) const;
+  bool Enabled() const { return !order_.empty(); }
+  // 第index个线程应绑定的CPU，不绑定时返回-1
+  int CpuFor(size_t index) const;
+  // 把调用线程绑定到第index个线程对应的CPU，没有绑定或绑定失败时返回false
+  bool PinCurrentThread(size_t index) const;
+
+private:
+  std::vector<int> order_; // 按策略排好的CPU序列，为空时不绑定
+  size_t offset_ = 0;      // 序列的起始位置
+};
+
+// CPU所在的NUMA节点，无法获取时返回0
+int CpuNode(int cpu);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef INLINE_TASK_H
+#define INLINE_TASK_H
+#include "common.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+constexpr size_t INLINE_TASK_SIZE = 40; // 直接保存在任务对象内部的可调用对象的最大字节数
+
+// 无返回值的任务：不超过INLINE_TASK_SIZE的可调用对象直接构造在对象内部，
+// 更大的才分配堆内存。与std::function不同，可调用对象不需要可拷贝，也不经过类型擦除的堆分配。
+// 对象本身不移动，由线程池在预分配的槽中原地构造和销毁
+class InlineTask {
+public:
+  InlineTask() = default;
+  ~InlineTask() { Reset(); }
+
+  InlineTask(const InlineTask &) = delete;
+  InlineTask &operator=(const InlineTask &) = delete;
+
+  // 原地构造可调用对象，原有的可调用对象先销毁
+  template <typename Func> void Emplace(Func &&func) {
+    using Callable = typename std::decay<Func>::type;
+    Reset();
+    if constexpr (sizeof(Callable) <= INLINE_TASK_SIZE &&
+                  alignof(Callable) <= alignof(std::max_align_t)) {
+      new (storage_) Callable(std::forward<Func>(func));
+      ops_ = &InlineOps<Callable>::ops;
+    } else {
+      *reinterpret_cast<Callable **>(storage_) =
+          new Callable(std::forward<Func>(func));
+      ops_ = &HeapOps<Callable>::ops;
+    }
+  }
+
+  // 调用可调用对象，调用后仍然保留，由Reset销毁
+  void operator()() { ops_->invoke(storage_); }
+
+  // 销毁可调用对象
+  void Reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+private:
+  // 按可调用对象类型生成的操作表
+  struct Ops {
+    void (*invoke)(void *storage);
+    void (*destroy)(void *storage);
+  };
+
+  // 可调用对象保存在storage_中
+  template <typename Callable> struct InlineOps {
+    static void Invoke(void *storage) {
+      (*static_cast<Callable *>(storage))();
+    }
+    static void Destroy(void *storage) {
+      static_cast<Callable *>(storage)->~Callable();
+    }
+    static constexpr Ops ops = {&Invoke, &Destroy};
+  };
+
+  // storage_中保存指向堆上可调用对象的指针
+  template <typename Callable> struct HeapOps {
+    static void Invoke(void *storage) { (**static_cast<Callable **>(storage))(); }
+    static void Destroy(void *storage) {
+      delete *static_cast<Callable **>(storage);
+    }
+    static constexpr Ops ops = {&Invoke, &Destroy};
+  };
+
+  alignas(std::max_align_t) unsigned char storage_[INLINE_TASK_SIZE];
+  const Ops *ops_ = nullptr; // 为nullptr时没有可调用对象
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+#include "common.h"
+#include <type_traits>
+
+// 有界多生产者多消费者无锁队列（Vyukov）：环形数组的每个位置带一个序号，
+// 生产者和消费者各自用一次CAS领取位置，再通过位置的序号交接元素，不需要锁，
+// 也不像链表队列那样为每个元素分配内存。容量在构造时向上取整为2的幂，之后不变。
+// T必须可以平凡拷贝（通常是指针）
+template <typename T> class MpmcQueue {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "MpmcQueue elements must be trivially copyable");
+
+public:
+  explicit MpmcQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+  // 放入元素，队列已满时返回false
+  bool TryPush(T item) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells_[pos & mask_];
+      size_t sequence = cell.sequence_.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        // 位置空闲，领取它
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          cell.data_ = item;
+          // 序号变为pos+1表示元素已写入，消费者可以取走
+          cell.sequence_.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // 位置上一轮的元素还没有被取走：队列已满
+        return false;
+      } else {
+        // 其他生产者已领取该位置，重新读取
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // 取出最早放入的元素，队列为空时返回false
+  bool TryPop(T *item) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells_[pos & mask_];
+      size_t sequence = cell.sequence_.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          *item = cell.data_;
+          // 序号变为下一轮生产者期望的值，位置可以再次放入
+          cell.sequence_.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // 位置上还没有元素：队列为空
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+private:
+  // 环形数组的一个位置，独占缓存行，相邻位置的生产者和消费者互不干扰
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence_; // 位置的序号，决定当前轮到生产者还是消费者
+    T data_;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueue_pos_{0}; // 生产者领取的下一个位置，独占缓存行
+  alignas(64) std::atomic<size_t> dequeue_pos_{0}; // 消费者领取的下一个位置，独占缓存行
+};
+
+#endif
@@ -1,84 +1,499 @@
 #include "thread_pool.h"
+#include "thread_name.h"
+#include <climits>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+namespace {
+constexpr int SPIN_ROUNDS = 16; // 休眠前重新查找任务的次数，短暂空闲时不必进入内核
+constexpr uint32_t NO_SLOT = UINT32_MAX; // 空闲链表的结尾
+
+// 弹性线程数：每个统计周期计算任务的平均排队时间和繁忙线程比例。
+// 增加线程要求排队时间长且大部分线程繁忙，一个周期就生效；减少线程要求连续多个周期几乎空闲，
+// 每次只退出一个，两组阈值之间的区间不做调整，避免线程数在突发流量下来回震荡
+constexpr int ADJUST_INTERVAL_MS = 100;  // 统计周期
+constexpr double GROW_WAIT_US = 1000;    // 平均排队时间超过该值时考虑增加线程
+constexpr double GROW_BUSY_RATIO = 0.75; // 同时繁忙线程比例不低于该值才增加
+constexpr double SHRINK_WAIT_US = 100;   // 平均排队时间低于该值时才考虑减少线程
+constexpr double SHRINK_BUSY_RATIO = 0.25; // 繁忙线程比例的滑动平均低于该值时才考虑减少
+constexpr size_t SHRINK_ROUNDS = 30;     // 连续满足减少条件多少个周期后开始减少
+constexpr size_t SHRINK_STEP_ROUNDS = 5; // 持续空闲时之后每隔多少个周期再减少一个
+constexpr double BUSY_SMOOTHING = 0.2;   // 繁忙比例滑动平均中新样本的权重
+constexpr uint32_t WAIT_SAMPLE_PERIOD = 8; // 每个提交线程每隔多少个任务记录一次提交时间，减少读时钟的开销
+
+// 当前线程所属的线程池及其工作线程编号，非工作线程为nullptr
+thread_local const void *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+// 每个线程独立的xorshift随机数，用于选择窃取的起点，避免空闲线程总是争抢同一个队列
+size_t NextRandom() {
+  thread_local uint64_t state =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return static_cast<size_t>(state);
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex word must be a plain 32-bit integer");
+
+// 值仍为expected时休眠，直到被唤醒；可能提前返回，调用方需要重新检查条件
+void FutexWait(std::atomic<uint32_t> *word, uint32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE,
+          expected, nullptr, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t> *word, int count) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE,
+          count, nullptr, nullptr, 0);
+}
+
+// 进程可以运行的CPU数（受亲和性掩码和容器限制），获取失败时按硬件线程数
+size_t AvailableCpus() {
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    return CPU_COUNT(&set);
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
 
 ThreadPool::ThreadPool(size_t init_threads, size_t max_threads,
-                       size_t queue_limit)
-    : max_threads_(max_threads), queue_limit_(queue_limit),
-      logger_(Logger::GetInstance(LOGFILE)) {
+                       size_t queue_limit, QueueBackend backend,
+                       const std::string &name, const CpuAffinity &affinity)
+    : backend_(backend), init_threads_(init_threads),
+      max_threads_(max_threads), queue_limit_(queue_limit), name_(name),
+      affinity_(affinity), logger_(Logger::GetInstance(LOGFILE)) {
   stop_.store(false);
   logger_.Log(Logger::INFO, "Initializing ThreadPool ");
+  if (init_threads_ == 0) {
+    init_threads_ = 1;
+  }
+  if (max_threads_ < init_threads_) {
+    max_threads_ = init_threads_;
+  }
+  if (queue_limit_ == 0) {
+    queue_limit_ = 1;
+  }
+  elastic_ = max_threads_ > init_threads_;
+  // 只有一个CPU时空转的线程只会推迟提交者和其他工作线程，找不到任务就直接休眠
+  spin_rounds_ = AvailableCpus() > 1 ? SPIN_ROUNDS : 0;
+  // 排队的任务不超过queue_limit个，正在执行的任务不超过线程数，槽的个数按两者之和预分配，
+  // 占用排队名额后一定能取到空闲槽
+  size_t slot_count = queue_limit_ + max_threads_;
+  slots_.reset(new TaskSlot[slot_count]);
+  for (size_t i = 0; i < slot_count; ++i) {
+    slots_[i].next_free_.store(i + 1 < slot_count ? i + 1 : NO_SLOT,
+                               std::memory_order_relaxed);
+  }
+  free_head_.store(0);
+  if (backend_ == QueueBackend::MPMC) {
+    shared_queue_.reset(new MpmcQueue<TaskSlot *>(queue_limit_));
+  } else {
+    injected_.reset(new TaskSlot *[queue_limit_]);
+  }
+  // 按最大线程数创建全部位置，之后位置数组不再改变，窃取时不需要加锁；
+  // 位置上的队列和统计由工作线程自己创建
+  for (size_t i = 0; i < max_threads_; ++i) {
+    workers_.emplace_back(new WorkerContext);
+  }
+  last_tasks_.assign(max_threads_, 0);
+  last_sampled_.assign(max_threads_, 0);
+  last_wait_ns_.assign(max_threads_, 0);
   // 创建初始线程
-  for (auto i = 0; i < init_threads; ++i) {
-    workers_.emplace_back(std::thread(&ThreadPool::Worker, this));
-    logger_.Log(Logger::DEBUG, "Created Thread" + std::to_string(i + 1));
+  for (size_t i = 0; i < init_threads_; ++i) {
+    StartWorker();
+  }
+  if (elastic_) {
+    monitor_ = std::thread(&ThreadPool::Monitor, this);
   }
   logger_.Log(Logger::INFO, "ThreadPool Initialized with" +
-                                std::to_string(init_threads) + "threads");
+                                std::to_string(init_threads_) + "threads");
 }
 
 ThreadPool::~ThreadPool() {
   {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    std::lock_guard<std::mutex> lock(monitor_mutex_);
     stop_.store(true);
   }
-  condition_.notify_all();
-  for (std::thread &worker : workers_) {
-    if (worker.joinable()) {
-      worker.join();
+  WakeWorkers(INT_MAX);
+  monitor_condition_.notify_all();
+  if (monitor_.joinable()) {
+    monitor_.join();
+  }
+  for (std::unique_ptr<WorkerContext> &context : workers_) {
+    if (context->thread_.joinable()) {
+      context->thread_.join();
     }
   }
+  // 全部线程退出后再释放，之前其他线程可能还在从中窃取
+  for (std::unique_ptr<WorkerContext> &context : workers_) {
+    delete context->state_.load();
+  }
   logger_.Log(Logger::INFO, "ThreadPool Destroyed");
 }
 
+/**
+ * @brief 占用一个排队名额和一个空闲槽
+ *
+ * 空闲链表是带版本号的无锁栈，版本号每次修改都加一，避免槽被取走又放回时比较交换误判成功。
+ *
+ * @return 空闲槽，其中没有任务
+ */
+ThreadPool::TaskSlot *ThreadPool::AcquireSlot() {
+  if (pending_.fetch_add(1) >= queue_limit_) {
+    pending_.fetch_sub(1);
+    logger_.Log(Logger::ERROR, "Task Queue is full");
+    throw std::runtime_error("Task Queue is full");
+  }
+  uint64_t head = free_head_.load(std::memory_order_acquire);
+  while (true) {
+    uint32_t index = static_cast<uint32_t>(head);
+    if (index == NO_SLOT) {
+      // 按槽的个数不会发生，防御性处理
+      pending_.fetch_sub(1);
+      throw std::runtime_error("Task Queue is full");
+    }
+    uint64_t next = slots_[index].next_free_.load(std::memory_order_relaxed);
+    uint64_t desired = (((head >> 32) + 1) << 32) | next;
+    if (free_head_.compare_exchange_weak(head, desired,
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+      return &slots_[index];
+    }
+  }
+}
+
+void ThreadPool::ReleaseSlot(TaskSlot *slot) {
+  uint64_t index = static_cast<uint64_t>(slot - slots_.get());
+  uint64_t head = free_head_.load(std::memory_order_relaxed);
+  uint64_t desired;
+  do {
+    slot->next_free_.store(static_cast<uint32_t>(head),
+                           std::memory_order_relaxed);
+    desired = (((head >> 32) + 1) << 32) | index;
+  } while (!free_head_.compare_exchange_weak(head, desired,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+}
+
+/**
+ * @brief 放入一个任务
+ *
+ * MPMC模式下放入共享队列；否则工作线程提交的任务放入自己的双端队列底部，不需要加锁，
+ * 其他线程提交的任务放入注入队列。放入后只有存在休眠的工作线程时才唤醒，繁忙时提交不进入内核。
+ *
+ * @param slot 已构造好任务的槽，执行后由线程池放回空闲链表
+ */
+void ThreadPool::Submit(TaskSlot *slot) {
+  if (elastic_) {
+    thread_local uint32_t submit_count = 0;
+    slot->submit_ns_ = ++submit_count % WAIT_SAMPLE_PERIOD == 0 ? NowNs() : 0;
+  }
+  if (backend_ == QueueBackend::MPMC) {
+    // 队列中的任务数不超过排队名额，不会满
+    while (!shared_queue_->TryPush(slot)) {
+      std::this_thread::yield();
+    }
+  } else if (current_pool == this) {
+    WorkerState *state =
+        workers_[current_index]->state_.load(std::memory_order_relaxed);
+    state->deque_.Push(slot);
+  } else {
+    std::lock_guard<std::mutex> lock(inject_mutex_);
+    // 注入队列中的任务数不超过排队名额，环形数组不会溢出
+    injected_[inject_tail_++ % queue_limit_] = slot;
+    injected_count_.fetch_add(1, std::memory_order_release);
+  }
+  // pending_的增加与工作线程休眠前的检查都是seq_cst，二者至少有一方看到对方：
+  // 要么工作线程看到pending_>0不休眠，要么这里看到sleepers_>0去唤醒
+  if (sleepers_.load() > 0) {
+    WakeWorkers(1);
+  }
+}
+
+ThreadPool::TaskSlot *ThreadPool::FindTask(WorkerState &state) {
+  TaskSlot *slot = nullptr;
+  if (backend_ == QueueBackend::MPMC) {
+    return shared_queue_->TryPop(&slot) ? slot : nullptr;
+  }
+  if (state.deque_.Pop(&slot)) {
+    return slot;
+  }
+  if ((slot = PopInjected()) != nullptr) {
+    return slot;
+  }
+  return Steal(state);
+}
+
+ThreadPool::TaskSlot *ThreadPool::PopInjected() {
+  if (injected_count_.load(std::memory_order_acquire) == 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(inject_mutex_);
+  if (inject_head_ == inject_tail_) {
+    return nullptr;
+  }
+  TaskSlot *slot = injected_[inject_head_++ % queue_limit_];
+  injected_count_.fetch_sub(1, std::memory_order_relaxed);
+  return slot;
+}
 
+ThreadPool::TaskSlot *ThreadPool::Steal(const WorkerState &state) {
+  size_t count = workers_.size();
+  size_t start = NextRandom() % count;
+  for (size_t i = 0; i < count; ++i) {
+    size_t victim = (start + i) % count;
+    WorkerState *other = workers_[victim]->state_.load(std::memory_order_acquire);
+    if (other == nullptr || other == &state || other->deque_.Empty()) {
+      continue;
+    }
+    TaskSlot *slot = nullptr;
+    if (other->deque_.Steal(&slot)) {
+      return slot;
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPool::Run(WorkerState &state, TaskSlot *slot) {
+  pending_.fetch_sub(1);
+  if (elastic_) {
+    // 统计只由本线程写入，不需要原子的读改写
+    state.tasks_.store(state.tasks_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    if (slot->submit_ns_ != 0) {
+      state.sampled_.store(
+          state.sampled_.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+      state.wait_ns_.store(
+          state.wait_ns_.load(std::memory_order_relaxed) +
+              (NowNs() - slot->submit_ns_),
+          std::memory_order_relaxed);
+    }
+    state.running_.store(true, std::memory_order_relaxed);
+  }
+  try {
+    slot->task_();
+  } catch (const std::exception &e) {
+    logger_.Log(Logger::ERROR,
+                "Task Failed with Exception: " + std::string(e.what()));
+  }
+  state.running_.store(false, std::memory_order_relaxed);
+  slot->task_.Reset();
+  ReleaseSlot(slot);
+}
+
+/**
+ * @brief 工作线程函数
+ *
+ * 有任务时连续执行；找不到任务时先重试几轮（其他线程可能正在放入或窃取），
+ * 仍然没有时若有待退出的名额就领取并退出，否则在futex上休眠，
+ * 直到有新任务、有退出名额或线程池停止。停止后执行完全部已提交的任务再退出。
+ * 只有本线程向自己的队列放入任务，找不到任务时自己的队列一定为空，退出不会丢下任务。
+ *
+ * @param index 工作线程位置的下标
+ */
+void ThreadPool::Worker(size_t index) {
+  current_pool = this;
+  current_index = index;
+  SetCurrentThreadName(name_ + "-" + std::to_string(index));
+  affinity_.PinCurrentThread(index);
+  WorkerContext &context = *workers_[index];
+  WorkerState *state = context.state_.load(std::memory_order_acquire);
+  if (state == nullptr) {
+    // 绑定CPU之后再创建：内存在首次访问时从访问线程所在的NUMA节点分配，
+    // 双端队列和统计都位于本线程所在的节点
+    state = new WorkerState;
+    context.state_.store(state, std::memory_order_release);
+  }
+  logger_.Log(Logger::INFO, "Worker Thread Started");
+  int idle_rounds = 0;
+  while (true) {
+    TaskSlot *slot = FindTask(*state);
+    if (slot != nullptr) {
+      Run(*state, slot);
+      idle_rounds = 0;
+      continue;
+    }
+    if (pending_.load() > 0 || ++idle_rounds < spin_rounds_) {
+      std::this_thread::yield();
+      continue;
+    }
+    idle_rounds = 0;
+    if (TryRetire()) {
+      logger_.Log(Logger::DEBUG, "Worker Thread Retired");
+      break;
+    }
+    Park();
+    if (stop_ && pending_.load() == 0) {
+      logger_.Log(Logger::DEBUG, "Worker Thread Stopping");
+      break;
+    }
+  }
+  context.alive_.store(false);
+}
 
-void ThreadPool::Worker() {
-    logger_.Log(Logger::INFO, "Worker Thread Started");
-    while (true) {
-        std::function<void()> task;
+/**
+ * @brief 空闲的工作线程休眠
+ *
+ * 先读出futex字再登记为休眠并检查条件：唤醒方先改变条件再把futex字加一，
+ * 若加一发生在读出之后，FUTEX_WAIT发现值已改变立即返回，不会错过唤醒。
+ * 登记休眠与检查pending_、提交方增加pending_与检查sleepers_都是seq_cst，二者至少有一方看到对方。
+ */
+void ThreadPool::Park() {
+  uint32_t seq = wake_seq_.load();
+  sleepers_.fetch_add(1);
+  if (!stop_ && pending_.load() == 0 && retiring_.load() == 0) {
+    FutexWait(&wake_seq_, seq);
+  }
+  sleepers_.fetch_sub(1);
+}
 
-        {
-            std::unique_lock<std::mutex> lock(this->queue_mutex_);
-            this->condition_.wait(
-                lock, [this] { 
-                 logger_.Log(Logger::DEBUG, "Worker checking for tasks");
-                  return this->stop_ || !this->tasks_.empty(); });
+void ThreadPool::WakeWorkers(int count) {
+  wake_seq_.fetch_add(1);
+  FutexWake(&wake_seq_, count);
+}
 
-            if (this->stop_ && this->tasks_.empty()) {
-              logger_.Log(Logger::DEBUG, "Worker Thread Stopping");
-                return;
-            }
+bool ThreadPool::StartWorker() {
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    WorkerContext &context = *workers_[i];
+    if (context.alive_.load()) {
+      continue;
+    }
+    // 位置上已退出的线程
+    if (context.thread_.joinable()) {
+      context.thread_.join();
+    }
+    context.alive_.store(true);
+    threads_.fetch_add(1);
+    context.thread_ = std::thread(&ThreadPool::Worker, this, i);
+    logger_.Log(Logger::DEBUG, "Created Thread" + std::to_string(i + 1));
+    return true;
+  }
+  return false;
+}
 
-            task = std::move(this->tasks_.front());
-            this->tasks_.pop();
-            logger_.Log(Logger::DEBUG, "Task Dequeued");
-        }
-        try {
-            task();
-            logger_.Log(Logger::DEBUG, "Task Executed successfully");
-        } catch (const std::exception &e) {
-            logger_.Log(Logger::ERROR,
-                        "Task Failed with Exception: " + std::string(e.what()));
-        }
+bool ThreadPool::TryRetire() {
+  size_t retiring = retiring_.load();
+  while (retiring > 0) {
+    if (retiring_.compare_exchange_weak(retiring, retiring - 1)) {
+      threads_.fetch_sub(1);
+      return true;
     }
-    logger_.Log(Logger::DEBUG, "Worker Thread Stopped");
+  }
+  return false;
 }
 
-void ThreadPool::AdjustThreads() {
-  logger_.Log(Logger::INFO, "Adjusting Threads");
-  while (!stop_.load()) {
-    std::this_thread::sleep_for(std::chrono::seconds(5));
+/**
+ * @brief 监控线程函数
+ *
+ * 每个统计周期汇总各工作线程在周期内开始执行的任务中记录了提交时间的那部分的排队时间，得到平均排队时间，
+ * 并采样正在执行任务的线程比例。周期内没有任务开始执行但仍有任务排队时，
+ * 说明全部线程都被长任务占住，排队时间按一个周期计算。
+ */
+void ThreadPool::Monitor() {
+  SetCurrentThreadName(name_ + "-monitor");
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+  while (true) {
+    monitor_condition_.wait_for(
+        lock, std::chrono::milliseconds(ADJUST_INTERVAL_MS),
+        [this] { return stop_.load(); });
+    if (stop_) {
+      return;
+    }
+    lock.unlock();
+    uint64_t tasks = 0;
+    uint64_t sampled = 0;
+    uint64_t wait_ns = 0;
+    size_t busy = 0;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      WorkerState *state = workers_[i]->state_.load(std::memory_order_acquire);
+      if (state == nullptr) {
+        continue;
+      }
+      uint64_t state_tasks = state->tasks_.load(std::memory_order_relaxed);
+      uint64_t state_sampled =
+          state->sampled_.load(std::memory_order_relaxed);
+      uint64_t state_wait = state->wait_ns_.load(std::memory_order_relaxed);
+      tasks += state_tasks - last_tasks_[i];
+      sampled += state_sampled - last_sampled_[i];
+      wait_ns += state_wait - last_wait_ns_[i];
+      last_tasks_[i] = state_tasks;
+      last_sampled_[i] = state_sampled;
+      last_wait_ns_[i] = state_wait;
+      if (state->running_.load(std::memory_order_relaxed)) {
+        ++busy;
+      }
+    }
+    double wait_us = sampled > 0 ? wait_ns / 1000.0 / sampled : 0;
+    if (tasks == 0 && pending_.load() > 0) {
+      wait_us = ADJUST_INTERVAL_MS * 1000.0;
+    }
+    size_t threads = std::max<size_t>(threads_.load(), 1);
+    Adjust(wait_us, std::min(1.0, static_cast<double>(busy) / threads));
+    lock.lock();
+  }
+}
 
-    std::unique_lock<std::mutex> lock(queue_mutex_);
-    size_t task_count = tasks_.size();
-    size_t current_threads = workers_.size();
-    // 扩容：如果任务数远大于线程数，且线程数小于最大限制
-    if (task_count > current_threads * 2 && current_threads < max_threads_) {
-      workers_.emplace_back(std::thread(&ThreadPool::Worker, this));
-      logger_.Log(Logger::INFO, "ThreadPool expanded,Created new Thread");
-    } else if (task_count < current_threads / 2 && current_threads > 1) {
-      workers_.back().detach();
-      workers_.pop_back();
-      logger_.Log(Logger::INFO, "ThreadPool shrinked");
+/**
+ * @brief 根据一个统计周期的结果调整线程数
+ *
+ * 排队时间长且大部分线程繁忙时，先撤销尚未被领取的退出名额，再启动新线程，每次最多增加当前线程数的一半；
+ * 连续SHRINK_ROUNDS个周期排队时间很短且繁忙比例的滑动平均很低时，发出一个退出名额，
+ * 由某个空闲线程领取后自行退出，仍然空闲时之后每SHRINK_STEP_ROUNDS个周期再发出一个，线程数不低于init_threads。
+ *
+ * @param wait_us 周期内开始执行的任务的平均排队时间（微秒）
+ * @param busy 采样时正在执行任务的线程比例
+ */
+void ThreadPool::Adjust(double wait_us, double busy) {
+  busy_average_ =
+      busy_average_ * (1 - BUSY_SMOOTHING) + busy * BUSY_SMOOTHING;
+  size_t threads = threads_.load();
+  if (wait_us >= GROW_WAIT_US && busy >= GROW_BUSY_RATIO) {
+    idle_rounds_ = 0;
+    size_t step = std::max<size_t>(1, threads / 2);
+    size_t added = 0;
+    while (added < step) {
+      size_t retiring = retiring_.load();
+      if (retiring > 0) {
+        if (retiring_.compare_exchange_weak(retiring, retiring - 1)) {
+          ++added;
+        }
+        continue;
+      }
+      if (threads_.load() >= max_threads_ || !StartWorker()) {
+        break;
+      }
+      ++added;
+    }
+    if (added > 0) {
+      logger_.Log(Logger::INFO, "ThreadPool expanded to " +
+                                    std::to_string(threads_.load()) +
+                                    " threads");
+    }
+    return;
+  }
+  if (wait_us < SHRINK_WAIT_US && busy_average_ < SHRINK_BUSY_RATIO &&
+      threads > retiring_.load() + init_threads_) {
+    if (++idle_rounds_ < SHRINK_ROUNDS) {
+      return;
     }
+    idle_rounds_ = SHRINK_ROUNDS - SHRINK_STEP_ROUNDS;
+    retiring_.fetch_add(1);
+    WakeWorkers(1);
+    logger_.Log(Logger::INFO, "ThreadPool shrinking to " +
+                                  std::to_string(threads - retiring_.load()) +
+                                  " threads");
+    return;
   }
+  idle_rounds_ = 0;
 }
@@ -1,51 +1,154 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 #include "common.h"
+#include "cpu_affinity.h"
+#include "inline_task.h"
 #include "logger.h"
+#include "mpmc_queue.h"
+#include "work_stealing_deque.h"
+
+constexpr size_t DEFAULT_POOL_MAX_THREADS = 16;  // 线程池默认最大线程数
+constexpr size_t DEFAULT_POOL_QUEUE_LIMIT = 128; // 线程池默认排队任务数上限
+
+// 线程池的任务队列实现
+enum class QueueBackend {
+  WORK_STEALING, // 每个工作线程一个Chase-Lev双端队列，外部提交经过加锁的注入队列，空闲时互相窃取
+  MPMC           // 全部线程共享一个容量为queue_limit的Vyukov无锁环形队列，严格先进先出
+};
+
+// 线程池，默认使用工作窃取：每个工作线程拥有一个Chase-Lev双端队列，工作线程内提交的任务放入自己的队列，
+// 其他线程提交的任务放入共享的注入队列。工作线程依次从自己的队列、注入队列取任务，
+// 都为空时随机选择其他工作线程窃取；也可以在构造时选择共享的无锁MPMC队列。
+// 找不到任务的线程先重试几轮，仍然没有才在futex上休眠，提交和唤醒都不经过互斥锁和条件变量。
+// 任务保存在构造时预分配的槽中（排队上限加最大线程数个），提交小任务时不分配堆内存。
+// max_threads大于init_threads时由监控线程根据任务的排队时间和线程的繁忙程度在两者之间增减线程。
+// 工作线程命名为"name-编号"，按affinity绑定CPU，每个工作线程的队列和统计由它自己在绑定后创建，位于所在的NUMA节点
 class ThreadPool {
 public:
   // 线程池构造函数
-  explicit ThreadPool(size_t init_threads = 4, size_t max_threads = 16,
-                      size_t queue_limit = 128);
+  explicit ThreadPool(size_t init_threads = 4,
+                      size_t max_threads = DEFAULT_POOL_MAX_THREADS,
+                      size_t queue_limit = DEFAULT_POOL_QUEUE_LIMIT,
+                      QueueBackend backend = QueueBackend::WORK_STEALING,
+                      const std::string &name = "pool",
+                      const CpuAffinity &affinity = CpuAffinity());
 
   ThreadPool(const ThreadPool &) = delete;
 
   ThreadPool &operator=(const ThreadPool &) = delete;
-  // 线程池析构函数
+  // 线程池析构函数，执行完已提交的任务后返回
   ~ThreadPool();
 
-  // 提交任务(支持返回值)
+  // 当前的工作线程数
+  size_t ThreadCount() const { return threads_.load(); }
+
+  // 提交任务(支持返回值)，排队的任务数达到queue_limit时抛出std::runtime_error
   template <typename Func, typename... Args>
   auto EnqueueTask(Func &&func,
                    Args &&...args) -> std::future<decltype(func(args...))> {
     using ReturnType = decltype(func(args...));
     auto task = std::make_shared<std::packaged_task<ReturnType()>>(
         std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
-    {
-      std::unique_lock<std::mutex> lock(queue_mutex_);
-      if (tasks_.size() >= queue_limit_) {
-        logger_.Log(Logger::ERROR, "Task Queue is full");
-        throw std::runtime_error("Task Queue is full");
-      }
-      tasks_.emplace([task]() { (*task)(); });
-      logger_.Log(Logger::DEBUG, "Task Enqueued");
+    std::future<ReturnType> result = task->get_future();
+    Post([task]() { (*task)(); });
+    return result;
+  }
+
+  // 提交不需要结果的任务：可调用对象可以只能移动，不经过std::bind、std::function和std::future，
+  // 不超过INLINE_TASK_SIZE时直接构造在预分配的槽中。排队的任务数达到queue_limit时抛出std::runtime_error，
+  // 任务抛出的异常只记录日志
+  template <typename Func> void Post(Func &&func) {
+    TaskSlot *slot = AcquireSlot();
+    try {
+      slot->task_.Emplace(std::forward<Func>(func));
+    } catch (...) {
+      pending_.fetch_sub(1);
+      ReleaseSlot(slot);
+      throw;
     }
-    condition_.notify_one();
-    return task->get_future();
+    Submit(slot);
   }
 
 private:
+  // 一个任务槽，独占缓存行；空闲时通过next_free_串成无锁链表
+  struct alignas(64) TaskSlot {
+    InlineTask task_;
+    std::atomic<uint32_t> next_free_{0};
+    int64_t submit_ns_ = 0; // 提交时间，用于统计排队时间；为0时该任务不参与统计
+  };
+  // 一个工作线程的任务队列和统计，由第一个在该位置运行的线程创建，之后在同一位置运行的线程（绑定同一个CPU）继续使用
+  struct WorkerState {
+    WorkStealingDeque<TaskSlot *> deque_;
+    // 以下统计只由本线程写入，监控线程读取，独占缓存行
+    alignas(64) std::atomic<uint64_t> tasks_{0};   // 已开始执行的任务数
+    std::atomic<uint64_t> sampled_{0};             // 其中记录了提交时间的任务数
+    std::atomic<uint64_t> wait_ns_{0};             // 这些任务的排队时间之和
+    std::atomic<bool> running_{false};             // 是否正在执行任务
+  };
+  // 一个工作线程的位置，按最大线程数预先创建，线程退出后位置可以复用
+  struct WorkerContext {
+    std::thread thread_;
+    std::atomic<bool> alive_{false}; // 线程是否在运行，由监控线程置位、线程退出前清除
+    std::atomic<WorkerState *> state_{nullptr}; // 线程创建之前为nullptr
+  };
+
+  // 占用一个排队名额和一个空闲槽，排队的任务数达到上限时抛出std::runtime_error
+  TaskSlot *AcquireSlot();
+  // 把槽放回空闲链表
+  void ReleaseSlot(TaskSlot *slot);
+  // 放入任务并在有线程休眠时唤醒一个；当前线程是本线程池的工作线程时放入自己的队列
+  void Submit(TaskSlot *slot);
+  // 依次从自己的队列、注入队列和其他工作线程的队列取任务，都没有时返回nullptr
+  TaskSlot *FindTask(WorkerState &state);
+  TaskSlot *PopInjected();
+  TaskSlot *Steal(const WorkerState &state);
+  void Run(WorkerState &state, TaskSlot *slot);
+  // 在futex上休眠，直到有任务、有退出名额、线程池停止或被唤醒
+  void Park();
+  // 唤醒最多count个休眠的工作线程
+  void WakeWorkers(int count);
+  // 在空闲的位置上启动一个工作线程，没有空闲位置时返回false
+  bool StartWorker();
+  // 有待退出的名额时领取一个，领取成功的工作线程随即退出
+  bool TryRetire();
+  // 监控线程：定期统计排队时间和繁忙程度，决定增加线程或让空闲线程退出
+  void Monitor();
+  void Adjust(double wait_us, double busy);
+
   // 线程池私有成员变量
-  std::vector<std::thread> workers_;        // 线程池
-  std::queue<std::function<void()>> tasks_; // 任务队列
-  std::mutex queue_mutex_;                  // 任务队列互斥锁
-  std::condition_variable condition_;       // 条件变量，用于线程同步
+  std::vector<std::unique_ptr<WorkerContext>> workers_; // 工作线程位置，个数为最大线程数
+  std::unique_ptr<TaskSlot[]> slots_;       // 预分配的任务槽
+  std::atomic<uint64_t> free_head_;         // 空闲链表头：高32位是防ABA的版本号，低32位是槽下标
+  QueueBackend backend_;                    // 任务队列实现
+  std::unique_ptr<MpmcQueue<TaskSlot *>> shared_queue_; // MPMC模式下全部线程共享的任务队列
+  std::unique_ptr<TaskSlot *[]> injected_;  // 注入队列：非工作线程提交的任务，容量为queue_limit的环形数组
+  size_t inject_head_ = 0;                  // 注入队列中第一个任务的序号
+  size_t inject_tail_ = 0;                  // 注入队列下一个空位的序号
+  std::mutex inject_mutex_;                 // 注入队列互斥锁
+  std::atomic<size_t> injected_count_{0};   // 注入队列中的任务数，为0时不加锁
+  std::atomic<size_t> pending_{0};          // 已提交、尚未开始执行的任务数
+  std::atomic<size_t> sleepers_{0};         // 正在休眠的工作线程数
+  std::atomic<uint32_t> wake_seq_{0};       // futex字，每次唤醒加一，空闲线程在此休眠
   std::atomic<bool> stop_;                  // 线程池停止标志
+  std::atomic<size_t> threads_{0};          // 当前的工作线程数
+  std::atomic<size_t> retiring_{0};         // 等待空闲线程领取的退出名额
+  bool elastic_ = false;                    // 线程数是否可变，为false时不统计排队时间
+  int spin_rounds_ = 0;                     // 休眠前重新查找任务的次数
+  std::thread monitor_;                     // 监控线程，线程数固定时不创建
+  std::mutex monitor_mutex_;                 // 监控线程互斥锁
+  std::condition_variable monitor_condition_; // 监控线程在此等待下一个统计周期或停止
+  std::vector<uint64_t> last_tasks_;        // 监控线程上次统计时各位置的任务数
+  std::vector<uint64_t> last_sampled_;      // 监控线程上次统计时各位置记录了提交时间的任务数
+  std::vector<uint64_t> last_wait_ns_;      // 监控线程上次统计时各位置的排队时间之和
+  double busy_average_ = 0;                 // 繁忙线程比例的滑动平均
+  size_t idle_rounds_ = 0;                  // 连续满足缩减条件的统计周期数
+  size_t init_threads_;                     // 线程池最小线程数
   size_t max_threads_;                      // 线程池最大线程数
-  size_t queue_limit_;                      // 任务队列最大容量
+  size_t queue_limit_;                      // 排队任务数上限
+  std::string name_;                        // 线程名前缀
+  CpuAffinity affinity_;                    // 工作线程绑定CPU的配置，第i个位置的线程绑定第i个CPU
   Logger &logger_;                          // 日志记录器
   // 线程池私有成员函数
-  void Worker();        // 工作线程函数
-  void AdjustThreads(); // 调整线程数量
+  void Worker(size_t index); // 工作线程函数
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,124 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+#include "common.h"
+#include <type_traits>
+
+constexpr size_t WORK_STEALING_DEQUE_CAPACITY = 256; // 双端队列的初始容量（2的幂）
+
+// Chase-Lev无锁双端队列：只有所属线程在底部Push/Pop（后进先出，缓存友好），
+// 其他线程从顶部Steal（先进先出）。只有队列中只剩一个元素时所属线程才与窃取者竞争一次CAS。
+// 容量不足时所属线程把元素搬到两倍大小的环形数组中，旧数组保留到析构，正在读取旧数组的窃取者不会访问已释放的内存。
+// T必须可以平凡拷贝（通常是指针）
+template <typename T> class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "WorkStealingDeque elements must be trivially copyable");
+
+public:
+  explicit WorkStealingDeque(size_t capacity = WORK_STEALING_DEQUE_CAPACITY)
+      : top_(0), bottom_(0) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    arrays_.emplace_back(new Array(size));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  // 在底部放入元素，只能由所属线程调用
+  void Push(T item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Array *array = array_.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(array->mask_)) {
+      array = Grow(array, bottom, top);
+    }
+    array->Put(bottom, item);
+    // release：窃取者读到新的bottom_时一定能读到刚写入的元素
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // 从底部取出最后放入的元素，只能由所属线程调用；队列为空时返回false
+  bool Pop(T *item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array *array = array_.load(std::memory_order_relaxed);
+    // 先公布bottom_再读top_，两者都用seq_cst，与Steal中先读top_再读bottom_的顺序配对
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+    *item = array->Get(bottom);
+    if (top == bottom) {
+      // 最后一个元素：与窃取者竞争
+      bool won = top_.compare_exchange_strong(top, top + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // 从顶部窃取最早放入的元素，任意线程可以调用；队列为空或与其他线程竞争失败时返回false
+  bool Steal(T *item) {
+    int64_t top = top_.load(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+    if (top >= bottom) {
+      return false;
+    }
+    Array *array = array_.load(std::memory_order_acquire);
+    T value = array->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return false;
+    }
+    *item = value;
+    return true;
+  }
+
+  // 近似判断是否为空，只用于决定是否值得尝试窃取
+  bool Empty() const {
+    return top_.load(std::memory_order_relaxed) >=
+           bottom_.load(std::memory_order_relaxed);
+  }
+
+private:
+  // 环形数组，下标按mask_取模
+  struct Array {
+    explicit Array(size_t size) : mask_(size - 1), slots_(new std::atomic<T>[size]) {}
+
+    T Get(int64_t index) const {
+      return slots_[static_cast<size_t>(index) & mask_].load(
+          std::memory_order_relaxed);
+    }
+    void Put(int64_t index, T item) {
+      slots_[static_cast<size_t>(index) & mask_].store(
+          item, std::memory_order_relaxed);
+    }
+
+    size_t mask_;
+    std::unique_ptr<std::atomic<T>[]> slots_;
+  };
+
+  // 把[top, bottom)中的元素搬到两倍大小的数组中并公布，返回新数组
+  Array *Grow(Array *array, int64_t bottom, int64_t top) {
+    arrays_.emplace_back(new Array((array->mask_ + 1) * 2));
+    Array *bigger = arrays_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      bigger->Put(i, array->Get(i));
+    }
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  alignas(64) std::atomic<int64_t> top_;    // 窃取者修改，独占缓存行
+  alignas(64) std::atomic<int64_t> bottom_; // 只有所属线程修改
+  std::atomic<Array *> array_;              // 当前使用的数组
+  std::vector<std::unique_ptr<Array>> arrays_; // 全部数组，只有所属线程修改
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "timer.h"
+#include "thread_name.h"
 
 Timer::Timer(std::function<void(std::function<void()>)> threadpool_executor)
     : threadpool_executor_(std::move(threadpool_executor)) , running_(true){
@@ -39,6 +40,7 @@ void Timer::Stop() {
 }
 
 void Timer::Scheduler() {
+  SetCurrentThreadName("timer");
   while (running_.load()) {
     TimerTask task;
     {
@@ -58,7 +60,9 @@ void Timer::Scheduler() {
         task=timer_queue_.top();
         timer_queue_.pop();
       }else{
-        condition_.wait_until(lock,timer_queue_.top().expiration_);
+        // 等待期间AddTimer可能使队列重新分配内存，不能引用队列中的元素
+        auto expiration=timer_queue_.top().expiration_;
+        condition_.wait_until(lock,expiration);
         continue;
       }
     }
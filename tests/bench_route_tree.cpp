@@ -0,0 +1,103 @@
+// 路由树基准测试：分别测量静态路径命中、参数路径命中和未命中三种查找的耗时，
+// 并统计查找期间的内存分配次数（应为0）。
+// 用法：bench_route_tree [轮数]，默认200轮，每轮查找全部测试路径一次
+#include "route_tree.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+constexpr size_t STATIC_ROUTES = 750; // 静态路由数
+constexpr size_t PARAM_ROUTES = 300;  // 带两个参数的路由数
+constexpr size_t ROUTES_PER_GROUP = 50; // 静态路由按组共享前缀
+constexpr long DEFAULT_ROUNDS = 200;
+
+std::atomic<long> allocations{0};
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string StaticPath(size_t i) {
+  return "/static/group" + std::to_string(i / ROUTES_PER_GROUP) + "/page" +
+         std::to_string(i);
+}
+
+std::string ParamPattern(size_t i) {
+  return "/api/service" + std::to_string(i) + "/:id/items/:item";
+}
+
+std::string ParamPath(size_t i) {
+  return "/api/service" + std::to_string(i) + "/" + std::to_string(i * 7) +
+         "/items/" + std::to_string(i % 13);
+}
+
+// 查找paths中的每个路径rounds轮，输出每次查找的平均耗时和分配次数
+void Run(const RouteTree &tree, const char *name,
+         const std::vector<std::string> &paths, long rounds) {
+  RouteMatch match;
+  size_t hits = 0;
+  size_t checksum = 0;
+  long before = allocations.load(std::memory_order_relaxed);
+  int64_t start = NowNs();
+  for (long round = 0; round < rounds; ++round) {
+    for (const std::string &path : paths) {
+      match.param_count_ = 0;
+      if (tree.Find(path, &match)) {
+        ++hits;
+        checksum += match.route_ + match.param_count_;
+      }
+    }
+  }
+  int64_t elapsed = NowNs() - start;
+  long allocated = allocations.load(std::memory_order_relaxed) - before;
+  double lookups = static_cast<double>(paths.size()) * rounds;
+  printf("%-8s %8zu paths  %7.1f ns/lookup  %5.2f allocs/lookup  hits=%zu "
+         "checksum=%zu\n",
+         name, paths.size(), elapsed / lookups, allocated / lookups, hits,
+         checksum);
+}
+
+} // namespace
+
+// 统计全部堆分配，包括标准库内部的分配
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main(int argc, char *argv[]) {
+  long rounds = argc > 1 ? std::stol(argv[1]) : DEFAULT_ROUNDS;
+  RouteTree tree;
+  std::vector<std::string> static_paths;
+  std::vector<std::string> param_paths;
+  std::vector<std::string> miss_paths;
+  for (size_t i = 0; i < STATIC_ROUTES; ++i) {
+    tree.Insert(StaticPath(i), i);
+    static_paths.push_back(StaticPath(i));
+    // 与已有路由共享前缀、在最后一段才失败
+    miss_paths.push_back(StaticPath(i) + "x");
+  }
+  for (size_t i = 0; i < PARAM_ROUTES; ++i) {
+    tree.Insert(ParamPattern(i), STATIC_ROUTES + i);
+    param_paths.push_back(ParamPath(i));
+    // 参数匹配后缺少最后一段
+    miss_paths.push_back("/api/service" + std::to_string(i) + "/1/items/");
+  }
+  Run(tree, "static", static_paths, rounds);
+  Run(tree, "param", param_paths, rounds);
+  Run(tree, "miss", miss_paths, rounds);
+  return 0;
+}
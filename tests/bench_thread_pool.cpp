@@ -0,0 +1,261 @@
+// 线程池基准测试：比较加锁队列（原实现）、工作窃取和MPMC三种任务队列，
+// 以及EnqueueTask和Post两种提交方式的吞吐量和排队延迟。
+// 用法：bench_thread_pool [线程数...]，默认依次测试16和32个线程
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// 排队上限，不小于递归提交的任务总数：工作线程在队列满时重试提交，上限过小会全部卡在提交上
+constexpr size_t BENCH_QUEUE_LIMIT = 1 << 17;
+constexpr int EXTERNAL_PRODUCERS = 4;       // 外部提交线程数
+constexpr long TASKS_PER_PRODUCER = 100000; // 每个外部提交线程提交的任务数
+constexpr int FANOUT_DEPTH = 5;             // 递归提交的层数
+constexpr int FANOUT_WIDTH = 10;            // 每个任务提交的子任务数
+constexpr long PACED_TASKS = 20000;         // 定速提交的任务数
+constexpr int PACED_GAP_US = 50;            // 定速提交的间隔
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 原实现的任务队列：一个std::queue<std::function>，所有提交和取任务争用同一把锁，作为对照
+class MutexQueuePool {
+public:
+  MutexQueuePool(size_t threads, size_t queue_limit)
+      : queue_limit_(queue_limit) {
+    for (size_t i = 0; i < threads; ++i) {
+      workers_.emplace_back([this]() { Worker(); });
+    }
+  }
+
+  ~MutexQueuePool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // 与原实现的EnqueueTask相同：每个任务包装成packaged_task并返回future
+  template <typename Func> std::future<void> EnqueueTask(const Func &func) {
+    auto task = std::make_shared<std::packaged_task<void()>>(func);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (tasks_.size() >= queue_limit_) {
+        throw std::runtime_error("Task Queue is full");
+      }
+      tasks_.emplace([task]() { (*task)(); });
+    }
+    condition_.notify_one();
+    return task->get_future();
+  }
+
+private:
+  void Worker() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_ = false;
+  size_t queue_limit_;
+};
+
+// 被测的一种配置：任务队列实现加提交方式
+enum class Variant { MUTEX, STEALING_POST, STEALING_ENQUEUE, MPMC_POST };
+
+const char *VariantName(Variant variant) {
+  switch (variant) {
+  case Variant::MUTEX:
+    return "mutex queue";
+  case Variant::STEALING_POST:
+    return "stealing Post";
+  case Variant::STEALING_ENQUEUE:
+    return "stealing Enqueue";
+  case Variant::MPMC_POST:
+    return "mpmc Post";
+  }
+  return "";
+}
+
+// 把各种配置统一成Post接口，队列满时让出CPU后重试
+class BenchPool {
+public:
+  BenchPool(Variant variant, size_t threads) : variant_(variant) {
+    if (variant == Variant::MUTEX) {
+      mutex_pool_.reset(new MutexQueuePool(threads, BENCH_QUEUE_LIMIT));
+    } else {
+      QueueBackend backend = variant == Variant::MPMC_POST
+                                 ? QueueBackend::MPMC
+                                 : QueueBackend::WORK_STEALING;
+      pool_.reset(new ThreadPool(threads, threads, BENCH_QUEUE_LIMIT, backend,
+                                 "bench"));
+    }
+  }
+
+  template <typename Func> void Post(const Func &func) {
+    while (true) {
+      try {
+        if (variant_ == Variant::MUTEX) {
+          mutex_pool_->EnqueueTask(func);
+        } else if (variant_ == Variant::STEALING_ENQUEUE) {
+          pool_->EnqueueTask(func);
+        } else {
+          pool_->Post(func);
+        }
+        return;
+      } catch (const std::runtime_error &) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+  Variant variant_;
+  std::unique_ptr<MutexQueuePool> mutex_pool_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+std::atomic<long> finished{0};     // 已完成的任务数
+std::vector<int64_t> latencies;    // 每个任务从提交到开始执行的时间
+
+void WaitFinished(long total) {
+  while (finished.load(std::memory_order_relaxed) < total) {
+    std::this_thread::yield();
+  }
+}
+
+// 输出吞吐量，有延迟记录时同时输出延迟分位数
+void Report(Variant variant, const char *scenario, size_t threads, long total,
+            int64_t elapsed_ns, bool with_latency) {
+  printf("%-17s %-22s %3zu threads %7.2f Mtask/s", VariantName(variant),
+         scenario, threads, total * 1e3 / elapsed_ns);
+  if (with_latency) {
+    std::sort(latencies.begin(), latencies.begin() + total);
+    auto percentile = [total](double q) {
+      return latencies[std::min(total - 1, static_cast<long>(q * total))] /
+             1e3;
+    };
+    printf("  p50 %8.1fus  p99 %8.1fus  p99.9 %8.1fus", percentile(0.5),
+           percentile(0.99), percentile(0.999));
+  }
+  printf("\n");
+}
+
+// 多个外部线程（如反应堆线程）同时提交，任务经过注入队列或共享队列
+void External(Variant variant, size_t threads) {
+  const long total = EXTERNAL_PRODUCERS * TASKS_PER_PRODUCER;
+  latencies.assign(total, 0);
+  finished = 0;
+  BenchPool pool(variant, threads);
+  int64_t start = NowNs();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < EXTERNAL_PRODUCERS; ++p) {
+    producers.emplace_back([&pool, p]() {
+      for (long i = 0; i < TASKS_PER_PRODUCER; ++i) {
+        long id = p * TASKS_PER_PRODUCER + i;
+        int64_t submit = NowNs();
+        pool.Post([id, submit]() {
+          latencies[id] = NowNs() - submit;
+          finished.fetch_add(1, std::memory_order_relaxed);
+        });
+      }
+    });
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  WaitFinished(total);
+  Report(variant, "external 4 producers", threads, total, NowNs() - start,
+         true);
+}
+
+// 任务在工作线程内递归提交子任务，工作窃取模式下进入本线程的队列
+void Spawn(BenchPool *pool, int depth) {
+  finished.fetch_add(1, std::memory_order_relaxed);
+  if (depth == 0) {
+    return;
+  }
+  for (int i = 0; i < FANOUT_WIDTH; ++i) {
+    pool->Post([pool, depth]() { Spawn(pool, depth - 1); });
+  }
+}
+
+void Nested(Variant variant, size_t threads) {
+  long total = 0;
+  for (long level = 1, d = 0; d <= FANOUT_DEPTH; ++d, level *= FANOUT_WIDTH) {
+    total += level;
+  }
+  finished = 0;
+  BenchPool pool(variant, threads);
+  int64_t start = NowNs();
+  pool.Post([&pool]() { Spawn(&pool, FANOUT_DEPTH); });
+  WaitFinished(total);
+  Report(variant, "nested fan-out", threads, total, NowNs() - start, false);
+}
+
+// 单个线程按固定间隔提交，线程大多处于休眠，测量唤醒带来的延迟
+void Paced(Variant variant, size_t threads) {
+  latencies.assign(PACED_TASKS, 0);
+  finished = 0;
+  BenchPool pool(variant, threads);
+  int64_t start = NowNs();
+  for (long id = 0; id < PACED_TASKS; ++id) {
+    int64_t submit = NowNs();
+    pool.Post([id, submit]() {
+      latencies[id] = NowNs() - submit;
+      finished.fetch_add(1, std::memory_order_relaxed);
+    });
+    while (NowNs() < submit + PACED_GAP_US * 1000) {
+    }
+  }
+  WaitFinished(PACED_TASKS);
+  Report(variant, "paced 50us", threads, PACED_TASKS, NowNs() - start, true);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<size_t> thread_counts;
+  for (int i = 1; i < argc; ++i) {
+    thread_counts.push_back(std::stoul(argv[i]));
+  }
+  if (thread_counts.empty()) {
+    thread_counts = {16, 32};
+  }
+  const Variant variants[] = {Variant::MUTEX, Variant::STEALING_POST,
+                              Variant::STEALING_ENQUEUE, Variant::MPMC_POST};
+  for (size_t threads : thread_counts) {
+    for (Variant variant : variants) {
+      External(variant, threads);
+    }
+    for (Variant variant : variants) {
+      Nested(variant, threads);
+    }
+    for (Variant variant : variants) {
+      Paced(variant, threads);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,827 @@
+#include <gtest/gtest.h>
+#include "async_completion.h"
+#include "buffer.h"
+#include "epoll_reactor.h"
+#include "uring_reactor.h"
+#include <thread>
+
+namespace {
+
+// 监听127.0.0.1上的临时端口
+int ListenLoopback(uint16_t *port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), len) < 0 ||
+      listen(fd, SOMAXCONN) < 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0) {
+    close(fd);
+    return -1;
+  }
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+int ConnectLoopback(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  timeval timeout{10, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+// 阻塞读取；io_uring的任务通知会打断设置了SO_RCVTIMEO的recv，被打断时重试
+ssize_t RecvRetry(int fd, void *buf, size_t len) {
+  ssize_t n;
+  do {
+    n = recv(fd, buf, len, 0);
+  } while (n < 0 && errno == EINTR);
+  return n;
+}
+
+// 从fd读取，直到收到count个响应或连接关闭、超时
+std::string ReadResponses(int fd, size_t count) {
+  std::string data;
+  char buf[65536];
+  size_t found = 0;
+  size_t scan = 0;
+  while (found < count) {
+    ssize_t n = RecvRetry(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      break;
+    }
+    data.append(buf, static_cast<size_t>(n));
+    size_t pos;
+    while ((pos = data.find("HTTP/1.1 ", scan)) != std::string::npos) {
+      ++found;
+      scan = pos + 1;
+    }
+  }
+  return data;
+}
+
+size_t CountOf(const std::string &text, const std::string &needle) {
+  size_t count = 0;
+  for (size_t pos = text.find(needle); pos != std::string::npos;
+       pos = text.find(needle, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+} // namespace
+
+TEST(OutputQueueTest, IovecStaysValidWhileAppending) {
+  std::pmr::monotonic_buffer_resource arena;
+  OutputQueue queue;
+  queue.Append(std::pmr::string("head", &arena));
+  iovec in_flight[4];
+  ASSERT_EQ(queue.FillIovec(in_flight, 4), 1u);
+  // 发送在途时继续追加短数据段，已提交的iovec必须仍然指向原来的内容
+  for (int i = 0; i < 1000; ++i) {
+    queue.Append(std::pmr::string("x", &arena));
+  }
+  EXPECT_EQ(std::string(static_cast<const char *>(in_flight[0].iov_base),
+                        in_flight[0].iov_len),
+            "head");
+  EXPECT_EQ(queue.PendingBytes(), 1004u);
+
+  // 上一次发送只写出一部分，下一次填充从剩余部分开始，追加的数据段按顺序跟在后面
+  queue.Advance(2);
+  iovec again[4];
+  ASSERT_EQ(queue.FillIovec(again, 4), 4u);
+  EXPECT_EQ(std::string(static_cast<const char *>(again[0].iov_base),
+                        again[0].iov_len),
+            "ad");
+  EXPECT_EQ(std::string(static_cast<const char *>(again[1].iov_base),
+                        again[1].iov_len),
+            "x");
+  queue.Advance(1002);
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_EQ(queue.PendingBytes(), 0u);
+}
+
+TEST(OutputQueueTest, KeepsOrderAcrossOverflow) {
+  std::pmr::monotonic_buffer_resource arena;
+  OutputQueue queue;
+  for (int round = 0; round < 3; ++round) {
+    std::string expected;
+    auto append = [&](const std::string &text) {
+      expected += text;
+      queue.Append(std::pmr::string(text, &arena));
+    };
+    for (int i = 0; i < 100; ++i) {
+      append(std::to_string(round) + ":" + std::to_string(i) + ";");
+    }
+    // 模拟每次最多写出5字节的发送，发送在途时继续追加，写出的顺序必须与追加顺序一致
+    std::string written;
+    int sends = 0;
+    while (!queue.Empty()) {
+      iovec vec[3];
+      size_t count = queue.FillIovec(vec, 3);
+      ASSERT_GT(count, 0u);
+      size_t sent = 0;
+      for (size_t i = 0; i < count && sent < 5; ++i) {
+        size_t n = std::min<size_t>(vec[i].iov_len, 5 - sent);
+        written.append(static_cast<const char *>(vec[i].iov_base), n);
+        sent += n;
+      }
+      if (++sends < 50) {
+        append("+" + std::to_string(sends));
+      }
+      queue.Advance(sent);
+    }
+    EXPECT_EQ(written, expected);
+    EXPECT_EQ(queue.PendingBytes(), 0u);
+  }
+}
+
+TEST(BufferTest, ReadFdStopsAtHighWaterMark) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  std::string payload(100000, 'a');
+  ASSERT_EQ(write(fds[1], payload.data(), payload.size()),
+            static_cast<ssize_t>(payload.size()));
+
+  Buffer buffer;
+  bool peer_closed = false;
+  int saved_errno = 0;
+  EXPECT_EQ(buffer.ReadFd(fds[0], 30000, &peer_closed, &saved_errno), 30000);
+  EXPECT_EQ(buffer.ReadableBytes(), 30000u);
+  // 已达上限时不读取，也不能误报对端关闭
+  EXPECT_EQ(buffer.ReadFd(fds[0], 30000, &peer_closed, &saved_errno), 0);
+  EXPECT_FALSE(peer_closed);
+
+  buffer.Retrieve(10000);
+  EXPECT_EQ(buffer.ReadFd(fds[0], 30000, &peer_closed, &saved_errno), 10000);
+  EXPECT_EQ(buffer.ReadableBytes(), 30000u);
+
+  buffer.RetrieveAll();
+  close(fds[1]);
+  EXPECT_EQ(buffer.ReadFd(fds[0], 1 << 20, &peer_closed, &saved_errno), 60000);
+  EXPECT_TRUE(peer_closed);
+  close(fds[0]);
+}
+
+enum class Backend { EPOLL, URING };
+
+// 在临时端口上运行一个事件循环，默认每个请求同步回复"ok"
+class ReactorTest : public ::testing::TestWithParam<Backend> {
+protected:
+  // 请求处理回调，在事件循环线程调用，派生的测试夹具可以覆盖
+  virtual void Handle(const std::shared_ptr<Connection> &conn,
+                      HttpRequest &) {
+    HttpResponse response(&conn->Arena());
+    response.SetStatusCode("200 OK");
+    response.SetBody("ok");
+    conn->SendResponse(response);
+  }
+
+  void SetUp() override {
+    listen_fd_ = ListenLoopback(&port_);
+    ASSERT_GE(listen_fd_, 0);
+    // 派生的测试夹具可以在调用SetUp之前修改options_
+    Connection::Options options = options_;
+    options.request_callback = [this](const std::shared_ptr<Connection> &conn,
+                                      HttpRequest &request) {
+      Handle(conn, request);
+    };
+    if (GetParam() == Backend::EPOLL) {
+      reactor_.reset(new EpollReactor(listen_fd_, admission_, options));
+    } else {
+#ifdef TINY_SERVER_HAS_IO_URING
+      try {
+        reactor_.reset(new UringReactor(listen_fd_, admission_, options));
+      } catch (const std::runtime_error &e) {
+        GTEST_SKIP() << e.what();
+      }
+#else
+      GTEST_SKIP() << "built without io_uring";
+#endif
+    }
+    loop_thread_ = std::thread([this]() { reactor_->Loop(); });
+  }
+
+  void TearDown() override {
+    StopLoop();
+    reactor_.reset();
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+  }
+
+  // 停止事件循环，只在循环已处理过至少一个请求之后调用（此前Stop可能早于Loop开始运行）
+  void StopLoop() {
+    if (loop_thread_.joinable()) {
+      reactor_->Stop();
+      loop_thread_.join();
+    }
+  }
+
+  AdmissionControl admission_;
+  Connection::Options options_;
+  std::unique_ptr<Reactor> reactor_;
+  std::thread loop_thread_;
+  int listen_fd_ = -1;
+  uint16_t port_ = 0;
+};
+
+TEST_P(ReactorTest, PipelinedInputBeyondHighWaterMark) {
+  int fd = ConnectLoopback(port_);
+  ASSERT_GE(fd, 0);
+  std::string request = "GET / HTTP/1.1\r\nHost: a\r\nX-Pad: " +
+                        std::string(1000, 'p') + "\r\n\r\n";
+  const size_t count = 3 * MAX_INPUT_BUFFER / request.size();
+  std::string batch;
+  for (size_t i = 0; i < count; ++i) {
+    batch += request;
+  }
+  std::thread writer([fd, &batch]() {
+    size_t sent = 0;
+    while (sent < batch.size()) {
+      ssize_t n = send(fd, batch.data() + sent, batch.size() - sent, 0);
+      if (n <= 0) {
+        break;
+      }
+      sent += static_cast<size_t>(n);
+    }
+  });
+  std::string responses = ReadResponses(fd, count);
+  writer.join();
+  EXPECT_EQ(CountOf(responses, "HTTP/1.1 200 OK"), count);
+  close(fd);
+}
+
+TEST_P(ReactorTest, DestroyWithOpenConnections) {
+  int active = ConnectLoopback(port_);
+  ASSERT_GE(active, 0);
+  std::string request = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+  ASSERT_EQ(send(active, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  ASSERT_EQ(CountOf(ReadResponses(active, 1), "HTTP/1.1 200 OK"), 1u);
+  // 空闲连接、请求不完整的连接都在析构时关闭，在途的recv随之取消
+  int partial = ConnectLoopback(port_);
+  ASSERT_GE(partial, 0);
+  std::string head = "POST / HTTP/1.1\r\nContent-Length: 100\r\n\r\nxx";
+  ASSERT_EQ(send(partial, head.data(), head.size(), 0),
+            static_cast<ssize_t>(head.size()));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  StopLoop();
+  reactor_.reset();
+  char c;
+  EXPECT_EQ(RecvRetry(partial, &c, 1), 0);
+  close(active);
+  close(partial);
+}
+
+TEST_P(ReactorTest, IdleConnectionsAreReaped) {
+  int idle = ConnectLoopback(port_);
+  ASSERT_GE(idle, 0);
+  std::string request = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+  ASSERT_EQ(send(idle, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  ASSERT_EQ(CountOf(ReadResponses(idle, 1), "HTTP/1.1 200 OK"), 1u);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+  int active = ConnectLoopback(port_);
+  ASSERT_GE(active, 0);
+  ASSERT_EQ(send(active, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  ASSERT_EQ(CountOf(ReadResponses(active, 1), "HTTP/1.1 200 OK"), 1u);
+  // 只有空闲超过超时时间的连接被关闭，最近有请求的连接保持
+  reactor_->QueueInLoop([this]() {
+    reactor_->CloseIdleConnections(std::chrono::milliseconds(200));
+  });
+  char c;
+  EXPECT_EQ(RecvRetry(idle, &c, 1), 0);
+  ASSERT_EQ(send(active, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  EXPECT_EQ(CountOf(ReadResponses(active, 1), "HTTP/1.1 200 OK"), 1u);
+  close(idle);
+  close(active);
+}
+
+// 最多接入一个连接
+class ReactorLimitTest : public ReactorTest {
+protected:
+  void SetUp() override {
+    admission_.max_connections = 1;
+    ReactorTest::SetUp();
+  }
+};
+
+TEST_P(ReactorLimitTest, RejectsWith503AtMaxConnections) {
+  std::string request = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+  int first = ConnectLoopback(port_);
+  ASSERT_GE(first, 0);
+  ASSERT_EQ(send(first, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  ASSERT_EQ(CountOf(ReadResponses(first, 1), "HTTP/1.1 200 OK"), 1u);
+
+  // 超出上限的连接不读取请求，直接收到503后被关闭
+  int second = ConnectLoopback(port_);
+  ASSERT_GE(second, 0);
+  std::string rejected = ReadResponses(second, 2);
+  EXPECT_EQ(rejected.rfind("HTTP/1.1 503 Service Unavailable\r\n", 0), 0u)
+      << rejected;
+  EXPECT_NE(rejected.find("Connection: close\r\n"), std::string::npos);
+  EXPECT_EQ(admission_.rejected_connections.load(), 1u);
+  close(second);
+
+  // 已有连接关闭后名额释放
+  close(first);
+  std::string response;
+  for (int i = 0; i < 200 && response.empty(); ++i) {
+    int next = ConnectLoopback(port_);
+    ASSERT_GE(next, 0);
+    ASSERT_EQ(send(next, request.data(), request.size(), 0),
+              static_cast<ssize_t>(request.size()));
+    std::string reply = ReadResponses(next, 1);
+    close(next);
+    if (reply.rfind("HTTP/1.1 200 OK", 0) == 0) {
+      response = reply;
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  EXPECT_FALSE(response.empty());
+}
+
+TEST_P(ReactorTest, ExpectContinue) {
+  int fd = ConnectLoopback(port_);
+  ASSERT_GE(fd, 0);
+  std::string head = "POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+                     "Expect: 100-continue\r\n\r\n";
+  ASSERT_EQ(send(fd, head.data(), head.size(), 0),
+            static_cast<ssize_t>(head.size()));
+  EXPECT_EQ(ReadResponses(fd, 1), "HTTP/1.1 100 Continue\r\n\r\n");
+  ASSERT_EQ(send(fd, "hello", 5, 0), 5);
+  EXPECT_EQ(CountOf(ReadResponses(fd, 1), "HTTP/1.1 200 OK"), 1u);
+  close(fd);
+}
+
+TEST_P(ReactorTest, OversizedBodyRejectedBeforeContinue) {
+  int fd = ConnectLoopback(port_);
+  ASSERT_GE(fd, 0);
+  std::string head = "POST / HTTP/1.1\r\nContent-Length: " +
+                     std::to_string(DEFAULT_MAX_BODY_SIZE + 1) +
+                     "\r\nExpect: 100-continue\r\n\r\n";
+  ASSERT_EQ(send(fd, head.data(), head.size(), 0),
+            static_cast<ssize_t>(head.size()));
+  // 回复413后关闭连接，不发送100 Continue
+  std::string response = ReadResponses(fd, 2);
+  EXPECT_EQ(response.rfind("HTTP/1.1 413 ", 0), 0u) << response;
+  EXPECT_EQ(CountOf(response, "100 Continue"), 0u);
+  close(fd);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, ReactorTest,
+                         ::testing::Values(Backend::EPOLL, Backend::URING));
+INSTANTIATE_TEST_SUITE_P(Backends, ReactorLimitTest,
+                         ::testing::Values(Backend::EPOLL, Backend::URING));
+
+// 每个请求以一个大文件响应，文件数据用sendfile发送
+class ReactorFileTest : public ReactorTest {
+protected:
+  static constexpr size_t FILE_SIZE = 16 * 1024 * 1024;
+
+  void SetUp() override {
+    char pattern[] = "/tmp/reactor_file_test.XXXXXX";
+    int fd = mkstemp(pattern);
+    ASSERT_GE(fd, 0);
+    path_ = pattern;
+    content_.resize(FILE_SIZE);
+    for (size_t i = 0; i < FILE_SIZE; ++i) {
+      content_[i] = static_cast<char>(i * 7 % 251);
+    }
+    ASSERT_EQ(write(fd, content_.data(), content_.size()),
+              static_cast<ssize_t>(content_.size()));
+    close(fd);
+    ReactorTest::SetUp();
+  }
+
+  void TearDown() override {
+    ReactorTest::TearDown();
+    unlink(path_.c_str());
+  }
+
+  void Handle(const std::shared_ptr<Connection> &conn,
+              HttpRequest &) override {
+    HttpResponse response(&conn->Arena());
+    response.SetStatusCode("200 OK");
+    response.SetFileBody(std::make_shared<FileBody>(
+        open(path_.c_str(), O_RDONLY | O_CLOEXEC), FILE_SIZE));
+    conn->SendResponse(response);
+  }
+
+  std::string path_;
+  std::string content_;
+};
+
+TEST_P(ReactorFileTest, LargeFileArrivesIntact) {
+  int fd = ConnectLoopback(port_);
+  ASSERT_GE(fd, 0);
+  std::string request = "GET /big HTTP/1.1\r\nHost: a\r\n\r\n";
+  // 两个管线化请求：第一个文件发送完之前第二个响应必须排在它后面
+  std::string twice = request + request;
+  ASSERT_EQ(send(fd, twice.data(), twice.size(), 0),
+            static_cast<ssize_t>(twice.size()));
+  // 延迟读取，让内核发送缓冲区写满，文件需要多次sendfile才能发完
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::string data;
+  char buf[65536];
+  for (int i = 0; i < 2; ++i) {
+    size_t head_end;
+    while ((head_end = data.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = RecvRetry(fd, buf, sizeof(buf));
+      ASSERT_GT(n, 0);
+      data.append(buf, static_cast<size_t>(n));
+    }
+    std::string head = data.substr(0, head_end);
+    EXPECT_EQ(head.rfind("HTTP/1.1 200 OK", 0), 0u) << head;
+    EXPECT_NE(head.find("Content-Length: " + std::to_string(FILE_SIZE)),
+              std::string::npos)
+        << head;
+    size_t total = head_end + 4 + FILE_SIZE;
+    while (data.size() < total) {
+      ssize_t n = RecvRetry(fd, buf, sizeof(buf));
+      ASSERT_GT(n, 0);
+      data.append(buf, static_cast<size_t>(n));
+    }
+    EXPECT_TRUE(data.compare(head_end + 4, FILE_SIZE, content_) == 0);
+    data.erase(0, total);
+  }
+  EXPECT_TRUE(data.empty());
+  close(fd);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, ReactorFileTest,
+                         ::testing::Values(Backend::EPOLL, Backend::URING));
+
+// 按固定规律生成响应体的生产者：每次最多写入step字节，生成stop字节后按final结束
+class PatternProducer : public ResponseBodyProducer {
+public:
+  PatternProducer(size_t stop, Status final, size_t step)
+      : stop_(stop), final_(final), step_(step) {}
+
+  Status Read(char *buffer, size_t size, size_t *written) override {
+    size_t n = std::min(std::min(size, step_), stop_ - produced_);
+    for (size_t i = 0; i < n; ++i) {
+      buffer[i] = PatternByte(produced_ + i);
+    }
+    produced_ += n;
+    *written = n;
+    return produced_ < stop_ ? BODY_MORE : final_;
+  }
+
+  static char PatternByte(size_t i) { return static_cast<char>(i * 7 % 251); }
+
+private:
+  size_t stop_;
+  Status final_;
+  size_t step_;
+  size_t produced_ = 0;
+};
+
+std::string Pattern(size_t size) {
+  std::string text(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    text[i] = PatternProducer::PatternByte(i);
+  }
+  return text;
+}
+
+// 读取直到对端关闭连接
+std::string ReadUntilClosed(int fd) {
+  std::string data;
+  char buf[65536];
+  ssize_t n;
+  while ((n = RecvRetry(fd, buf, sizeof(buf))) > 0) {
+    data.append(buf, static_cast<size_t>(n));
+  }
+  return data;
+}
+
+// 响应体由生产者流式生成，按请求路径选择生产者的行为
+class ReactorStreamTest : public ReactorTest {
+protected:
+  static constexpr size_t BODY_SIZE = 300 * 1000;
+
+  void Handle(const std::shared_ptr<Connection> &conn,
+              HttpRequest &request) override {
+    HttpResponse response(&conn->Arena());
+    response.SetStatusCode(200);
+    std::string_view path = request.GetPath();
+    if (path == "/stream") {
+      // 长度未知：HTTP/1.1使用chunked编码，HTTP/1.0以关闭连接结束
+      response.SetBodyProducer(std::make_shared<PatternProducer>(
+          BODY_SIZE, ResponseBodyProducer::BODY_END, 1000));
+    } else if (path == "/short") {
+      // 声明的长度比实际生成的多
+      response.SetBodyProducer(
+          std::make_shared<PatternProducer>(
+              BODY_SIZE / 2, ResponseBodyProducer::BODY_END, 1000),
+          BODY_SIZE);
+    } else if (path == "/error") {
+      response.SetBodyProducer(
+          std::make_shared<PatternProducer>(
+              BODY_SIZE / 3, ResponseBodyProducer::BODY_ERROR, 1000),
+          BODY_SIZE);
+    } else {
+      response.SetBody("ok");
+    }
+    conn->SendResponse(response);
+  }
+
+  // 发送请求，读到响应头结束为止，返回响应头，剩余数据留在data中
+  static std::string ReadHead(int fd, std::string *data) {
+    char buf[65536];
+    size_t head_end;
+    while ((head_end = data->find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = RecvRetry(fd, buf, sizeof(buf));
+      if (n <= 0) {
+        return std::string();
+      }
+      data->append(buf, static_cast<size_t>(n));
+    }
+    std::string head = data->substr(0, head_end + 4);
+    data->erase(0, head_end + 4);
+    return head;
+  }
+
+  // 解码chunked编码的响应体，遇到最后一个chunk时返回true，剩余数据留在data中
+  static bool ReadChunked(int fd, std::string *data, std::string *body) {
+    char buf[65536];
+    while (true) {
+      size_t line_end;
+      while ((line_end = data->find("\r\n")) == std::string::npos) {
+        ssize_t n = RecvRetry(fd, buf, sizeof(buf));
+        if (n <= 0) {
+          return false;
+        }
+        data->append(buf, static_cast<size_t>(n));
+      }
+      size_t size = std::stoul(data->substr(0, line_end), nullptr, 16);
+      size_t total = line_end + 2 + size + 2;
+      while (data->size() < total) {
+        ssize_t n = RecvRetry(fd, buf, sizeof(buf));
+        if (n <= 0) {
+          return false;
+        }
+        data->append(buf, static_cast<size_t>(n));
+      }
+      EXPECT_EQ(data->compare(line_end + 2 + size, 2, "\r\n"), 0);
+      body->append(*data, line_end + 2, size);
+      data->erase(0, total);
+      if (size == 0) {
+        return true;
+      }
+    }
+  }
+
+  static void Send(int fd, const std::string &text) {
+    ASSERT_EQ(send(fd, text.data(), text.size(), 0),
+              static_cast<ssize_t>(text.size()));
+  }
+};
+
+TEST_P(ReactorStreamTest, UnknownLengthUsesChunkedEncoding) {
+  int fd = ConnectLoopback(port_);
+  ASSERT_GE(fd, 0);
+  // 第二个请求排在流式响应之后，流式响应写完之前不能处理
+  Send(fd, "GET /stream HTTP/1.1\r\nHost: a\r\n\r\n"
+           "GET /small HTTP/1.1\r\nHost: a\r\n\r\n");
+  std::string data;
+  std::string head = ReadHead(fd, &data);
+  EXPECT_EQ(head.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << head;
+  EXPECT_NE(head.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+  EXPECT_EQ(head.find("Content-Length"), std::string::npos);
+  std::string body;
+  ASSERT_TRUE(ReadChunked(fd, &data, &body));
+  EXPECT_TRUE(body == Pattern(BODY_SIZE));
+  // 最后一个chunk之后不带trailer，紧接着是下一个响应
+  head = ReadHead(fd, &data);
+  EXPECT_EQ(head.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << head;
+  EXPECT_NE(head.find("Content-Length: 2\r\n"), std::string::npos);
+  close(fd);
+}
+
+TEST_P(ReactorStreamTest, Http10BodyEndsAtClose) {
+  int fd = ConnectLoopback(port_);
+  ASSERT_GE(fd, 0);
+  Send(fd, "GET /stream HTTP/1.0\r\n\r\n");
+  std::string data = ReadUntilClosed(fd);
+  size_t head_end = data.find("\r\n\r\n");
+  ASSERT_NE(head_end, std::string::npos);
+  std::string head = data.substr(0, head_end + 4);
+  EXPECT_EQ(head.find("Transfer-Encoding"), std::string::npos) << head;
+  EXPECT_EQ(head.find("Content-Length"), std::string::npos) << head;
+  EXPECT_TRUE(data.compare(head_end + 4, std::string::npos,
+                           Pattern(BODY_SIZE)) == 0);
+  close(fd);
+}
+
+TEST_P(ReactorStreamTest, ShortKnownLengthBodyClosesConnection) {
+  for (const char *path : {"/short", "/error"}) {
+    int fd = ConnectLoopback(port_);
+    ASSERT_GE(fd, 0);
+    // 后续请求不会得到响应：响应体不完整，连接在已生成的部分发送完后关闭
+    Send(fd, std::string("GET ") + path + " HTTP/1.1\r\nHost: a\r\n\r\n" +
+                 "GET /small HTTP/1.1\r\nHost: a\r\n\r\n");
+    std::string data = ReadUntilClosed(fd);
+    size_t head_end = data.find("\r\n\r\n");
+    ASSERT_NE(head_end, std::string::npos) << path;
+    EXPECT_NE(data.find("Content-Length: " + std::to_string(BODY_SIZE)),
+              std::string::npos);
+    size_t produced = path == std::string("/short") ? BODY_SIZE / 2
+                                                    : BODY_SIZE / 3;
+    EXPECT_EQ(data.size() - head_end - 4, produced) << path;
+    EXPECT_TRUE(data.compare(head_end + 4, std::string::npos,
+                             Pattern(produced)) == 0)
+        << path;
+    close(fd);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, ReactorStreamTest,
+                         ::testing::Values(Backend::EPOLL, Backend::URING));
+
+// 在事件循环线程调用时记录是否与loop相同的线程，写出固定的响应体
+class ThreadCheckProducer : public ResponseBodyProducer {
+public:
+  ThreadCheckProducer(std::thread::id loop, std::atomic<int> *in_loop)
+      : loop_(loop), in_loop_(in_loop) {}
+
+  Status Read(char *buffer, size_t size, size_t *written) override {
+    in_loop_->store(std::this_thread::get_id() == loop_ ? 1 : 2);
+    *written = std::min(size, sizeof(BODY) - 1);
+    memcpy(buffer, BODY, *written);
+    return BODY_END;
+  }
+
+  static constexpr char BODY[] = "async";
+
+private:
+  std::thread::id loop_;
+  std::atomic<int> *in_loop_;
+};
+
+// 按请求路径选择异步处理函数的行为，其他路径同步回复"ok"
+class ReactorAsyncTest : public ReactorTest {
+protected:
+  void Handle(const std::shared_ptr<Connection> &conn,
+              HttpRequest &request) override {
+    std::string_view path = request.GetPath();
+    if (path == "/sync") {
+      ReactorTest::Handle(conn, request);
+      return;
+    }
+    std::thread::id loop = std::this_thread::get_id();
+    try {
+      AsyncCompletion::Start(
+          conn, request,
+          [this, loop](const HttpRequest &req, Router::ResponseCallback done) {
+            Dispatch(req.GetPath(), loop, std::move(done));
+          });
+    } catch (const std::runtime_error &) {
+      ++thrown_;
+    }
+  }
+
+  void Dispatch(std::string_view path, std::thread::id loop,
+                Router::ResponseCallback done) {
+    if (path == "/twice") {
+      // 同步完成两次，第二次无效
+      Reply(done, "first");
+      Reply(done, "second");
+    } else if (path == "/thread") {
+      // 在其他线程完成，响应体在事件循环线程生成
+      Spawn([this, loop, done]() {
+        HttpResponse response;
+        response.SetStatusCode(200);
+        response.SetBodyProducer(
+            std::make_shared<ThreadCheckProducer>(loop, &produced_in_loop_),
+            sizeof(ThreadCheckProducer::BODY) - 1);
+        done(response);
+        Reply(done, "late");
+      });
+    } else if (path == "/slow") {
+      Spawn([this, done]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        Reply(done, "slow");
+      });
+    } else if (path == "/throw") {
+      throw std::runtime_error("handler failed");
+    }
+    // 其他路径（"/drop"）丢弃回调而不调用
+  }
+
+  static void Reply(const Router::ResponseCallback &done,
+                    const std::string &body) {
+    HttpResponse response;
+    response.SetStatusCode(200);
+    response.SetBody(body);
+    done(response);
+  }
+
+  void Spawn(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    workers_.emplace_back(std::move(task));
+  }
+
+  // 完成回调持有连接，工作线程结束之后才能停止事件循环
+  void TearDown() override {
+    std::vector<std::thread> workers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      workers.swap(workers_);
+    }
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+    ReactorTest::TearDown();
+  }
+
+  // 发送请求，读取count个响应
+  std::string Exchange(const std::string &requests, size_t count) {
+    int fd = ConnectLoopback(port_);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(send(fd, requests.data(), requests.size(), 0),
+              static_cast<ssize_t>(requests.size()));
+    std::string data = ReadResponses(fd, count);
+    close(fd);
+    return data;
+  }
+
+  std::mutex mutex_;
+  std::vector<std::thread> workers_;
+  std::atomic<int> produced_in_loop_{0}; // 0：未生成，1：在事件循环线程生成，2：在其他线程生成
+  std::atomic<int> thrown_{0};
+};
+
+TEST_P(ReactorAsyncTest, OnlyFirstCompletionCounts) {
+  std::string data = Exchange("GET /twice HTTP/1.1\r\nHost: a\r\n\r\n"
+                              "GET /sync HTTP/1.1\r\nHost: a\r\n\r\n",
+                              2);
+  EXPECT_EQ(CountOf(data, "HTTP/1.1 "), 2u) << data;
+  size_t first = data.find("\r\n\r\nfirst");
+  size_t ok = data.find("\r\n\r\nok");
+  ASSERT_NE(first, std::string::npos) << data;
+  ASSERT_NE(ok, std::string::npos) << data;
+  EXPECT_LT(first, ok);
+  EXPECT_EQ(data.find("second"), std::string::npos);
+}
+
+TEST_P(ReactorAsyncTest, CompletionIsSentFromLoopThread) {
+  std::string data = Exchange("GET /thread HTTP/1.1\r\nHost: a\r\n\r\n"
+                              "GET /sync HTTP/1.1\r\nHost: a\r\n\r\n",
+                              2);
+  EXPECT_EQ(CountOf(data, "HTTP/1.1 200 OK"), 2u) << data;
+  EXPECT_NE(data.find("\r\n\r\nasync"), std::string::npos) << data;
+  EXPECT_EQ(data.find("late"), std::string::npos);
+  EXPECT_EQ(produced_in_loop_.load(), 1);
+}
+
+TEST_P(ReactorAsyncTest, DroppedOrThrowingHandlerGets500) {
+  for (const char *path : {"/drop", "/throw"}) {
+    std::string data =
+        Exchange(std::string("GET ") + path + " HTTP/1.1\r\nHost: a\r\n\r\n" +
+                     "GET /sync HTTP/1.1\r\nHost: a\r\n\r\n",
+                 2);
+    EXPECT_EQ(data.rfind("HTTP/1.1 500 Internal Server Error\r\n", 0), 0u)
+        << path << "\n"
+        << data;
+    // 连接没有卡在等待响应的状态，后续请求照常处理
+    EXPECT_NE(data.find("\r\n\r\nok"), std::string::npos) << path;
+  }
+  EXPECT_EQ(thrown_.load(), 1);
+}
+
+TEST_P(ReactorAsyncTest, PipelinedRequestsWaitForPendingResponse) {
+  std::string data = Exchange("GET /slow HTTP/1.1\r\nHost: a\r\n\r\n"
+                              "GET /sync HTTP/1.1\r\nHost: a\r\n\r\n"
+                              "GET /twice HTTP/1.1\r\nHost: a\r\n\r\n"
+                              "GET /sync HTTP/1.1\r\nHost: a\r\n\r\n",
+                              4);
+  EXPECT_EQ(CountOf(data, "HTTP/1.1 200 OK"), 4u) << data;
+  size_t slow = data.find("\r\n\r\nslow");
+  size_t ok = data.find("\r\n\r\nok");
+  size_t first = data.find("\r\n\r\nfirst");
+  size_t last_ok = data.rfind("\r\n\r\nok");
+  ASSERT_NE(slow, std::string::npos) << data;
+  EXPECT_LT(slow, ok);
+  EXPECT_LT(ok, first);
+  EXPECT_LT(first, last_ok);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, ReactorAsyncTest,
+                         ::testing::Values(Backend::EPOLL, Backend::URING));
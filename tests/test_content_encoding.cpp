@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "content_encoding.h"
+
+namespace {
+
+constexpr EncodingMask IDENTITY = 1u << ENCODING_IDENTITY;
+constexpr EncodingMask GZIP = 1u << ENCODING_GZIP;
+constexpr EncodingMask BR = 1u << ENCODING_BR;
+
+} // namespace
+
+TEST(ParseAcceptEncodingTest, IdentityIsAlwaysAccepted) {
+  EXPECT_EQ(ParseAcceptEncoding(""), IDENTITY);
+  EXPECT_EQ(ParseAcceptEncoding("identity;q=0"), IDENTITY);
+  EXPECT_EQ(ParseAcceptEncoding("deflate, compress"), IDENTITY);
+}
+
+TEST(ParseAcceptEncodingTest, ListedCodings) {
+  EXPECT_EQ(ParseAcceptEncoding("gzip"), IDENTITY | GZIP);
+  EXPECT_EQ(ParseAcceptEncoding("gzip, deflate, br"), IDENTITY | GZIP | BR);
+  EXPECT_EQ(ParseAcceptEncoding("x-gzip"), IDENTITY | GZIP);
+}
+
+TEST(ParseAcceptEncodingTest, ZeroQualityRejectsCoding) {
+  EXPECT_EQ(ParseAcceptEncoding("gzip;q=0, br"), IDENTITY | BR);
+  EXPECT_EQ(ParseAcceptEncoding("gzip;q=0.000"), IDENTITY);
+  EXPECT_EQ(ParseAcceptEncoding("gzip;q=0.001"), IDENTITY | GZIP);
+  EXPECT_EQ(ParseAcceptEncoding("br;q=1.0, gzip;q=0.5"), IDENTITY | GZIP | BR);
+}
+
+TEST(ParseAcceptEncodingTest, WildcardCoversUnlistedCodings) {
+  EXPECT_EQ(ParseAcceptEncoding("*"), IDENTITY | GZIP | BR);
+  // 明确列出的编码以自身的q值为准，不被*覆盖
+  EXPECT_EQ(ParseAcceptEncoding("br;q=0, *"), IDENTITY | GZIP);
+  EXPECT_EQ(ParseAcceptEncoding("*, x-gzip;q=0"), IDENTITY | BR);
+  EXPECT_EQ(ParseAcceptEncoding("gzip, *;q=0"), IDENTITY | GZIP);
+}
+
+TEST(ParseAcceptEncodingTest, IgnoresWhitespaceAndCase) {
+  EXPECT_EQ(ParseAcceptEncoding(" GZip ;q=1 ,\tBR\t"), IDENTITY | GZIP | BR);
+  EXPECT_EQ(ParseAcceptEncoding("X-GZIP ; q=0"), IDENTITY);
+  EXPECT_EQ(ParseAcceptEncoding(",, br ,"), IDENTITY | BR);
+}
@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+#include "form_data.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr char BOUNDARY[] = "XyZ";
+
+// 含有前言、结尾、带";"的引号参数，以及与分隔符"\r\n--XyZ"几乎相同的文件内容
+const std::string FILE_CONTENT =
+    "line1\r\n--XyY\r\n--Xy\r\n-\r\r\n--X a--XyZb\r\n--xyz\r";
+const std::string MULTIPART_BODY =
+    "preamble --XyZ not at line start\r\n"
+    "--XyZ\r\n"
+    "Content-Disposition: form-data; name=\"title\"\r\n"
+    "\r\n"
+    "hello world\r\n"
+    "--XyZ\r\n"
+    "Content-Disposition: form-data; name=\"a;b\"; filename=\"x;y.txt\"\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n" +
+    FILE_CONTENT +
+    "\r\n--XyZ\r\n"
+    "Content-Disposition: form-data; name=empty\r\n"
+    "\r\n"
+    "\r\n--XyZ--\r\n"
+    "epilogue\r\n--XyZ\r\n";
+
+std::string ReadFile(std::string_view path) {
+  std::ifstream file{std::string(path), std::ios::binary};
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+// 把字段格式化为"名称|文件名|内容类型|值"，文件字段的值为临时文件的内容
+std::string Describe(const FormField &field) {
+  std::string value(field.value_);
+  if (!field.file_path_.empty()) {
+    value = ReadFile(field.file_path_);
+    EXPECT_EQ(field.file_size_, value.size());
+  }
+  return std::string(field.name_) + "|" + std::string(field.filename_) + "|" +
+         std::string(field.content_type_) + "|" + value;
+}
+
+std::vector<std::string> DescribeAll(const FormData &form) {
+  std::vector<std::string> fields;
+  for (size_t i = 0; i < form.Size(); ++i) {
+    fields.push_back(Describe(form.Field(i)));
+  }
+  return fields;
+}
+
+const std::vector<std::string> EXPECTED_FIELDS = {
+    "title|||hello world", "a;b|x;y.txt|text/plain|" + FILE_CONTENT, "empty|||"};
+
+// MultipartReader的处理结果
+struct Outcome {
+  bool handled_ = false;            // 是否调用了处理函数
+  int status_ = 0;                  // 响应状态码，处理函数不设置时为0
+  std::vector<std::string> fields_; // 处理函数看到的字段
+
+  bool operator==(const Outcome &other) const {
+    return handled_ == other.handled_ && status_ == other.status_ &&
+           fields_ == other.fields_;
+  }
+};
+
+class MultipartReaderTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    char path[] = "/tmp/test_form_data-XXXXXX";
+    ASSERT_NE(mkdtemp(path), nullptr);
+    upload_path_ = path;
+  }
+
+  // 临时文件都已删除时目录为空，rmdir才能成功
+  void TearDown() override { EXPECT_EQ(rmdir(upload_path_.c_str()), 0); }
+
+  // 把body按cuts中的位置切分后依次交给解析器，然后结束请求
+  Outcome Run(const std::string &body, const std::vector<size_t> &cuts = {},
+              size_t max_upload_size = DEFAULT_MAX_UPLOAD_SIZE) {
+    Outcome outcome;
+    MultipartReader reader(
+        BOUNDARY, upload_path_,
+        [&outcome](const HttpRequest &, const FormData &form, HttpResponse &) {
+          outcome.handled_ = true;
+          outcome.fields_ = DescribeAll(form);
+        },
+        max_upload_size);
+    size_t begin = 0;
+    std::vector<size_t> ends = cuts;
+    ends.push_back(body.size());
+    for (size_t end : ends) {
+      if (end > begin &&
+          !reader.OnBody(std::string_view(body).substr(begin, end - begin))) {
+        break;
+      }
+      begin = std::max(begin, end);
+    }
+    HttpRequest request;
+    HttpResponse response;
+    reader.OnComplete(request, response);
+    outcome.status_ = response.GetStatusCode();
+    return outcome;
+  }
+
+  std::string upload_path_;
+};
+
+std::string Part(std::string_view disposition, const std::string &value) {
+  return "--XyZ\r\nContent-Disposition: form-data; " + std::string(disposition) +
+         "\r\n\r\n" + value + "\r\n";
+}
+
+} // namespace
+
+TEST(FormDataTest, UrlEncodedDecodesPlusAndPercent) {
+  const std::string body = "a=1+2&b=%41%2f%3D&&c&d=&plain=text&x%20y=z";
+  FormData form;
+  ASSERT_TRUE(form.ParseUrlEncoded(body));
+  ASSERT_EQ(form.Size(), 6u); // 空的"&&"之间没有字段
+  EXPECT_EQ(form.Get("a"), "1 2");
+  EXPECT_EQ(form.Get("b"), "A/=");
+  ASSERT_NE(form.Find("c"), nullptr); // 没有"="的字段值为空
+  EXPECT_EQ(form.Get("c"), "");
+  ASSERT_NE(form.Find("d"), nullptr);
+  EXPECT_EQ(form.Get("d"), "");
+  EXPECT_EQ(form.Get("x y"), "z");
+  EXPECT_EQ(form.Find("missing"), nullptr);
+  // 不需要解码的值直接指向请求体
+  std::string_view plain = form.Get("plain");
+  EXPECT_EQ(plain, "text");
+  EXPECT_EQ(plain.data(), body.data() + body.find("text"));
+  EXPECT_EQ(form.Field(0).name_, "a");
+  EXPECT_EQ(form.Field(5).name_, "x y");
+}
+
+TEST(FormDataTest, UrlEncodedRejectsBadPercentEscapes) {
+  for (const char *body : {"a=%4", "a=%", "a=%zz", "a=%4g", "%zz=1", "a=1&b=%"}) {
+    FormData form;
+    EXPECT_FALSE(form.ParseUrlEncoded(body)) << body;
+  }
+  FormData form;
+  EXPECT_TRUE(form.ParseUrlEncoded("a=%41"));
+  EXPECT_EQ(form.Get("a"), "A");
+}
+
+TEST(FormDataTest, MultipartSkipsPreambleAndEpilogue) {
+  FormData form;
+  ASSERT_TRUE(form.ParseMultipart(MULTIPART_BODY, BOUNDARY));
+  EXPECT_EQ(DescribeAll(form), EXPECTED_FIELDS);
+  const FormField *file = form.Find("a;b");
+  ASSERT_NE(file, nullptr);
+  EXPECT_TRUE(file->is_file_);
+  EXPECT_FALSE(form.Find("title")->is_file_);
+  // 请求体以分隔符开头、没有前言
+  const std::string body = Part("name=x", "1") + "--XyZ--";
+  FormData direct;
+  ASSERT_TRUE(direct.ParseMultipart(body, BOUNDARY));
+  EXPECT_EQ(direct.Get("x"), "1");
+}
+
+TEST(FormDataTest, MultipartRejectsMalformedBodies) {
+  const std::string part = Part("name=x", "1");
+  const std::vector<std::string> bodies = {
+      part,                                        // 缺少结束分隔符
+      part.substr(0, part.size() - 2),             // 内容未结束
+      "--XyZ\r\nContent-Disposition: form-data; name=x\r\n", // 头部未结束
+      "no delimiter at all",
+      part + "--XyZ?\r\n",                         // 分隔符后既不是CRLF也不是"--"
+      "--XyZ\r\nContent-Disposition: attachment; name=x\r\n\r\n1\r\n--XyZ--",
+      "--XyZ\r\nContent-Disposition: form-data\r\n\r\n1\r\n--XyZ--",
+      "--XyZ\r\nbad header\r\n\r\n1\r\n--XyZ--",
+  };
+  for (const std::string &body : bodies) {
+    FormData form;
+    EXPECT_FALSE(form.ParseMultipart(body, BOUNDARY)) << body;
+  }
+}
+
+TEST(FormDataTest, MultipartBoundaryFromContentType) {
+  EXPECT_EQ(MultipartBoundary("multipart/form-data; boundary=abc"), "abc");
+  EXPECT_EQ(MultipartBoundary("Multipart/Form-Data; charset=utf-8; "
+                              "boundary=\"a;b c\""),
+            "a;b c");
+  EXPECT_EQ(MultipartBoundary("multipart/form-data"), "");
+  EXPECT_EQ(MultipartBoundary("text/plain; boundary=abc"), "");
+  // RFC 2046限制boundary最长70字节
+  const std::string longest(70, 'b');
+  EXPECT_EQ(MultipartBoundary("multipart/form-data; boundary=" + longest),
+            longest);
+  EXPECT_EQ(MultipartBoundary("multipart/form-data; boundary=" + longest + "b"),
+            "");
+  EXPECT_TRUE(IsFormContentType("application/x-www-form-urlencoded"));
+  EXPECT_TRUE(IsFormContentType("multipart/form-data; boundary=abc"));
+  EXPECT_FALSE(IsFormContentType("application/json"));
+}
+
+TEST_F(MultipartReaderTest, ParsesWholeBody) {
+  Outcome outcome = Run(MULTIPART_BODY);
+  EXPECT_TRUE(outcome.handled_);
+  EXPECT_EQ(outcome.fields_, EXPECTED_FIELDS);
+}
+
+TEST_F(MultipartReaderTest, SplitAtEveryOffsetGivesSameResult) {
+  Outcome whole = Run(MULTIPART_BODY);
+  ASSERT_TRUE(whole.handled_);
+  for (size_t cut = 1; cut < MULTIPART_BODY.size(); ++cut) {
+    EXPECT_EQ(Run(MULTIPART_BODY, {cut}), whole) << "cut at " << cut;
+  }
+  std::vector<size_t> every_byte;
+  for (size_t cut = 1; cut < MULTIPART_BODY.size(); ++cut) {
+    every_byte.push_back(cut);
+  }
+  EXPECT_EQ(Run(MULTIPART_BODY, every_byte), whole);
+}
+
+TEST_F(MultipartReaderTest, MissingCloseDelimiterIsBadRequest) {
+  std::string truncated =
+      MULTIPART_BODY.substr(0, MULTIPART_BODY.find("--XyZ--"));
+  Outcome outcome = Run(truncated);
+  EXPECT_FALSE(outcome.handled_);
+  EXPECT_EQ(outcome.status_, 400);
+  Outcome malformed = Run(Part("name=x", "1") + "--XyZ?");
+  EXPECT_FALSE(malformed.handled_);
+  EXPECT_EQ(malformed.status_, 400);
+}
+
+TEST_F(MultipartReaderTest, OversizedFieldIsRejected) {
+  Outcome fits = Run(Part("name=x", std::string(MAX_FORM_FIELD_SIZE, 'v')) +
+                     "--XyZ--");
+  EXPECT_TRUE(fits.handled_);
+  // 超过上限的部分分多段到达
+  std::string body =
+      Part("name=x", std::string(MAX_FORM_FIELD_SIZE + 1, 'v')) + "--XyZ--";
+  Outcome outcome = Run(body, {1000, MAX_FORM_FIELD_SIZE / 2});
+  EXPECT_FALSE(outcome.handled_);
+  EXPECT_EQ(outcome.status_, 413);
+}
+
+TEST_F(MultipartReaderTest, UploadLimitIsRejected) {
+  const std::string file_part =
+      Part("name=f; filename=a.bin", std::string(6, 'f'));
+  Outcome fits = Run(file_part + file_part + "--XyZ--", {}, 12);
+  EXPECT_TRUE(fits.handled_);
+  // 上限按请求中全部文件的总长度计算，已创建的临时文件也会删除（TearDown检查）
+  Outcome outcome = Run(file_part + file_part + "--XyZ--", {}, 11);
+  EXPECT_FALSE(outcome.handled_);
+  EXPECT_EQ(outcome.status_, 413);
+}
+
+TEST_F(MultipartReaderTest, TempFilesAreUnlinkedWithReader) {
+  std::vector<std::string> files;
+  {
+    MultipartReader reader(
+        BOUNDARY, upload_path_,
+        [&files](const HttpRequest &, const FormData &form, HttpResponse &) {
+          for (size_t i = 0; i < form.Size(); ++i) {
+            files.emplace_back(form.Field(i).file_path_);
+          }
+        });
+    ASSERT_TRUE(reader.OnBody(Part("name=f; filename=a.txt", "abc") +
+                              Part("name=g; filename=b.txt", "") + "--XyZ--"));
+    HttpRequest request;
+    HttpResponse response;
+    reader.OnComplete(request, response);
+    ASSERT_EQ(files.size(), 2u);
+    // 处理函数返回后文件仍然存在，直到解析器析构
+    for (const std::string &path : files) {
+      EXPECT_EQ(access(path.c_str(), F_OK), 0) << path;
+    }
+    EXPECT_EQ(ReadFile(files[0]), "abc");
+    EXPECT_EQ(ReadFile(files[1]), "");
+  }
+  for (const std::string &path : files) {
+    EXPECT_NE(access(path.c_str(), F_OK), 0) << path;
+  }
+}
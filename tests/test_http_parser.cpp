@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include "http_parser.h"
+#include "request_arena.h"
+
+namespace {
+
+// 模拟连接的输入缓冲区：反复调用Parse，按缓存方式接收请求体，消费的字节从input中移除。
+// 流式接收时请求体片段依次追加到streamed
+HttpRequest::ParseStatus ParseBuffered(HttpParser &parser, std::string &input,
+                                       HttpRequest *request,
+                                       std::string *streamed = nullptr) {
+  while (true) {
+    size_t consumed = 0;
+    HttpRequest::ParseStatus status =
+        parser.Parse(input.data(), input.size(), request, &consumed);
+    if (streamed) {
+      streamed->append(parser.BodyData().data(), parser.BodyData().size());
+    }
+    input.erase(0, consumed);
+    if (status == HttpRequest::PARSE_HEAD_COMPLETE && streamed) {
+      parser.StartBody(true);
+      continue;
+    }
+    if (status == HttpRequest::PARSE_HEAD_COMPLETE ||
+        status == HttpRequest::PARSE_BODY_DATA) {
+      continue;
+    }
+    return status;
+  }
+}
+
+HttpRequest::ParseStatus ParseText(std::string text,
+                                   HttpRequest *request = nullptr) {
+  HttpParser parser;
+  HttpRequest local;
+  return ParseBuffered(parser, text, request ? request : &local);
+}
+
+} // namespace
+
+TEST(HttpParserTest, ParsesRequestLineAndHeaders) {
+  HttpRequest request;
+  ASSERT_EQ(ParseText("GET /index.html?x=1 HTTP/1.1\r\n"
+                      "Host: example.com\r\n"
+                      "X-Custom:  padded value \t\r\n\r\n",
+                      &request),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetMethod(), "GET");
+  EXPECT_EQ(request.GetPath(), "/index.html?x=1");
+  EXPECT_EQ(request.GetVersion(), "HTTP/1.1");
+  EXPECT_EQ(request.GetHeader("host"), "example.com");
+  EXPECT_EQ(request.GetHeader("X-Custom"), "padded value");
+  EXPECT_TRUE(request.GetBody().empty());
+}
+
+TEST(HttpParserTest, LeavesPipelinedRequestsUnconsumed) {
+  HttpParser parser;
+  std::string input = "GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\n";
+  HttpRequest request;
+  ASSERT_EQ(ParseBuffered(parser, input, &request),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetPath(), "/a");
+  ASSERT_EQ(ParseBuffered(parser, input, &request),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetPath(), "/b");
+  EXPECT_TRUE(input.empty());
+}
+
+TEST(HttpParserTest, ResumesAcrossPartialReads) {
+  std::string full = "POST /form HTTP/1.1\r\nHost: a\r\n"
+                     "Content-Length: 11\r\n\r\nhello world";
+  HttpParser parser;
+  HttpRequest request;
+  std::string input;
+  HttpRequest::ParseStatus status = HttpRequest::PARSE_INCOMPLETE;
+  for (size_t i = 0; i < full.size(); ++i) {
+    input.push_back(full[i]);
+    status = ParseBuffered(parser, input, &request);
+    if (i + 1 < full.size()) {
+      ASSERT_EQ(status, HttpRequest::PARSE_INCOMPLETE) << "at byte " << i;
+    }
+  }
+  ASSERT_EQ(status, HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetBody(), "hello world");
+  EXPECT_TRUE(input.empty());
+}
+
+TEST(HttpParserTest, FindsHeadEndAcrossScanBoundary) {
+  std::string head = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+  // 结束标记被上次扫描的边界切开时仍能找到
+  for (size_t from = 0; from <= head.size(); ++from) {
+    EXPECT_EQ(HttpParser::FindHeadEnd(head.data(), head.size(), from),
+              head.size())
+        << "from " << from;
+  }
+  EXPECT_EQ(HttpParser::FindHeadEnd(head.data(), head.size() - 1, 0), 0u);
+  // 超过一个SIMD块的长请求头
+  std::string longer = "GET / HTTP/1.1\r\nX-Pad: " + std::string(100, 'p') +
+                       "\r\n\r\n";
+  EXPECT_EQ(HttpParser::FindHeadEnd(longer.data(), longer.size(), 0),
+            longer.size());
+}
+
+TEST(HttpParserTest, RejectsMalformedHeads) {
+  // 只有LF的行
+  EXPECT_EQ(ParseText("GET / HTTP/1.1\nHost: a\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 多行折叠头
+  EXPECT_EQ(ParseText("GET / HTTP/1.1\r\nX-A: 1\r\n  2\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 名称与冒号之间有空白
+  EXPECT_EQ(ParseText("GET / HTTP/1.1\r\nHost : a\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 请求行缺少版本、版本不是HTTP
+  EXPECT_EQ(ParseText("GET /\r\n\r\n"), HttpRequest::PARSE_ERROR);
+  EXPECT_EQ(ParseText("GET / FTP/1.0\r\n\r\n"), HttpRequest::PARSE_ERROR);
+  // 请求头超过MAX_HEADER_SIZE仍未结束
+  EXPECT_EQ(ParseText("GET / HTTP/1.1\r\nX-Big: " +
+                      std::string(MAX_HEADER_SIZE, 'a')),
+            HttpRequest::PARSE_ERROR);
+}
+
+TEST(HttpParserTest, RejectsAmbiguousFraming) {
+  // Transfer-Encoding与Content-Length同时出现
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                      "Content-Length: 5\r\n\r\n0\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 多个Transfer-Encoding
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                      "Transfer-Encoding: chunked\r\n\r\n0\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 不支持的Transfer-Encoding
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n"
+                      "\r\n0\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 多个取值不同的Content-Length
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                      "Content-Length: 4\r\n\r\nabcd"),
+            HttpRequest::PARSE_ERROR);
+  // Content-Length不是纯十进制数或位数过多
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nContent-Length: +3\r\n\r\nabc"),
+            HttpRequest::PARSE_ERROR);
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nContent-Length: 1,1\r\n\r\na"),
+            HttpRequest::PARSE_ERROR);
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nContent-Length: "
+                      "18446744073709551616\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+
+  // 重复但取值相同的Content-Length可以接受
+  HttpRequest request;
+  EXPECT_EQ(ParseText("POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                      "Content-Length: 3\r\n\r\nabc",
+                      &request),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetBody(), "abc");
+}
+
+TEST(HttpParserTest, ChunkedBodyWithExtensionsAndTrailers) {
+  HttpRequest request;
+  ASSERT_EQ(ParseText("POST / HTTP/1.1\r\nTransfer-Encoding: Chunked\r\n\r\n"
+                      "A;name=value\r\n0123456789\r\n"
+                      "3 \r\nabc\r\n"
+                      "0\r\nX-Checksum: 1\r\nX-Other: 2\r\n\r\n",
+                      &request),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetBody(), "0123456789abc");
+}
+
+TEST(HttpParserTest, RejectsMalformedChunks) {
+  const std::string head =
+      "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+  // chunk数据后缺少CRLF
+  EXPECT_EQ(ParseText(head + "3\r\nabcX\r\n0\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 大小行不是十六进制、没有数字、位数过多
+  EXPECT_EQ(ParseText(head + "xyz\r\n"), HttpRequest::PARSE_ERROR);
+  EXPECT_EQ(ParseText(head + ";ext\r\n"), HttpRequest::PARSE_ERROR);
+  EXPECT_EQ(ParseText(head + "1000000000000000\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // 大小行只有LF
+  EXPECT_EQ(ParseText(head + "3\nabc\r\n0\r\n\r\n"),
+            HttpRequest::PARSE_ERROR);
+  // trailer总长度超过MAX_HEADER_SIZE
+  std::string trailers;
+  while (trailers.size() <= MAX_HEADER_SIZE) {
+    trailers += "X-Trailer: " + std::string(1000, 't') + "\r\n";
+  }
+  EXPECT_EQ(ParseText(head + "0\r\n" + trailers + "\r\n"),
+            HttpRequest::PARSE_ERROR);
+}
+
+TEST(HttpParserTest, BufferedBodyLimit) {
+  HttpParser parser;
+  parser.SetMaxBodySize(10);
+  std::string input = "POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n";
+  HttpRequest request;
+  size_t consumed = 0;
+  ASSERT_EQ(parser.Parse(input.data(), input.size(), &request, &consumed),
+            HttpRequest::PARSE_HEAD_COMPLETE);
+  // 请求体到达之前就能判断，连接据此回复413而不是100 Continue
+  EXPECT_EQ(parser.StartBody(false), HttpRequest::PARSE_TOO_LARGE);
+
+  // chunked编码的请求体在累计超过上限时拒绝
+  HttpParser chunked;
+  chunked.SetMaxBodySize(10);
+  input = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "6\r\nabcdef\r\n6\r\nghijkl\r\n0\r\n\r\n";
+  EXPECT_EQ(ParseBuffered(chunked, input, &request),
+            HttpRequest::PARSE_TOO_LARGE);
+}
+
+TEST(HttpParserTest, StreamedBodyIgnoresLimit) {
+  HttpParser parser;
+  parser.SetMaxBodySize(4);
+  std::string input = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                      "6\r\nabcdef\r\n6\r\nghijkl\r\n0\r\n\r\n";
+  HttpRequest request;
+  std::string streamed;
+  ASSERT_EQ(ParseBuffered(parser, input, &request, &streamed),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(streamed, "abcdefghijkl");
+  EXPECT_TRUE(request.GetBody().empty());
+}
+
+TEST(HttpParserTest, PartialRequestSurvivesArenaReset) {
+  RequestArena arena;
+  HttpParser parser(&arena);
+  std::string input = "POST /upload HTTP/1.1\r\nHost: a\r\n"
+                      "Content-Length: 10000\r\n\r\n" +
+                      std::string(4000, 'a');
+  HttpRequest request(&arena);
+  ASSERT_EQ(ParseBuffered(parser, input, &request),
+            HttpRequest::PARSE_INCOMPLETE);
+  ASSERT_TRUE(parser.InProgress());
+
+  // 连接写完上一个响应后复位内存池，正在接收的请求移出再移回
+  std::string partial = parser.DetachRequest();
+  arena.Reset();
+  EXPECT_EQ(arena.BytesAllocated(), 0u);
+  parser.AttachRequest(partial);
+
+  input = std::string(6000, 'b') + "GET /next HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(ParseBuffered(parser, input, &request),
+            HttpRequest::PARSE_COMPLETE);
+  EXPECT_EQ(request.GetPath(), "/upload");
+  EXPECT_EQ(request.GetHeader("Host"), "a");
+  EXPECT_EQ(request.GetBody(), std::string(4000, 'a') + std::string(6000, 'b'));
+  EXPECT_EQ(input, "GET /next HTTP/1.1\r\n\r\n");
+}
@@ -0,0 +1,234 @@
+// 解析器的变异模糊测试：随机修改合法请求，分别整体解析和按随机小片段增量解析，
+// 两种方式的结果必须一致。在ASan/UBSan下构建时同时检查越界访问。
+// 用例数和随机种子固定，失败可以复现；需要更长时间的模糊测试时可以设置环境变量
+// PARSER_FUZZ_CASES增加用例数。
+#include <gtest/gtest.h>
+#include "http_parser.h"
+#include "request_arena.h"
+#include <random>
+
+namespace {
+
+constexpr size_t DEFAULT_FUZZ_CASES = 20000; // 默认用例数
+constexpr size_t MAX_PIECE = 7;              // 增量解析时每片的最大字节数
+constexpr size_t MAX_BUFFERED_BODY = 16;     // 缓存请求体的最大长度，变异容易超过
+constexpr size_t ARENA_BLOCK = 256;          // 内存池块大小，较小的块也覆盖单独分配大块的路径
+
+// 变异的起点
+const char *const SEEDS[] = {
+    "GET /index.html HTTP/1.1\r\nHost: example.com\r\nAccept: */*\r\n\r\n",
+    "POST /login HTTP/1.1\r\nHost: a\r\nContent-Length: 11\r\n\r\n"
+    "user=a&pw=b",
+    "GET /a HTTP/1.1\r\n\r\nGET /b?x=1 HTTP/1.1\r\nX-Pad: value\r\n\r\n",
+    "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n",
+    "POST /up HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+    "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nX-Sum: 1\r\n\r\n",
+};
+
+// 插入或替换时使用的字节，偏向分隔符
+const char ALPHABET[] = "\r\n: \t/;,=0123456789aAzZ-\x00\x7f\xff";
+
+// 一个解析结果，只比较可观察的字段
+struct Outcome {
+  HttpRequest::ParseStatus status_;
+  std::string fields_; // 请求行、请求头和请求体拼接成的文本
+
+  bool operator==(const Outcome &other) const {
+    return status_ == other.status_ && fields_ == other.fields_;
+  }
+};
+
+std::string Describe(const HttpRequest &request) {
+  std::string text;
+  text.append(request.GetMethod()).append(" ");
+  text.append(request.GetPath()).append(" ");
+  text.append(request.GetVersion()).append("\n");
+  for (size_t i = 0; i < request.HeaderCount(); ++i) {
+    text.append(request.HeaderName(i)).append(": ");
+    text.append(request.HeaderValue(i)).append("\n");
+  }
+  text.append("\n").append(request.GetBody());
+  return text;
+}
+
+// 一次解析过程：解析器、未消费的输入和流式接收到的请求体
+struct Session {
+  explicit Session(bool stream)
+      : arena_(ARENA_BLOCK), parser_(&arena_), stream_(stream) {
+    parser_.SetMaxBodySize(MAX_BUFFERED_BODY);
+  }
+
+  // 与连接一样在每轮处理后复位内存池，未解析完的请求先移出再移回
+  void ResetArena() {
+    if (parser_.InProgress()) {
+      std::string partial = parser_.DetachRequest();
+      arena_.Reset();
+      parser_.AttachRequest(partial);
+    } else {
+      arena_.Reset();
+    }
+  }
+
+  RequestArena arena_;
+  HttpParser parser_;
+  bool stream_;          // 是否流式接收请求体
+  std::string input_;    // 尚未消费的数据
+  std::string streamed_; // 当前请求流式接收到的请求体
+};
+
+// 解析input_中所有完整的请求，消费的字节从input_中移除；遇到数据不足或出错时停止
+void Drain(Session &session, std::vector<Outcome> *outcomes) {
+  std::string &input = session.input_;
+  while (true) {
+    HttpRequest request(&session.arena_);
+    size_t consumed = 0;
+    HttpRequest::ParseStatus status = session.parser_.Parse(
+        input.data(), input.size(), &request, &consumed);
+    if (status == HttpRequest::PARSE_HEAD_COMPLETE) {
+      HttpRequest::ParseStatus started =
+          session.parser_.StartBody(session.stream_);
+      if (started != HttpRequest::PARSE_INCOMPLETE) {
+        status = started;
+      }
+    }
+    if (status == HttpRequest::PARSE_ERROR ||
+        status == HttpRequest::PARSE_TOO_LARGE) {
+      outcomes->push_back(Outcome{status, ""});
+      return;
+    }
+    EXPECT_LE(consumed, input.size());
+    // 请求体片段指向输入，移除之前先取出
+    std::string_view body = session.parser_.BodyData();
+    session.streamed_.append(body.data(), body.size());
+    // 接收请求体时数据不足也可能消费了一部分请求体
+    input.erase(0, consumed);
+    if (status == HttpRequest::PARSE_INCOMPLETE) {
+      return;
+    }
+    EXPECT_GT(consumed, 0u);
+    if (status == HttpRequest::PARSE_COMPLETE) {
+      outcomes->push_back(
+          Outcome{status, Describe(request) + session.streamed_});
+      session.streamed_.clear();
+    }
+  }
+}
+
+// 一次性解析全部数据
+std::vector<Outcome> ParseWhole(const std::string &data, bool stream) {
+  Session session(stream);
+  session.input_ = data;
+  std::vector<Outcome> outcomes;
+  Drain(session, &outcomes);
+  session.ResetArena();
+  return outcomes;
+}
+
+// 按给定的切分点增量到达，每次到达后解析
+std::vector<Outcome> ParsePieces(const std::string &data,
+                                 const std::vector<size_t> &cuts,
+                                 bool stream) {
+  Session session(stream);
+  std::vector<Outcome> outcomes;
+  size_t begin = 0;
+  for (size_t i = 0; i <= cuts.size(); ++i) {
+    size_t end = i < cuts.size() ? cuts[i] : data.size();
+    session.input_.append(data, begin, end - begin);
+    begin = end;
+    Drain(session, &outcomes);
+    session.ResetArena();
+    if (!outcomes.empty() &&
+        outcomes.back().status_ != HttpRequest::PARSE_COMPLETE) {
+      break;
+    }
+  }
+  return outcomes;
+}
+
+std::string Mutate(std::string data, std::mt19937 &rng) {
+  auto pick = [&rng](size_t n) {
+    return std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+  };
+  size_t mutations = 1 + pick(4);
+  for (size_t m = 0; m < mutations && !data.empty(); ++m) {
+    size_t pos = pick(data.size());
+    char c = ALPHABET[pick(sizeof(ALPHABET) - 1)];
+    switch (pick(5)) {
+    case 0: // 替换一个字节
+      data[pos] = c;
+      break;
+    case 1: // 插入一个字节
+      data.insert(data.begin() + pos, c);
+      break;
+    case 2: // 删除一个字节
+      data.erase(pos, 1);
+      break;
+    case 3: // 重复一段
+      data.insert(pos, data.substr(pick(data.size()), 1 + pick(16)));
+      break;
+    default: // 截断
+      data.resize(pos);
+      break;
+    }
+  }
+  return data;
+}
+
+size_t FuzzCases() {
+  const char *env = getenv("PARSER_FUZZ_CASES");
+  return env ? std::stoul(env) : DEFAULT_FUZZ_CASES;
+}
+
+} // namespace
+
+// 合法请求在任意位置切成两段到达，结果与一次性到达相同
+TEST(HttpParserFuzzTest, SplitAtEveryOffsetMatchesWholeParse) {
+  for (bool stream : {false, true}) {
+    for (const char *seed : SEEDS) {
+      std::string data = seed;
+      std::vector<Outcome> whole = ParseWhole(data, stream);
+      ASSERT_FALSE(whole.empty());
+      for (size_t cut = 0; cut <= data.size(); ++cut) {
+        EXPECT_TRUE(ParsePieces(data, {cut}, stream) == whole)
+            << "seed " << seed << " cut at " << cut << " stream " << stream;
+      }
+      // 逐字节到达
+      std::vector<size_t> every_byte;
+      for (size_t i = 1; i < data.size(); ++i) {
+        every_byte.push_back(i);
+      }
+      EXPECT_TRUE(ParsePieces(data, every_byte, stream) == whole)
+          << seed << " stream " << stream;
+    }
+  }
+}
+
+// 变异后的请求按1到MAX_PIECE字节的随机片段到达，缓存和流式接收请求体时结果都与一次性到达相同
+TEST(HttpParserFuzzTest, MutatedInputParsesSameWholeAndInPieces) {
+  std::mt19937 rng(20240611);
+  const size_t cases = FuzzCases();
+  size_t completed = 0;
+  for (size_t i = 0; i < cases; ++i) {
+    std::string data = Mutate(SEEDS[i % (sizeof(SEEDS) / sizeof(SEEDS[0]))],
+                              rng);
+    std::vector<size_t> cuts;
+    for (size_t pos = 0;;) {
+      pos += 1 + std::uniform_int_distribution<size_t>(0, MAX_PIECE - 1)(rng);
+      if (pos >= data.size()) {
+        break;
+      }
+      cuts.push_back(pos);
+    }
+    for (bool stream : {false, true}) {
+      std::vector<Outcome> whole = ParseWhole(data, stream);
+      ASSERT_TRUE(ParsePieces(data, cuts, stream) == whole)
+          << "case " << i << " stream " << stream << ": "
+          << testing::PrintToString(data);
+      if (!whole.empty() && whole[0].status_ == HttpRequest::PARSE_COMPLETE) {
+        ++completed;
+      }
+    }
+  }
+  // 变异不能全部破坏请求，否则只测到了出错路径
+  EXPECT_GT(completed, cases / 5);
+}
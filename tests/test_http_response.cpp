@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "http_conn.h"
+
+namespace {
+
+constexpr char FIXED_DATE[] = "Sun, 06 Nov 1994 08:49:37 GMT";
+
+// 固定Date响应头，使输出可以逐字节比较
+HttpResponse MakeResponse() {
+  HttpResponse response;
+  response.SetHeader("Date", FIXED_DATE);
+  return response;
+}
+
+// 记录每次分配的字节数，分配本身交给默认资源
+class RecordingResource : public std::pmr::memory_resource {
+public:
+  std::vector<size_t> sizes_;
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    sizes_.push_back(bytes);
+    return std::pmr::get_default_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+    std::pmr::get_default_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+// 构造响应头时先计算准确长度再一次写入：从内存池构造时只分配一次，分配的长度与写入的长度相同，
+// 内容与std::string版本逐字节一致
+std::string CheckedHeaders(const HttpResponse &response) {
+  std::string headers = response.BuildHeaders();
+  RecordingResource resource;
+  std::string_view built = response.BuildHeaders(&resource);
+  EXPECT_EQ(built, headers);
+  EXPECT_EQ(resource.sizes_, std::vector<size_t>{headers.size()}) << headers;
+  resource.deallocate(const_cast<char *>(built.data()), built.size(), 1);
+  return headers;
+}
+
+} // namespace
+
+TEST(HttpResponseTest, KnownStatusUsesReasonPhrase) {
+  HttpResponse response = MakeResponse();
+  response.SetStatusCode(404);
+  EXPECT_EQ(CheckedHeaders(response),
+            std::string("HTTP/1.1 404 Not Found\r\nDate: ") + FIXED_DATE +
+                "\r\nContent-Length: 0\r\n\r\n");
+  response.SetStatusCode("200 OK");
+  EXPECT_EQ(CheckedHeaders(response).rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+}
+
+TEST(HttpResponseTest, UnknownStatusKeepsSpaceBeforeEmptyReason) {
+  HttpResponse response = MakeResponse();
+  response.SetStatusCode(299);
+  EXPECT_EQ(CheckedHeaders(response),
+            std::string("HTTP/1.1 299 \r\nDate: ") + FIXED_DATE +
+                "\r\nContent-Length: 0\r\n\r\n");
+  response.SetStatusCode("299");
+  EXPECT_EQ(CheckedHeaders(response).rfind("HTTP/1.1 299 \r\n", 0), 0u);
+  response.SetStatusCode("299 Custom Reason");
+  EXPECT_EQ(CheckedHeaders(response).rfind("HTTP/1.1 299 Custom Reason\r\n", 0),
+            0u);
+}
+
+TEST(HttpResponseTest, SerializesHeadersInOrder) {
+  HttpResponse response = MakeResponse();
+  response.SetStatusCode(200);
+  response.SetHeader("Content-Type", "text/plain");
+  response.SetHeader("X-Trace", "a");
+  response.SetHeader("x-trace", "b"); // 忽略大小写替换
+  response.SetHeader("content-type", "text/html");
+  response.SetKeepAlive(true);
+  response.SetBody("hello");
+  const std::string expected = std::string("HTTP/1.1 200 OK\r\n") +
+                               "Date: " + FIXED_DATE + "\r\n"
+                               "Content-Type: text/html\r\n"
+                               "X-Trace: b\r\n"
+                               "Content-Length: 5\r\n"
+                               "Connection: keep-alive\r\n"
+                               "\r\n";
+  EXPECT_EQ(CheckedHeaders(response), expected);
+  EXPECT_EQ(response.BuildHttpResponse(), expected + "hello");
+}
+
+TEST(HttpResponseTest, NoContentLengthWithoutBodySemantics) {
+  HttpResponse response = MakeResponse();
+  response.SetStatusCode(204);
+  EXPECT_EQ(CheckedHeaders(response),
+            std::string("HTTP/1.1 204 No Content\r\nDate: ") + FIXED_DATE +
+                "\r\n\r\n");
+  response.SetStatusCode(304);
+  EXPECT_EQ(CheckedHeaders(response).find("Content-Length"),
+            std::string::npos);
+  response.SetStatusCode(101);
+  EXPECT_EQ(CheckedHeaders(response).find("Content-Length"),
+            std::string::npos);
+}
+
+TEST(HttpResponseTest, KeepsContentLengthSetByCaller) {
+  HttpResponse response = MakeResponse();
+  response.SetStatusCode(200);
+  response.SetHeader("Content-Length", "42");
+  response.SetKeepAlive(false);
+  response.SetBody("ignored length");
+  EXPECT_EQ(CheckedHeaders(response),
+            std::string("HTTP/1.1 200 OK\r\nDate: ") + FIXED_DATE +
+                "\r\nContent-Length: 42\r\nConnection: close\r\n\r\n");
+}
+
+TEST(HttpResponseTest, AddsDateHeaderWhenMissing) {
+  HttpResponse response;
+  response.SetStatusCode(200);
+  std::string headers = CheckedHeaders(response);
+  size_t date = headers.find("\r\nDate: ");
+  ASSERT_NE(date, std::string::npos);
+  // "Date: "之后是固定29字节的IMF-fixdate
+  EXPECT_EQ(headers.compare(date + 8 + 29, 2, "\r\n"), 0);
+  EXPECT_EQ(headers.find("Date: ", date + 3), std::string::npos);
+}
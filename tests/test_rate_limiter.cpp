@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "http_parser.h"
+#include "rate_limiter.h"
+#include <cmath>
+#include <thread>
+
+namespace {
+
+constexpr double NO_REFILL = 1e-3; // 测试期间几乎不补充令牌
+
+in_addr_t Ip(uint32_t host) { return htonl(host); }
+
+// 解析只有请求行的请求并判断是否放行
+bool Allow(RateLimiter &limiter, in_addr_t ip, const std::string &method,
+           const std::string &target) {
+  std::string text = method + " " + target + " HTTP/1.1\r\nHost: t\r\n\r\n";
+  HttpParser parser;
+  HttpRequest request;
+  size_t consumed = 0;
+  HttpRequest::ParseStatus status =
+      parser.Parse(text.data(), text.size(), &request, &consumed);
+  EXPECT_TRUE(status == HttpRequest::PARSE_HEAD_COMPLETE ||
+              status == HttpRequest::PARSE_COMPLETE)
+      << text;
+  return limiter.AllowRequest(ip, request);
+}
+
+// 连续请求直到被拒绝，返回放行的个数（最多limit个）
+size_t AllowedInARow(RateLimiter &limiter, in_addr_t ip,
+                     const std::string &method, const std::string &target,
+                     size_t limit = 100) {
+  size_t allowed = 0;
+  while (allowed < limit && Allow(limiter, ip, method, target)) {
+    ++allowed;
+  }
+  return allowed;
+}
+
+} // namespace
+
+TEST(RateLimiterTest, ConnectionCapIsPerIpAndReleased) {
+  RateLimiter limiter;
+  EXPECT_FALSE(limiter.HasConnectionLimit());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(limiter.AcquireConnection(Ip(1)));
+  }
+
+  RateLimiter capped;
+  capped.SetMaxConnectionsPerIp(2);
+  EXPECT_TRUE(capped.HasConnectionLimit());
+  EXPECT_TRUE(capped.AcquireConnection(Ip(1)));
+  EXPECT_TRUE(capped.AcquireConnection(Ip(1)));
+  EXPECT_FALSE(capped.AcquireConnection(Ip(1)));
+  EXPECT_TRUE(capped.AcquireConnection(Ip(2)));
+  capped.ReleaseConnection(Ip(1));
+  EXPECT_TRUE(capped.AcquireConnection(Ip(1)));
+  EXPECT_FALSE(capped.AcquireConnection(Ip(1)));
+}
+
+TEST(RateLimiterTest, BurstIsExhaustedThenRefills) {
+  constexpr double RATE = 10;
+  RateLimiter limiter;
+  limiter.AddRule("GET", "/api", RateLimit{RATE, 3});
+  EXPECT_TRUE(limiter.HasRules());
+  EXPECT_EQ(AllowedInARow(limiter, Ip(1), "GET", "/api"), 3u);
+  // 每个IP一个令牌桶
+  EXPECT_EQ(AllowedInARow(limiter, Ip(2), "GET", "/api"), 3u);
+  // 约1/rate秒后补充一个令牌
+  std::this_thread::sleep_for(std::chrono::milliseconds(110));
+  EXPECT_TRUE(Allow(limiter, Ip(1), "GET", "/api"));
+  EXPECT_FALSE(Allow(limiter, Ip(1), "GET", "/api"));
+}
+
+TEST(RateLimiterTest, MostSpecificRuleWins) {
+  RateLimiter limiter;
+  limiter.AddRule("GET", "/api/*rest", RateLimit{NO_REFILL, 1});
+  limiter.AddRule("GET", "/api/:id", RateLimit{NO_REFILL, 2});
+  limiter.AddRule("GET", "/api/x", RateLimit{NO_REFILL, 3});
+  EXPECT_EQ(AllowedInARow(limiter, Ip(1), "GET", "/api/x"), 3u);
+  EXPECT_EQ(AllowedInARow(limiter, Ip(1), "GET", "/api/y"), 2u);
+  // /api/:id的令牌由所有匹配该规则的路径共享
+  EXPECT_FALSE(Allow(limiter, Ip(1), "GET", "/api/z"));
+  EXPECT_EQ(AllowedInARow(limiter, Ip(1), "GET", "/api/a/b"), 1u);
+  // 不匹配任何规则的路径不受限制
+  EXPECT_EQ(AllowedInARow(limiter, Ip(1), "GET", "/other", 10), 10u);
+}
+
+TEST(RateLimiterTest, QueryStringIsIgnored) {
+  RateLimiter limiter;
+  limiter.AddRule("GET", "/search", RateLimit{NO_REFILL, 2});
+  EXPECT_TRUE(Allow(limiter, Ip(1), "GET", "/search?q=1"));
+  EXPECT_TRUE(Allow(limiter, Ip(1), "GET", "/search"));
+  EXPECT_FALSE(Allow(limiter, Ip(1), "GET", "/search?q=2"));
+  EXPECT_TRUE(Allow(limiter, Ip(1), "GET", "/other?next=/search"));
+}
+
+TEST(RateLimiterTest, OtherMethodsAreAllowed) {
+  RateLimiter limiter;
+  limiter.AddRule("POST", "/login", RateLimit{NO_REFILL, 1});
+  EXPECT_EQ(AllowedInARow(limiter, Ip(1), "GET", "/login", 10), 10u);
+  EXPECT_TRUE(Allow(limiter, Ip(1), "POST", "/login"));
+  EXPECT_FALSE(Allow(limiter, Ip(1), "POST", "/login"));
+  EXPECT_TRUE(Allow(limiter, Ip(1), "HEAD", "/login"));
+}
+
+TEST(RateLimiterTest, AddRuleRejectsNonPositiveLimits) {
+  RateLimiter limiter;
+  EXPECT_THROW(limiter.AddRule("GET", "/a", RateLimit{0, 1}),
+               std::runtime_error);
+  EXPECT_THROW(limiter.AddRule("GET", "/a", RateLimit{-1, 1}),
+               std::runtime_error);
+  EXPECT_THROW(limiter.AddRule("GET", "/a", RateLimit{1, 0}),
+               std::runtime_error);
+  EXPECT_THROW(limiter.AddRule("GET", "/a", RateLimit{1, -2}),
+               std::runtime_error);
+  EXPECT_THROW(limiter.AddRule("GET", "/a", RateLimit{std::nan(""), 1}),
+               std::runtime_error);
+  EXPECT_FALSE(limiter.HasRules());
+  EXPECT_THROW(limiter.AddRule("GET", "no-slash", RateLimit{1, 1}),
+               std::runtime_error);
+}
+
+TEST(RateLimiterTest, SweepRemovesOnlyIdleClients) {
+  RateLimiter limiter;
+  limiter.SetMaxConnectionsPerIp(4);
+  limiter.AddRule("GET", "/api", RateLimit{NO_REFILL, 5});
+  EXPECT_EQ(limiter.Sweep(), 0u);
+
+  // 1：仍有连接
+  ASSERT_TRUE(limiter.AcquireConnection(Ip(1)));
+  // 2：连接已关闭，没有消耗令牌
+  ASSERT_TRUE(limiter.AcquireConnection(Ip(2)));
+  limiter.ReleaseConnection(Ip(2));
+  // 3：连接已关闭，令牌桶未补满
+  ASSERT_TRUE(limiter.AcquireConnection(Ip(3)));
+  ASSERT_TRUE(Allow(limiter, Ip(3), "GET", "/api"));
+  limiter.ReleaseConnection(Ip(3));
+
+  EXPECT_EQ(limiter.Sweep(), 1u);
+  EXPECT_EQ(limiter.Sweep(), 0u);
+  limiter.ReleaseConnection(Ip(1));
+  EXPECT_EQ(limiter.Sweep(), 1u);
+  // 3的令牌桶保留了下来，只剩4个令牌
+  EXPECT_EQ(AllowedInARow(limiter, Ip(3), "GET", "/api"), 4u);
+  EXPECT_EQ(limiter.Sweep(), 0u);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include "route_tree.h"
+
+namespace {
+
+// 查找path，没有匹配时返回SIZE_MAX
+size_t Lookup(const RouteTree &tree, std::string_view path,
+              RouteMatch *match = nullptr) {
+  RouteMatch local;
+  RouteMatch *result = match ? match : &local;
+  return tree.Find(path, result) ? result->route_ : SIZE_MAX;
+}
+
+} // namespace
+
+TEST(RouteTreeTest, StaticRoutesShareCommonPrefixes) {
+  RouteTree tree;
+  EXPECT_TRUE(tree.Empty());
+  tree.Insert("/", 0);
+  tree.Insert("/login", 1);
+  tree.Insert("/logout", 2);
+  tree.Insert("/log", 3);
+  EXPECT_FALSE(tree.Empty());
+  EXPECT_EQ(Lookup(tree, "/"), 0u);
+  EXPECT_EQ(Lookup(tree, "/login"), 1u);
+  EXPECT_EQ(Lookup(tree, "/logout"), 2u);
+  EXPECT_EQ(Lookup(tree, "/log"), 3u);
+  EXPECT_EQ(Lookup(tree, "/logi"), SIZE_MAX);
+  EXPECT_EQ(Lookup(tree, "/login/"), SIZE_MAX);
+  EXPECT_EQ(Lookup(tree, ""), SIZE_MAX);
+}
+
+TEST(RouteTreeTest, CapturesParameters) {
+  RouteTree tree;
+  tree.Insert("/users/:id", 0);
+  tree.Insert("/users/:id/posts/:post", 1);
+  RouteMatch match;
+  ASSERT_EQ(Lookup(tree, "/users/42/posts/7", &match), 1u);
+  ASSERT_EQ(match.param_count_, 2u);
+  EXPECT_EQ(match.names_[0], "id");
+  EXPECT_EQ(match.values_[0], "42");
+  EXPECT_EQ(match.names_[1], "post");
+  EXPECT_EQ(match.values_[1], "7");
+
+  match = RouteMatch();
+  ASSERT_EQ(Lookup(tree, "/users/alice", &match), 0u);
+  ASSERT_EQ(match.param_count_, 1u);
+  EXPECT_EQ(match.values_[0], "alice");
+  // 参数匹配一个非空路径段
+  EXPECT_EQ(Lookup(tree, "/users/"), SIZE_MAX);
+  EXPECT_EQ(Lookup(tree, "/users/42/posts/"), SIZE_MAX);
+}
+
+TEST(RouteTreeTest, StaticBeatsParameterBeatsWildcard) {
+  RouteTree tree;
+  tree.Insert("/files/new", 0);
+  tree.Insert("/files/:name", 1);
+  tree.Insert("/files/*rest", 2);
+  EXPECT_EQ(Lookup(tree, "/files/new"), 0u);
+  EXPECT_EQ(Lookup(tree, "/files/report"), 1u);
+  RouteMatch match;
+  ASSERT_EQ(Lookup(tree, "/files/a/b/c.txt", &match), 2u);
+  ASSERT_EQ(match.param_count_, 1u);
+  EXPECT_EQ(match.names_[0], "rest");
+  EXPECT_EQ(match.values_[0], "a/b/c.txt");
+}
+
+TEST(RouteTreeTest, BacktracksWhenHigherPriorityBranchFails) {
+  RouteTree tree;
+  tree.Insert("/a/b/d", 0);
+  tree.Insert("/a/:x/c", 1);
+  RouteMatch match;
+  // 静态分支"/a/b"匹配了前缀但没有"/c"，回溯到参数分支
+  ASSERT_EQ(Lookup(tree, "/a/b/c", &match), 1u);
+  ASSERT_EQ(match.param_count_, 1u);
+  EXPECT_EQ(match.values_[0], "b");
+  EXPECT_EQ(Lookup(tree, "/a/b/d"), 0u);
+}
+
+TEST(RouteTreeTest, WildcardMatchesEmptyRemainder) {
+  RouteTree tree;
+  tree.Insert("/static/*path", 0);
+  RouteMatch match;
+  ASSERT_EQ(Lookup(tree, "/static/", &match), 0u);
+  EXPECT_EQ(match.values_[0], "");
+  EXPECT_EQ(Lookup(tree, "/static"), SIZE_MAX);
+}
+
+TEST(RouteTreeTest, ReinsertReplacesRoute) {
+  RouteTree tree;
+  tree.Insert("/users/:id", 0);
+  tree.Insert("/users/:id", 5);
+  EXPECT_EQ(Lookup(tree, "/users/1"), 5u);
+}
+
+TEST(RouteTreeTest, RejectsInvalidPatterns) {
+  RouteTree tree;
+  EXPECT_THROW(tree.Insert("users", 0), std::runtime_error);
+  EXPECT_THROW(tree.Insert("/users/:", 0), std::runtime_error);
+  EXPECT_THROW(tree.Insert("/files/*", 0), std::runtime_error);
+  EXPECT_THROW(tree.Insert("/files/*rest/more", 0), std::runtime_error);
+  tree.Insert("/users/:id", 0);
+  EXPECT_THROW(tree.Insert("/users/:name/posts", 1), std::runtime_error);
+  std::string many;
+  for (size_t i = 0; i <= MAX_ROUTE_PARAMS; ++i) {
+    many += "/:p" + std::to_string(i);
+  }
+  EXPECT_THROW(tree.Insert(many, 2), std::runtime_error);
+}
+
+TEST(RouteTreeTest, MovedTreeKeepsRoutes) {
+  RouteTree tree;
+  tree.Insert("/a/:b", 3);
+  RouteTree moved(std::move(tree));
+  EXPECT_EQ(Lookup(moved, "/a/x"), 3u);
+  RouteTree assigned;
+  assigned = std::move(moved);
+  EXPECT_EQ(Lookup(assigned, "/a/y"), 3u);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "static_cache.h"
+#include <fstream>
+#include <thread>
+
+namespace {
+
+constexpr EncodingMask ACCEPT_GZIP = (1u << ENCODING_IDENTITY) |
+                                     (1u << ENCODING_GZIP);
+
+// 每个测试使用独立的临时目录
+class StaticCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    char pattern[] = "/tmp/static_cache_test.XXXXXX";
+    ASSERT_NE(mkdtemp(pattern), nullptr);
+    dir_ = pattern;
+  }
+
+  void TearDown() override {
+    for (const std::string &path : created_) {
+      unlink(path.c_str());
+    }
+    rmdir(dir_.c_str());
+  }
+
+  std::string Write(const std::string &name, const std::string &content) {
+    std::string path = dir_ + "/" + name;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    created_.push_back(path);
+    return path;
+  }
+
+  // inotify事件由后台线程异步处理，等待条件成立，最多2秒
+  template <typename Predicate> static bool WaitFor(Predicate predicate) {
+    for (int i = 0; i < 200; ++i) {
+      if (predicate()) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  std::string dir_;
+  std::vector<std::string> created_;
+};
+
+} // namespace
+
+TEST_F(StaticCacheTest, ServesFromMemoryUntilModified) {
+  StaticCache cache;
+  std::string path = Write("page.bin", "version one");
+  std::shared_ptr<const StaticAsset> first = cache.Get(path, ACCEPT_GZIP);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(*first->representations_[ENCODING_IDENTITY].body_, "version one");
+  EXPECT_EQ(cache.Get(path, ACCEPT_GZIP), first);
+  EXPECT_EQ(cache.CachedBytes(), 11u);
+
+  Write("page.bin", "version two!");
+  ASSERT_TRUE(WaitFor([&]() { return cache.Get(path, ACCEPT_GZIP) != first; }));
+  const StaticRepresentation &second =
+      cache.Get(path, ACCEPT_GZIP)->representations_[ENCODING_IDENTITY];
+  EXPECT_EQ(*second.body_, "version two!");
+  EXPECT_NE(second.etag_, first->representations_[ENCODING_IDENTITY].etag_);
+}
+
+TEST_F(StaticCacheTest, PicksUpPrecompressedFileCreatedLater) {
+  StaticCache cache;
+  std::string path = Write("data.bin", std::string(4096, 'd'));
+  std::shared_ptr<const StaticAsset> first = cache.Get(path, ACCEPT_GZIP);
+  ASSERT_TRUE(first);
+  EXPECT_FALSE(first->Has(ENCODING_GZIP));
+
+  // 预压缩文件在加载之后才生成，由目录监视发现
+  Write("data.bin.gz", "pretend gzip");
+  ASSERT_TRUE(WaitFor(
+      [&]() { return cache.Get(path, ACCEPT_GZIP)->Has(ENCODING_GZIP); }));
+  EXPECT_EQ(*cache.Get(path, ACCEPT_GZIP)->Select(ACCEPT_GZIP).body_,
+            "pretend gzip");
+}
+
+TEST_F(StaticCacheTest, UnrelatedFilesInDirectoryKeepEntry) {
+  StaticCache cache;
+  std::string path = Write("keep.bin", "cached");
+  std::string sentinel = Write("sentinel.bin", "s");
+  std::shared_ptr<const StaticAsset> first = cache.Get(path, ACCEPT_GZIP);
+  std::shared_ptr<const StaticAsset> probe = cache.Get(sentinel, ACCEPT_GZIP);
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(probe);
+  // 同一目录中的其他文件（包括名称以它为前缀的文件）不使条目失效
+  Write("other.bin", "x");
+  Write("keep.bin.bak", "x");
+  Write("keep.bin.gz", "gz");
+  // keep.bin.gz在最后创建，它使条目失效时说明之前的事件都已处理
+  ASSERT_TRUE(WaitFor(
+      [&]() { return cache.Get(path, ACCEPT_GZIP)->Has(ENCODING_GZIP); }));
+  EXPECT_EQ(cache.Get(sentinel, ACCEPT_GZIP), probe);
+}
+
+TEST_F(StaticCacheTest, CompressesInBackgroundOnce) {
+  if (!CanCompress(ENCODING_GZIP)) {
+    GTEST_SKIP() << "built without zlib";
+  }
+  StaticCache cache;
+  std::string text;
+  while (text.size() < 64 * 1024) {
+    text += "static content compresses well; ";
+  }
+  std::string path = Write("page.txt", text);
+  // 第一次请求不等待压缩，以原始内容响应
+  std::shared_ptr<const StaticAsset> first = cache.Get(path, ACCEPT_GZIP);
+  ASSERT_TRUE(first);
+  EXPECT_TRUE(first->compressible_);
+  EXPECT_FALSE(first->Has(ENCODING_GZIP));
+  ASSERT_TRUE(WaitFor(
+      [&]() { return cache.Get(path, ACCEPT_GZIP)->Has(ENCODING_GZIP); }));
+  std::shared_ptr<const StaticAsset> compressed = cache.Get(path, ACCEPT_GZIP);
+  const StaticRepresentation &gzip = compressed->Select(ACCEPT_GZIP);
+  EXPECT_LT(gzip.body_->size(), text.size() / 10);
+  EXPECT_NE(gzip.etag_,
+            compressed->representations_[ENCODING_IDENTITY].etag_);
+  // 压缩结果计入缓存容量，之后的请求直接命中
+  EXPECT_EQ(cache.CachedBytes(), text.size() + gzip.body_->size());
+  EXPECT_EQ(cache.Get(path, ACCEPT_GZIP), compressed);
+}
+
+TEST_F(StaticCacheTest, HeaderBlocksCarryValidators) {
+  StaticCache cache;
+  std::shared_ptr<const StaticAsset> asset =
+      cache.Get(Write("style.css", "body {}"), ACCEPT_GZIP);
+  ASSERT_TRUE(asset);
+  const StaticRepresentation &identity =
+      asset->representations_[ENCODING_IDENTITY];
+  std::string etag_line = "ETag: " + identity.etag_ + "\r\n";
+  EXPECT_EQ(identity.headers_->rfind("Content-Type: text/css", 0), 0u)
+      << *identity.headers_;
+  EXPECT_NE(identity.headers_->find(etag_line), std::string::npos);
+  EXPECT_EQ(identity.validators_->rfind(etag_line, 0), 0u);
+  EXPECT_NE(identity.validators_->find("Last-Modified: "), std::string::npos);
+}
+
+TEST_F(StaticCacheTest, EvictsLeastRecentlyUsed) {
+  StaticCache cache(10);
+  std::string a = Write("a.bin", "aaaa");
+  std::string b = Write("b.bin", "bbbb");
+  std::string c = Write("c.bin", "cccc");
+  std::shared_ptr<const StaticAsset> first_a = cache.Get(a, ACCEPT_GZIP);
+  std::shared_ptr<const StaticAsset> first_b = cache.Get(b, ACCEPT_GZIP);
+  EXPECT_EQ(cache.Get(a, ACCEPT_GZIP), first_a);
+  // 容量只够两个文件，加载c时淘汰最久未使用的b
+  cache.Get(c, ACCEPT_GZIP);
+  EXPECT_EQ(cache.CachedBytes(), 8u);
+  EXPECT_EQ(cache.Get(a, ACCEPT_GZIP), first_a);
+  EXPECT_NE(cache.Get(b, ACCEPT_GZIP), first_b);
+}
+
+TEST_F(StaticCacheTest, LargeFilesAreSentFromDisk) {
+  StaticCache cache(DEFAULT_STATIC_CACHE_BYTES, 16);
+  std::string path = Write("large.bin", std::string(17, 'l'));
+  std::shared_ptr<const StaticAsset> asset = cache.Get(path, ACCEPT_GZIP);
+  ASSERT_TRUE(asset);
+  const StaticRepresentation &identity =
+      asset->representations_[ENCODING_IDENTITY];
+  EXPECT_FALSE(identity.body_);
+  ASSERT_TRUE(identity.file_);
+  EXPECT_EQ(identity.file_->Size(), 17u);
+  EXPECT_EQ(cache.CachedBytes(), 0u);
+  EXPECT_NE(cache.Get(path, ACCEPT_GZIP), asset);
+}
+
+TEST_F(StaticCacheTest, MissingFileIsNotCached) {
+  StaticCache cache;
+  EXPECT_FALSE(cache.Get(dir_ + "/missing.bin", ACCEPT_GZIP));
+  EXPECT_EQ(cache.CachedBytes(), 0u);
+}
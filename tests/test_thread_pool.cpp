@@ -0,0 +1,422 @@
+#include <gtest/gtest.h>
+#include "thread_pool.h"
+#include <set>
+
+namespace {
+
+// 记录析构次数的可调用对象，pad_决定大小
+template <size_t Size> struct Counted {
+  explicit Counted(std::atomic<int> *calls, std::atomic<int> *destroyed)
+      : calls_(calls), destroyed_(destroyed) {}
+  Counted(Counted &&other) noexcept
+      : calls_(other.calls_), destroyed_(other.destroyed_) {
+    other.destroyed_ = nullptr;
+  }
+  Counted(const Counted &) = delete;
+  ~Counted() {
+    if (destroyed_) {
+      destroyed_->fetch_add(1);
+    }
+  }
+  void operator()() { calls_->fetch_add(1); }
+
+  std::atomic<int> *calls_;
+  std::atomic<int> *destroyed_;
+  char pad_[Size] = {};
+};
+
+// 拷贝时抛出异常的可调用对象，用于模拟任务在槽中构造失败
+struct ThrowOnCopy {
+  ThrowOnCopy() = default;
+  ThrowOnCopy(const ThrowOnCopy &) { throw std::runtime_error("copy failed"); }
+  void operator()() const {}
+};
+
+// 阻塞工作线程直到Open被调用
+class Gate {
+public:
+  Gate() : future_(promise_.get_future().share()) {}
+  void Open() { promise_.set_value(); }
+  std::shared_future<void> Future() const { return future_; }
+
+private:
+  std::promise<void> promise_;
+  std::shared_future<void> future_;
+};
+
+// 提交count个各阻塞task_ms毫秒的任务（类似数据库查询），等待全部完成，返回期间观察到的最大线程数
+size_t RunBurst(ThreadPool &pool, int count, int task_ms) {
+  std::atomic<int> done{0};
+  for (int i = 0; i < count; ++i) {
+    pool.Post([&done, task_ms]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(task_ms));
+      ++done;
+    });
+  }
+  size_t peak = pool.ThreadCount();
+  while (done.load() < count) {
+    peak = std::max(peak, pool.ThreadCount());
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return peak;
+}
+
+// 等待线程数降到expected，最多timeout_ms毫秒
+bool WaitForThreadCount(const ThreadPool &pool, size_t expected,
+                        int timeout_ms) {
+  for (int waited = 0; waited < timeout_ms; waited += 50) {
+    if (pool.ThreadCount() == expected) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return pool.ThreadCount() == expected;
+}
+
+} // namespace
+
+TEST(InlineTaskTest, StoresMoveOnlyCallableInline) {
+  static_assert(sizeof(Counted<8>) <= INLINE_TASK_SIZE, "fits inline");
+  std::atomic<int> calls{0};
+  std::atomic<int> destroyed{0};
+  InlineTask task;
+  EXPECT_FALSE(task);
+  auto value = std::make_unique<int>(7);
+  int seen = 0;
+  task.Emplace([value = std::move(value), &seen]() { seen = *value; });
+  ASSERT_TRUE(task);
+  task();
+  EXPECT_EQ(seen, 7);
+
+  // 重新放入时先销毁原有的可调用对象
+  task.Emplace(Counted<8>(&calls, &destroyed));
+  task();
+  task();
+  EXPECT_EQ(calls.load(), 2);
+  EXPECT_EQ(destroyed.load(), 0);
+  task.Reset();
+  EXPECT_FALSE(task);
+  EXPECT_EQ(destroyed.load(), 1);
+}
+
+TEST(InlineTaskTest, OversizedCallableFallsBackToHeap) {
+  static_assert(sizeof(Counted<INLINE_TASK_SIZE>) > INLINE_TASK_SIZE,
+                "does not fit inline");
+  std::atomic<int> calls{0};
+  std::atomic<int> destroyed{0};
+  {
+    InlineTask task;
+    task.Emplace(Counted<INLINE_TASK_SIZE>(&calls, &destroyed));
+    task();
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(destroyed.load(), 0);
+  }
+  // 析构时释放堆上的可调用对象
+  EXPECT_EQ(destroyed.load(), 1);
+}
+
+TEST(ThreadPoolPostTest, RunsMoveOnlyAndOversizedTasks) {
+  std::atomic<int> calls{0};
+  std::atomic<int> destroyed{0};
+  std::atomic<int> sum{0};
+  {
+    ThreadPool pool(2, 2, 256);
+    for (int i = 0; i < 50; ++i) {
+      pool.Post([value = std::make_unique<int>(i), &sum]() { sum += *value; });
+      pool.Post(Counted<INLINE_TASK_SIZE * 4>(&calls, &destroyed));
+    }
+    // 任务抛出的异常只记录日志，不影响之后的任务
+    pool.Post([]() { throw std::runtime_error("task failed"); });
+    std::future<int> result =
+        pool.EnqueueTask([](int a, int b) { return a * b; }, 6, 7);
+    EXPECT_EQ(result.get(), 42);
+  }
+  // 析构时执行完全部已提交的任务，并销毁全部可调用对象
+  EXPECT_EQ(sum.load(), 49 * 50 / 2);
+  EXPECT_EQ(calls.load(), 50);
+  EXPECT_EQ(destroyed.load(), 50);
+}
+
+TEST(ThreadPoolPostTest, FullQueueThrowsWithoutLeakingSlots) {
+  constexpr size_t QUEUE_LIMIT = 4;
+  ThreadPool pool(1, 1, QUEUE_LIMIT);
+  for (int round = 0; round < 50; ++round) {
+    Gate gate;
+    std::promise<void> started;
+    std::atomic<int> finished{0};
+    pool.Post([&started, future = gate.Future(), &finished]() {
+      started.set_value();
+      future.wait();
+      ++finished;
+    });
+    started.get_future().wait();
+    // 唯一的工作线程被占住，排队名额恰好为QUEUE_LIMIT个
+    for (size_t i = 0; i < QUEUE_LIMIT; ++i) {
+      if (i == 1) {
+        // 任务在槽中构造失败时归还名额和槽
+        ThrowOnCopy throwing;
+        EXPECT_THROW(pool.Post(throwing), std::runtime_error);
+      }
+      ASSERT_NO_THROW(pool.Post([&finished]() { ++finished; }))
+          << "round " << round << " task " << i;
+    }
+    EXPECT_THROW(pool.Post([]() {}), std::runtime_error);
+    EXPECT_THROW(pool.EnqueueTask([]() { return 0; }), std::runtime_error);
+    gate.Open();
+    while (finished.load() < static_cast<int>(QUEUE_LIMIT) + 1) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+TEST(ThreadPoolElasticTest, GrowsRetiresAndRegrows) {
+  ThreadPool pool(1, 4, 256);
+  EXPECT_EQ(pool.ThreadCount(), 1u);
+  // 任务排队时间长且线程全部繁忙时扩容，不超过max_threads
+  size_t peak = RunBurst(pool, 60, 20);
+  EXPECT_GT(peak, 1u);
+  EXPECT_LE(peak, 4u);
+  // 持续空闲后空闲线程逐个领取退出名额，回到init_threads
+  ASSERT_TRUE(WaitForThreadCount(pool, 1, 10000));
+  // 退出的线程留下的位置可以被新线程复用
+  peak = RunBurst(pool, 60, 20);
+  EXPECT_GT(peak, 1u);
+  EXPECT_LE(peak, 4u);
+}
+
+TEST(ThreadPoolElasticTest, FixedPoolKeepsThreadCount) {
+  ThreadPool pool(2, 2, 256);
+  EXPECT_EQ(RunBurst(pool, 20, 10), 2u);
+  EXPECT_EQ(pool.ThreadCount(), 2u);
+}
+
+TEST(WorkStealingDequeTest, OwnerPopsLifoThiefStealsFifo) {
+  WorkStealingDeque<int> deque(4);
+  EXPECT_TRUE(deque.Empty());
+  int item = 0;
+  EXPECT_FALSE(deque.Pop(&item));
+  EXPECT_FALSE(deque.Steal(&item));
+  // 超过初始容量时搬到更大的数组，元素顺序不变
+  for (int i = 0; i < 100; ++i) {
+    deque.Push(i);
+  }
+  ASSERT_TRUE(deque.Pop(&item));
+  EXPECT_EQ(item, 99);
+  ASSERT_TRUE(deque.Steal(&item));
+  EXPECT_EQ(item, 0);
+  for (int expected = 98; expected >= 1; --expected) {
+    ASSERT_TRUE(deque.Pop(&item));
+    EXPECT_EQ(item, expected);
+  }
+  EXPECT_TRUE(deque.Empty());
+  EXPECT_FALSE(deque.Pop(&item));
+}
+
+TEST(WorkStealingDequeTest, LastElementGoesToExactlyOneSide) {
+  constexpr int ROUNDS = 200000;
+  WorkStealingDeque<int> deque;
+  std::vector<std::atomic<int>> taken(ROUNDS);
+  std::atomic<bool> done{false};
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 2; ++t) {
+    thieves.emplace_back([&]() {
+      int item;
+      while (!done.load()) {
+        if (deque.Steal(&item)) {
+          taken[item].fetch_add(1);
+        }
+      }
+    });
+  }
+  // 每次放入一个元素后立即取出，所属线程总是在与窃取者争夺最后一个元素
+  int popped = 0;
+  for (int i = 0; i < ROUNDS; ++i) {
+    deque.Push(i);
+    int item;
+    if (deque.Pop(&item)) {
+      EXPECT_EQ(item, i);
+      taken[item].fetch_add(1);
+      ++popped;
+    }
+  }
+  done = true;
+  for (std::thread &thief : thieves) {
+    thief.join();
+  }
+  int item;
+  EXPECT_FALSE(deque.Pop(&item));
+  for (int i = 0; i < ROUNDS; ++i) {
+    ASSERT_EQ(taken[i].load(), 1) << "element " << i;
+  }
+  EXPECT_GT(popped, 0);
+}
+
+TEST(MpmcQueueTest, BoundedFifo) {
+  MpmcQueue<int> queue(5);
+  EXPECT_EQ(queue.Capacity(), 8u);
+  int item = 0;
+  EXPECT_FALSE(queue.TryPop(&item));
+  // 多次绕过环形数组的结尾
+  int next_push = 0;
+  int next_pop = 0;
+  for (int round = 0; round < 10; ++round) {
+    while (queue.TryPush(next_push)) {
+      ++next_push;
+    }
+    EXPECT_EQ(next_push - next_pop, 8);
+    for (int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(queue.TryPop(&item));
+      EXPECT_EQ(item, next_pop++);
+    }
+  }
+  while (queue.TryPop(&item)) {
+    EXPECT_EQ(item, next_pop++);
+  }
+  EXPECT_EQ(next_pop, next_push);
+}
+
+TEST(MpmcQueueTest, ConcurrentProducersKeepTheirOrder) {
+  constexpr int PRODUCERS = 4;
+  constexpr int PER_PRODUCER = 50000;
+  MpmcQueue<int> queue(64);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < PRODUCERS; ++p) {
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < PER_PRODUCER; ++i) {
+        while (!queue.TryPush(p * PER_PRODUCER + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  // 两个消费者：每个元素恰好被取走一次，同一消费者看到的同一生产者的元素保持放入顺序
+  std::vector<std::atomic<int>> taken(PRODUCERS * PER_PRODUCER);
+  std::atomic<int> remaining{PRODUCERS * PER_PRODUCER};
+  std::atomic<bool> ordered{true};
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 2; ++c) {
+    consumers.emplace_back([&]() {
+      std::vector<int> last(PRODUCERS, -1);
+      int item;
+      while (remaining.load() > 0) {
+        if (!queue.TryPop(&item)) {
+          std::this_thread::yield();
+          continue;
+        }
+        int producer = item / PER_PRODUCER;
+        if (item % PER_PRODUCER <= last[producer]) {
+          ordered = false;
+        }
+        last[producer] = item % PER_PRODUCER;
+        taken[item].fetch_add(1);
+        remaining.fetch_sub(1);
+      }
+    });
+  }
+  for (std::thread &thread : producers) {
+    thread.join();
+  }
+  for (std::thread &thread : consumers) {
+    thread.join();
+  }
+  EXPECT_TRUE(ordered.load());
+  for (int i = 0; i < PRODUCERS * PER_PRODUCER; ++i) {
+    ASSERT_EQ(taken[i].load(), 1) << "element " << i;
+  }
+}
+
+TEST(ThreadPoolMpmcTest, SingleWorkerRunsInSubmissionOrder) {
+  std::vector<int> order;
+  {
+    ThreadPool pool(1, 1, 128, QueueBackend::MPMC);
+    Gate gate;
+    pool.Post([future = gate.Future()]() { future.wait(); });
+    for (int i = 0; i < 100; ++i) {
+      pool.Post([&order, i]() { order.push_back(i); });
+    }
+    gate.Open();
+  }
+  ASSERT_EQ(order.size(), 100u);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST(ThreadPoolMpmcTest, FullQueueThrows) {
+  ThreadPool pool(1, 1, 8, QueueBackend::MPMC);
+  Gate gate;
+  std::promise<void> started;
+  pool.Post([&started, future = gate.Future()]() {
+    started.set_value();
+    future.wait();
+  });
+  started.get_future().wait();
+  for (int i = 0; i < 8; ++i) {
+    pool.Post([]() {});
+  }
+  EXPECT_THROW(pool.Post([]() {}), std::runtime_error);
+  gate.Open();
+}
+
+TEST(CpuAffinityTest, ParsesPoliciesAndCpuLists) {
+  EXPECT_FALSE(CpuAffinity().Enabled());
+  EXPECT_EQ(CpuAffinity().CpuFor(0), -1);
+  EXPECT_FALSE(CpuAffinity::Parse("none").Enabled());
+  EXPECT_FALSE(CpuAffinity::Parse("").Enabled());
+
+  CpuAffinity explicit_list = CpuAffinity::Parse("0-2,5");
+  ASSERT_TRUE(explicit_list.Enabled());
+  EXPECT_EQ(explicit_list.CpuFor(0), 0);
+  EXPECT_EQ(explicit_list.CpuFor(2), 2);
+  EXPECT_EQ(explicit_list.CpuFor(3), 5);
+  // 线程数超过CPU数时从头循环，From错开起始位置
+  EXPECT_EQ(explicit_list.CpuFor(4), 0);
+  EXPECT_EQ(explicit_list.From(1).CpuFor(0), 1);
+  EXPECT_EQ(explicit_list.From(1).CpuFor(3), 0);
+
+  for (const char *invalid :
+       {"x", "compactx", "1-", "3-1", "-1", "1,,2", "1;2", "0-99999"}) {
+    EXPECT_THROW(CpuAffinity::Parse(invalid), std::runtime_error) << invalid;
+  }
+}
+
+TEST(CpuAffinityTest, PoliciesOrderEveryAllowedCpuOnce) {
+  cpu_set_t allowed;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  const size_t count = CPU_COUNT(&allowed);
+  for (const char *policy : {"compact", "scatter"}) {
+    CpuAffinity affinity = CpuAffinity::Parse(policy);
+    ASSERT_TRUE(affinity.Enabled()) << policy;
+    std::set<int> seen;
+    for (size_t i = 0; i < count; ++i) {
+      int cpu = affinity.CpuFor(i);
+      EXPECT_TRUE(CPU_ISSET(cpu, &allowed)) << policy << " cpu " << cpu;
+      seen.insert(cpu);
+    }
+    EXPECT_EQ(seen.size(), count) << policy;
+    EXPECT_EQ(affinity.CpuFor(count), affinity.CpuFor(0)) << policy;
+  }
+}
+
+TEST(CpuAffinityTest, WorkersAreNamedAndPinned) {
+  cpu_set_t allowed;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) {
+    ++cpu;
+  }
+  ThreadPool pool(2, 2, 16, QueueBackend::WORK_STEALING, "pinned",
+                  CpuAffinity::Parse(std::to_string(cpu)));
+  for (int i = 0; i < 20; ++i) {
+    std::pair<std::string, int> where =
+        pool.EnqueueTask([]() {
+              char name[16] = {};
+              pthread_getname_np(pthread_self(), name, sizeof(name));
+              return std::make_pair(std::string(name), sched_getcpu());
+            })
+            .get();
+    EXPECT_TRUE(where.first == "pinned-0" || where.first == "pinned-1")
+        << where.first;
+    EXPECT_EQ(where.second, cpu);
+  }
+}